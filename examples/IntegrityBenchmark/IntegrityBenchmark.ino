@@ -0,0 +1,171 @@
+/*
+  Example application to benchmark the integrity check of the crash
+  records of the EspSaveCrashSpiffs library
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: IntegrityBenchmark.ino
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+// include custom lib for this example
+#include "EspSaveCrashSpiffs.h"
+
+// include Arduino Filesystem lib
+#include <FS.h>
+
+// size of the buffer of the CRC benchmark
+#define CRC_BUFFER_SIZE 4096
+
+// number of CRC runs over the buffer
+#define NUMBER_OF_RUNS 16
+
+// use the default file name defined in EspSaveCrashSpiffs.h
+EspSaveCrashSpiffs SaveCrashSpiffs(0);
+
+/**
+ * Output discarding everything, to measure the reading only
+ */
+class NullPrint : public Print
+{
+  public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t*, size_t size) override { return size; }
+};
+
+NullPrint nullOutput;
+
+void setup(void)
+{
+  // begin serial communication with 115200 baud
+  Serial.begin(115200);
+
+  Serial.println();
+  Serial.println("IntegrityBenchmark.ino");
+  Serial.println();
+
+  // start SPIFFS and rotate the latest crash log
+  SaveCrashSpiffs.begin();
+
+  Serial.println("Press a key + <enter>");
+  Serial.println("b : run the benchmark");
+  Serial.println("0 : attempt to divide by zero, to save a crash log");
+}
+
+void loop(void)
+{
+  if (Serial.available() > 0)
+  {
+    char inChar = Serial.read();
+
+    switch (inChar)
+    {
+      case 'b':
+        runBenchmark();
+        break;
+      case '0':
+        Serial.println("Attempting to divide by zero ...");
+
+        int result, zero;
+        zero = 0;
+        result = 1 / zero;
+        Serial.print("Result = ");
+        Serial.println(result);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/**
+ * @brief      Run the benchmark and print the throughput.
+ */
+void runBenchmark()
+{
+  uint32_t i;
+  uint32_t ulStart;
+  uint32_t ulDuration;
+  uint32_t ulCrc = 0;
+
+  // CRC32 of a buffer in RAM
+  uint8_t* pubBuffer = (uint8_t*)calloc(CRC_BUFFER_SIZE, sizeof(uint8_t));
+  if (!pubBuffer)
+  {
+    Serial.println("Not enough RAM for the CRC benchmark");
+    return;
+  }
+
+  ulStart = micros();
+  for (i = 0; i < NUMBER_OF_RUNS; i++)
+  {
+    ulCrc = crashCrc32(ulCrc, pubBuffer, CRC_BUFFER_SIZE);
+  }
+  ulDuration = micros() - ulStart;
+  printResult("crashCrc32", CRC_BUFFER_SIZE * NUMBER_OF_RUNS, ulDuration);
+
+  free(pubBuffer);
+
+  // the latest crash log, read raw and printed with the CRC check
+  char* pcFileName = (char*)calloc(CRASH_NAME_BUFFER_SIZE, sizeof(char));
+  SaveCrashSpiffs.getLastLogFileName(pcFileName);
+
+  File theFile = SPIFFS.open(pcFileName, "r");
+  if (!theFile)
+  {
+    Serial.println("No crash log found, press '0' to save one");
+    free(pcFileName);
+    return;
+  }
+
+  uint32_t ulFileSize = theFile.size();
+  uint8_t pubChunk[64];
+
+  ulStart = micros();
+  while (theFile.available())
+  {
+    theFile.read(pubChunk, sizeof(pubChunk));
+  }
+  ulDuration = micros() - ulStart;
+  theFile.close();
+  printResult("Raw read", ulFileSize, ulDuration);
+
+  ulStart = micros();
+  SaveCrashSpiffs.print(pcFileName, nullOutput);
+  ulDuration = micros() - ulStart;
+  printResult("print() with CRC check", ulFileSize, ulDuration);
+
+  free(pcFileName);
+}
+
+/**
+ * @brief      Prints the result of a benchmark run.
+ *
+ * @param[in]  pcName      The name of the run
+ * @param[in]  ulBytes     The number of processed bytes
+ * @param[in]  ulDuration  The duration in us
+ */
+void printResult(const char* pcName, uint32_t ulBytes, uint32_t ulDuration)
+{
+  uint32_t ulBytesPerSecond = ((uint64_t)ulBytes * 1000000) / (ulDuration ? ulDuration : 1);
+
+  Serial.printf("%s: %d byte in %d us, %d kB/s\n", pcName, ulBytes, ulDuration, ulBytesPerSecond / 1024);
+}
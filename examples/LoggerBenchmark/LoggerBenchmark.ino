@@ -0,0 +1,143 @@
+/*
+  Example application to benchmark the buffered event logger
+  of the EspSaveCrashSpiffs library against saveToSpiffsFile
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: LoggerBenchmark.ino
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+// include custom lib for this example
+#include "EspSaveCrashSpiffs.h"
+#include "EspSaveCrashLogger.h"
+
+// include Arduino Filesystem lib
+#include <FS.h>
+
+// number of messages of each benchmark run
+#define NUMBER_OF_MESSAGES 200
+
+// use the default file name defined in EspSaveCrashSpiffs.h
+EspSaveCrashSpiffs SaveCrashSpiffs(0);
+
+// log to '/eventLog-1.log'
+EspSaveCrashLogger EventLogger(SaveCrashSpiffs);
+
+void setup(void)
+{
+  // begin serial communication with 115200 baud
+  Serial.begin(115200);
+
+  Serial.println();
+  Serial.println("LoggerBenchmark.ino");
+  Serial.println();
+
+  // start SPIFFS and rotate the latest crash log
+  SaveCrashSpiffs.begin();
+
+  Serial.printf("Crash store started in %u us\n", SaveCrashSpiffs.getBeginDuration());
+
+  EventLogger.begin();
+
+  // rotate only after the benchmark, to measure the writing only
+  EventLogger.setMaxFileSize(0xFFFFFFFF);
+
+  Serial.println("Press a key + <enter>");
+  Serial.println("b : run the benchmark");
+  Serial.println("0 : attempt to divide by zero, pending log lines are saved");
+}
+
+void loop(void)
+{
+  // flush the pending lines of the logger if the flush interval elapsed
+  EventLogger.handle();
+
+  if (Serial.available() > 0)
+  {
+    char inChar = Serial.read();
+
+    switch (inChar)
+    {
+      case 'b':
+        runBenchmark();
+        break;
+      case '0':
+        EventLogger.log(CRASH_LOG_ERROR, "Attempting to divide by zero ...");
+        Serial.println("Attempting to divide by zero ...");
+
+        int result, zero;
+        zero = 0;
+        result = 1 / zero;
+        Serial.print("Result = ");
+        Serial.println(result);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/**
+ * @brief      Run the benchmark and print the messages per second.
+ */
+void runBenchmark()
+{
+  uint32_t i;
+  uint32_t ulStart;
+  uint32_t ulDuration;
+  char pcMessage[64];
+
+  // unbuffered, each message opens, writes and closes the file
+  ulStart = micros();
+  for (i = 0; i < NUMBER_OF_MESSAGES; i++)
+  {
+    sprintf(pcMessage, "%u I Benchmark message %u\n", (uint32_t)millis(), i);
+    saveToSpiffsFile(pcMessage, "/benchLog-1.log");
+  }
+  ulDuration = micros() - ulStart;
+  printResult("saveToSpiffsFile", ulDuration);
+
+  // buffered, the staging buffer is written if it is full
+  ulStart = micros();
+  for (i = 0; i < NUMBER_OF_MESSAGES; i++)
+  {
+    EventLogger.log(CRASH_LOG_INFO, "Benchmark message %u", i);
+  }
+  EventLogger.flush();
+  ulDuration = micros() - ulStart;
+  printResult("EspSaveCrashLogger", ulDuration);
+
+  SPIFFS.remove("/benchLog-1.log");
+}
+
+/**
+ * @brief      Prints the result of a benchmark run.
+ *
+ * @param[in]  pcName      The name of the run
+ * @param[in]  ulDuration  The duration in us
+ */
+void printResult(const char* pcName, uint32_t ulDuration)
+{
+  uint32_t ulMessagesPerSecond = ((uint64_t)NUMBER_OF_MESSAGES * 1000000) / ulDuration;
+
+  Serial.printf("%s: %d messages in %d us, %d messages/s\n", pcName, NUMBER_OF_MESSAGES, ulDuration, ulMessagesPerSecond);
+}
@@ -0,0 +1,55 @@
+/*
+  Example application to pull the crash logs over the serial interface
+  with the framed binary transfer of the EspSaveCrashSpiffs library
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: SerialDump.ino
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+// include custom lib for this example
+#include "EspSaveCrashSpiffs.h"
+#include "EspSaveCrashDump.h"
+
+// include Arduino Filesystem lib
+#include <FS.h>
+
+// use the default file name defined in EspSaveCrashSpiffs.h
+EspSaveCrashSpiffs SaveCrashSpiffs(0);
+
+// answer the requests of extras/CrashDump/crash_dump.py
+EspSaveCrashDump CrashDump(SaveCrashSpiffs, Serial);
+
+void setup(void)
+{
+  // a higher baudrate speeds up the transfer, use the same on the host
+  Serial.begin(921600);
+
+  // start SPIFFS and rotate the latest crash log
+  SaveCrashSpiffs.begin();
+}
+
+void loop(void)
+{
+  // process the next complete request of the host
+  CrashDump.handle();
+}
@@ -70,8 +70,10 @@ void setup(void)
   // Serial.println();
   // Serial.printf("Default crashlog filename: '%s'\n", SaveCrashSpiffs.getLogFileName());
 
-  // start SPIFFS
-  SPIFFS.begin();
+  // start SPIFFS and rotate the latest crash log
+  SaveCrashSpiffs.begin();
+
+  Serial.printf("Crash store started in %u us\n", SaveCrashSpiffs.getBeginDuration());
 
   // allocate memory for serial reading content
   _serialReadContent = (char*)calloc(100, sizeof(char));
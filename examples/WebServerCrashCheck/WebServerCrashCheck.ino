@@ -47,6 +47,7 @@ extern "C" {
 #include <WiFiClient.h>
 #include <ESP8266WebServer.h>
 #include <ESP8266mDNS.h>
+#include <StreamString.h>
 
 // WiFi ssid and password defined in wifiConfig.h
 // file might be tracked with gitignore
@@ -72,6 +73,9 @@ void setup(void)
   Serial.begin(115200);
   Serial.println("\nWebServerCrashCheck.ino");
 
+  // start SPIFFS and rotate the latest crash log
+  SaveCrashSpiffs.begin();
+
   Serial.printf("Connecting to %s ", ssid);
 
   // WiFi.persistent(false);
@@ -97,6 +101,8 @@ void setup(void)
   server.on("/log", handleLog);
   server.on("/list", handleListFiles);
   server.on("/file", handleFilePath);
+  server.on("/since", handleSince);
+  server.on("/build", handleBuild);
   server.onNotFound(handleNotFound);
 
   // start the http server
@@ -277,7 +283,7 @@ void printLogToSerial()
  */
 void handleRoot()
 {
-  server.send(200, "text/html", "<html><body>Hello from ESP<br><a href='/log' target='_blank'>Latest crash Log</a><br><a href='/list' target='_blank'>List all files in root directory</a><br><a href='/file?path=/crashLog-2.log' target='_blank'>Crash Log file #2</a><br></body></html>");
+  server.send(200, "text/html", "<html><body>Hello from ESP<br><a href='/log' target='_blank'>Latest crash Log</a><br><a href='/list' target='_blank'>List all files in root directory</a><br><a href='/file?path=/crashLog-2.log' target='_blank'>Crash Log file #2</a><br><a href='/since?cursor=0:0' target='_blank'>Crash logs since cursor</a><br></body></html>");
 }
 
 /**
@@ -421,6 +427,63 @@ void handleFilePath()
   }
 }
 
+/**
+ * @brief      List the crash logs of a build
+ *
+ * Returns the crash log indexes of the given build, one per line, e.g.
+ * http://192.168.4.1/build?id=v1.2.3
+ * Without an id the crash logs of the running build are listed.
+ */
+void handleBuild()
+{
+  uint32_t _fileIndexes[32];
+
+  // keep the String, c_str() is only valid as long as it exists
+  String buildId = server.arg("id");
+  uint32_t _numberOfFiles = SaveCrashSpiffs.getBuildFiles(buildId.length() ? buildId.c_str() : NULL, _fileIndexes, 32);
+
+  String content;
+  for (uint32_t i = 0; i < _numberOfFiles; i++)
+  {
+    content += String(_fileIndexes[i]) + "\n";
+  }
+
+  server.send(200, "text/plain", content);
+}
+
+/**
+ * @brief      Handle a delta sync of the crash logs
+ *
+ * Returns only the crash log content added since the given cursor, e.g.
+ * http://192.168.4.1/since?cursor=12:340&max=1024
+ * The cursor to use for the next request is returned in the 'X-Crash-Cursor'
+ * header. An empty response means there is nothing new.
+ */
+void handleSince()
+{
+  crash_cursor_t cursor;
+  char _cursor[24];
+
+  // start at the oldest crash log if no or an invalid cursor is given
+  crashCursorFromString(server.arg("cursor").c_str(), &cursor);
+
+  // limit the response to keep the RAM usage low
+  size_t _maxBytes = CRASH_SYNC_MAX_BYTES;
+  if (server.arg("max") != "")
+  {
+    _maxBytes = constrain(server.arg("max").toInt(), 1, CRASH_SYNC_MAX_BYTES);
+  }
+
+  StreamString content;
+  SaveCrashSpiffs.readSince(&cursor, content, _maxBytes);
+
+  crashCursorToString(&cursor, _cursor, sizeof(_cursor));
+  server.sendHeader("X-Crash-Cursor", _cursor);
+
+  // send as text/plain to avoid problems with '<<<' signs
+  server.send(200, "text/plain", content);
+}
+
 /**
  * @brief      Handle access to filelist webpage
  *
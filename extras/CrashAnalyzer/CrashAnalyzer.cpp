@@ -0,0 +1,634 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: CrashAnalyzer.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Host tool to analyse crash logs collected from many devices
+ *
+ * The files are parsed with the record parser of the library, one file per
+ * worker thread at a time. Only the aggregated statistics are kept in
+ * memory, so any number of files can be processed.
+ *
+ * Build on Linux or Mac OS X from this directory:
+ *   g++ -std=c++11 -O2 -pthread -I../../src CrashAnalyzer.cpp ../../src/EspSaveCrashRecord.cpp ../../src/EspSaveCrashCrc.cpp -o crash-analyzer
+ *
+ * Usage:
+ *   crash-analyzer [-j threads] [-n clusters] [-b build] [-e firmware.elf] [-a addr2line] <file|directory>...
+ */
+
+#include "EspSaveCrashRecord.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// number of backtrace addresses used for the crash signature
+#define SIGNATURE_BACKTRACE_SIZE  3
+
+// maximum number of file paths waiting to be parsed
+#define QUEUE_SIZE  1024
+
+// maximum length of an addr2line output line or a label, longer lines are cut
+#define LINE_BUFFER_SIZE  256
+
+// width of the histogram bars in chars
+#define HISTOGRAM_WIDTH  40
+
+/**
+ * Crashes with the same signature
+ */
+struct Cluster
+{
+  uint32_t ulCount;
+  uint32_t ulException;
+  uint32_t ulEpc1;
+  uint16_t uwBacktrace;
+  uint32_t pulBacktrace[SIGNATURE_BACKTRACE_SIZE];
+  std::string example;
+};
+
+/**
+ * Statistics of a worker, merged at the end
+ */
+struct Statistics
+{
+  uint32_t ulFiles;
+  uint32_t ulUnreadableFiles;
+  uint32_t ulRecords;
+  uint32_t ulTruncatedRecords;
+  uint32_t ulCrashLoopRecords;
+  uint32_t ulSampledRecords;
+  uint32_t ulDroppedCrashes;
+  uint32_t ulOtherBuildRecords;
+  uint32_t ulVerifiedRecords;
+  uint32_t ulCorruptedRecords;
+  std::unordered_map<std::string, Cluster> clusters;
+  std::map<std::string, uint32_t> builds;
+  std::map<uint32_t, uint32_t> exceptions;
+  std::map<uint32_t, uint32_t> reasons;
+
+  Statistics() : ulFiles(0), ulUnreadableFiles(0), ulRecords(0), ulTruncatedRecords(0), ulCrashLoopRecords(0), ulSampledRecords(0), ulDroppedCrashes(0), ulOtherBuildRecords(0), ulVerifiedRecords(0), ulCorruptedRecords(0) {}
+};
+
+/**
+ * Bounded queue of file paths from the directory walker to the workers
+ */
+class PathQueue
+{
+  public:
+    PathQueue() : _bClosed(false) {}
+
+    void push(const std::string& path)
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _notFull.wait(lock, [this] { return _paths.size() < QUEUE_SIZE; });
+      _paths.push_back(path);
+      _notEmpty.notify_one();
+    }
+
+    bool pop(std::string& path)
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _notEmpty.wait(lock, [this] { return !_paths.empty() || _bClosed; });
+
+      if (_paths.empty())
+      {
+        return false;
+      }
+
+      path = _paths.front();
+      _paths.pop_front();
+      _notFull.notify_one();
+
+      return true;
+    }
+
+    void close()
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _bClosed = true;
+      _notEmpty.notify_all();
+    }
+  private:
+    std::deque<std::string> _paths;
+    std::mutex _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+    bool _bClosed;
+};
+
+/**
+ * @brief      Build the signature of a record.
+ *
+ * Crashes with the same exception, epc1 and the same first code addresses
+ * on the stack are considered to have the same cause.
+ *
+ * @param[in]  record  The record
+ *
+ * @return     The signature
+ */
+static std::string _get_signature(const crash_record_t& record)
+{
+  char pcSignature[32 + (SIGNATURE_BACKTRACE_SIZE * 11)];
+  int iLength = snprintf(pcSignature, sizeof(pcSignature), "%u:%u:%08x", record.ulReason, record.ulException, record.ulEpc1);
+
+  for (uint16_t i = 0; (i < record.uwBacktrace) && (i < SIGNATURE_BACKTRACE_SIZE); i++)
+  {
+    iLength += snprintf(pcSignature + iLength, sizeof(pcSignature) - iLength, ":%08x", record.pulBacktrace[i]);
+  }
+
+  return std::string(pcSignature, iLength);
+}
+
+/**
+ * @brief      Add a record to the statistics.
+ *
+ * @param      statistics   The statistics
+ * @param[in]  record       The record
+ * @param[in]  path         The path of the crash log file
+ * @param[in]  buildFilter  Only records of this build are added, if set
+ */
+static void _add_record(Statistics& statistics, const crash_record_t& record, const std::string& path, const std::string& buildFilter)
+{
+  // a corrupted record would create a bogus crash cluster
+  if (record.integrity == CRASH_INTEGRITY_INVALID)
+  {
+    statistics.ulCorruptedRecords++;
+    return;
+  }
+
+  if (!buildFilter.empty() && (buildFilter != record.pcBuildId))
+  {
+    statistics.ulOtherBuildRecords++;
+    return;
+  }
+
+  statistics.ulRecords++;
+
+  if (record.integrity == CRASH_INTEGRITY_VALID)
+  {
+    statistics.ulVerifiedRecords++;
+  }
+
+  if (!record.bComplete)
+  {
+    statistics.ulTruncatedRecords++;
+  }
+  if (record.ulCrashLoopCount)
+  {
+    statistics.ulCrashLoopRecords++;
+  }
+  if (record.bSampled)
+  {
+    statistics.ulSampledRecords++;
+  }
+  statistics.ulDroppedCrashes += record.ulDropped;
+
+  statistics.builds[record.pcBuildId[0] ? record.pcBuildId : "unknown"]++;
+  statistics.exceptions[record.ulException]++;
+  statistics.reasons[record.ulReason]++;
+
+  Cluster& cluster = statistics.clusters[_get_signature(record)];
+  if (cluster.ulCount++ == 0)
+  {
+    cluster.ulException = record.ulException;
+    cluster.ulEpc1 = record.ulEpc1;
+    cluster.uwBacktrace = std::min<uint16_t>(record.uwBacktrace, SIGNATURE_BACKTRACE_SIZE);
+    memcpy(cluster.pulBacktrace, record.pulBacktrace, cluster.uwBacktrace * sizeof(uint32_t));
+    cluster.example = path;
+  }
+}
+
+/**
+ * @brief      Parse a crash log file line by line.
+ *
+ * @param      statistics   The statistics
+ * @param[in]  path         The path of the crash log file
+ * @param[in]  buildFilter  Only records of this build are added, if set
+ */
+static void _parse_file(Statistics& statistics, const std::string& path, const std::string& buildFilter)
+{
+  FILE* pFile = fopen(path.c_str(), "r");
+
+  if (!pFile)
+  {
+    statistics.ulUnreadableFiles++;
+    return;
+  }
+
+  statistics.ulFiles++;
+
+  EspSaveCrashRecordParser parser;
+  char* pcLine = NULL;
+  size_t lineSize = 0;
+
+  // read whole lines of any length, grown by getline as needed
+  while (getline(&pcLine, &lineSize, pFile) >= 0)
+  {
+    if (parser.parseLine(pcLine))
+    {
+      _add_record(statistics, parser.getRecord(), path, buildFilter);
+    }
+  }
+  free(pcLine);
+
+  if (parser.finish())
+  {
+    _add_record(statistics, parser.getRecord(), path, buildFilter);
+  }
+
+  fclose(pFile);
+}
+
+/**
+ * @brief      Add a file or all files of a directory to the queue.
+ *
+ * @param      queue  The queue
+ * @param[in]  path   The path of a file or directory
+ */
+static void _walk(PathQueue& queue, const std::string& path)
+{
+  struct stat pathStat;
+
+  if (stat(path.c_str(), &pathStat) != 0)
+  {
+    fprintf(stderr, "Can not access '%s'\n", path.c_str());
+    return;
+  }
+
+  if (!S_ISDIR(pathStat.st_mode))
+  {
+    queue.push(path);
+    return;
+  }
+
+  DIR* pDir = opendir(path.c_str());
+  if (!pDir)
+  {
+    fprintf(stderr, "Can not open '%s'\n", path.c_str());
+    return;
+  }
+
+  struct dirent* pEntry;
+  while ((pEntry = readdir(pDir)) != NULL)
+  {
+    if ((strcmp(pEntry->d_name, ".") == 0) || (strcmp(pEntry->d_name, "..") == 0))
+    {
+      continue;
+    }
+
+    _walk(queue, path + "/" + pEntry->d_name);
+  }
+
+  closedir(pDir);
+}
+
+/**
+ * @brief      Merge the statistics of a worker.
+ *
+ * @param      total       The total statistics
+ * @param[in]  statistics  The statistics of a worker
+ */
+static void _merge(Statistics& total, const Statistics& statistics)
+{
+  total.ulFiles += statistics.ulFiles;
+  total.ulUnreadableFiles += statistics.ulUnreadableFiles;
+  total.ulRecords += statistics.ulRecords;
+  total.ulTruncatedRecords += statistics.ulTruncatedRecords;
+  total.ulCrashLoopRecords += statistics.ulCrashLoopRecords;
+  total.ulSampledRecords += statistics.ulSampledRecords;
+  total.ulDroppedCrashes += statistics.ulDroppedCrashes;
+  total.ulOtherBuildRecords += statistics.ulOtherBuildRecords;
+  total.ulVerifiedRecords += statistics.ulVerifiedRecords;
+  total.ulCorruptedRecords += statistics.ulCorruptedRecords;
+
+  for (const auto& entry : statistics.clusters)
+  {
+    Cluster& cluster = total.clusters[entry.first];
+    if (cluster.ulCount == 0)
+    {
+      cluster = entry.second;
+    }
+    else
+    {
+      cluster.ulCount += entry.second.ulCount;
+    }
+  }
+  for (const auto& entry : statistics.builds)
+  {
+    total.builds[entry.first] += entry.second;
+  }
+  for (const auto& entry : statistics.exceptions)
+  {
+    total.exceptions[entry.first] += entry.second;
+  }
+  for (const auto& entry : statistics.reasons)
+  {
+    total.reasons[entry.first] += entry.second;
+  }
+}
+
+/**
+ * @brief      Resolve code addresses with addr2line.
+ *
+ * @param[in]  addr2line  The addr2line executable
+ * @param[in]  elfPath    The path of the firmware ELF file
+ * @param[in]  addresses  The addresses
+ *
+ * @return     The 'function at file:line' of each resolved address
+ */
+static std::map<uint32_t, std::string> _symbolicate(const std::string& addr2line, const std::string& elfPath, const std::vector<uint32_t>& addresses)
+{
+  std::map<uint32_t, std::string> symbols;
+
+  if (addresses.empty())
+  {
+    return symbols;
+  }
+
+  // quote the ELF path for the shell
+  std::string command = addr2line + " -fC -e '";
+  for (char c : elfPath)
+  {
+    command += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+  }
+  command += "'";
+
+  char pcAddress[16];
+  for (uint32_t ulAddress : addresses)
+  {
+    snprintf(pcAddress, sizeof(pcAddress), " 0x%08x", ulAddress);
+    command += pcAddress;
+  }
+
+  FILE* pPipe = popen(command.c_str(), "r");
+  if (!pPipe)
+  {
+    fprintf(stderr, "Can not run '%s'\n", addr2line.c_str());
+    return symbols;
+  }
+
+  // two lines per address, function and file:line
+  char pcFunction[LINE_BUFFER_SIZE];
+  char pcLocation[LINE_BUFFER_SIZE];
+  for (uint32_t ulAddress : addresses)
+  {
+    if (!fgets(pcFunction, sizeof(pcFunction), pPipe) || !fgets(pcLocation, sizeof(pcLocation), pPipe))
+    {
+      break;
+    }
+
+    pcFunction[strcspn(pcFunction, "\r\n")] = '\0';
+    pcLocation[strcspn(pcLocation, "\r\n")] = '\0';
+
+    if (strcmp(pcFunction, "??") != 0)
+    {
+      symbols[ulAddress] = std::string(pcFunction) + " at " + pcLocation;
+    }
+  }
+
+  pclose(pPipe);
+
+  return symbols;
+}
+
+/**
+ * @brief      Print a histogram.
+ *
+ * @param[in]  title      The title
+ * @param[in]  entries    The label and count of each entry, largest first
+ * @param[in]  ulTotal    The total count
+ */
+static void _print_histogram(const char* title, const std::vector<std::pair<std::string, uint32_t>>& entries, uint32_t ulTotal)
+{
+  printf("\n%s\n", title);
+
+  for (const auto& entry : entries)
+  {
+    uint32_t ulWidth = ulTotal ? (uint32_t)(((uint64_t)entry.second * HISTOGRAM_WIDTH) / ulTotal) : 0;
+
+    printf("  %-32s %8u %5.1f%% %s\n", entry.first.c_str(), entry.second, ulTotal ? (100.0 * entry.second / ulTotal) : 0.0, std::string(std::max<uint32_t>(ulWidth, 1), '#').c_str());
+  }
+}
+
+/**
+ * @brief      Sort the entries of a histogram, largest first.
+ *
+ * @param      entries  The entries
+ */
+static void _sort_entries(std::vector<std::pair<std::string, uint32_t>>& entries)
+{
+  std::sort(entries.begin(), entries.end(), [](const std::pair<std::string, uint32_t>& a, const std::pair<std::string, uint32_t>& b) {
+    return (a.second != b.second) ? (a.second > b.second) : (a.first < b.first);
+  });
+}
+
+static void _usage(const char* pcName)
+{
+  fprintf(stderr, "Usage: %s [-j threads] [-n clusters] [-b build] [-e firmware.elf] [-a addr2line] <file|directory>...\n", pcName);
+  fprintf(stderr, "  -j  number of worker threads, default is the number of cores\n");
+  fprintf(stderr, "  -n  number of crash clusters shown, default 20\n");
+  fprintf(stderr, "  -b  analyse only the crashes of this build id\n");
+  fprintf(stderr, "  -e  firmware ELF file to resolve the code addresses\n");
+  fprintf(stderr, "  -a  addr2line executable, default xtensa-lx106-elf-addr2line\n");
+}
+
+int main(int argc, char* argv[])
+{
+  uint32_t ulThreads = std::max(1u, std::thread::hardware_concurrency());
+  uint32_t ulClusters = 20;
+  std::string buildFilter;
+  std::string elfPath;
+  std::string addr2line = "xtensa-lx106-elf-addr2line";
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; i++)
+  {
+    bool bHasValue = (i + 1) < argc;
+
+    if ((strcmp(argv[i], "-j") == 0) && bHasValue)
+    {
+      ulThreads = std::max(1ul, strtoul(argv[++i], NULL, 10));
+    }
+    else if ((strcmp(argv[i], "-n") == 0) && bHasValue)
+    {
+      ulClusters = strtoul(argv[++i], NULL, 10);
+    }
+    else if ((strcmp(argv[i], "-b") == 0) && bHasValue)
+    {
+      buildFilter = argv[++i];
+    }
+    else if ((strcmp(argv[i], "-e") == 0) && bHasValue)
+    {
+      elfPath = argv[++i];
+    }
+    else if ((strcmp(argv[i], "-a") == 0) && bHasValue)
+    {
+      addr2line = argv[++i];
+    }
+    else if (argv[i][0] == '-')
+    {
+      _usage(argv[0]);
+      return 1;
+    }
+    else
+    {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  if (paths.empty())
+  {
+    _usage(argv[0]);
+    return 1;
+  }
+
+  // parse the files in parallel, while the directories are crawled
+  PathQueue queue;
+  std::vector<Statistics> workerStatistics(ulThreads);
+  std::vector<std::thread> workers;
+
+  for (uint32_t i = 0; i < ulThreads; i++)
+  {
+    workers.push_back(std::thread([&queue, &workerStatistics, &buildFilter, i] {
+      std::string path;
+      while (queue.pop(path))
+      {
+        _parse_file(workerStatistics[i], path, buildFilter);
+      }
+    }));
+  }
+
+  for (const std::string& path : paths)
+  {
+    _walk(queue, path);
+  }
+  queue.close();
+
+  Statistics total;
+  for (uint32_t i = 0; i < ulThreads; i++)
+  {
+    workers[i].join();
+    _merge(total, workerStatistics[i]);
+  }
+
+  printf("Files:             %u (%u unreadable)\n", total.ulFiles, total.ulUnreadableFiles);
+  printf("Crash records:     %u\n", total.ulRecords);
+  printf("Truncated records: %u\n", total.ulTruncatedRecords);
+  printf("CRC verified:      %u\n", total.ulVerifiedRecords);
+  printf("Corrupted records: %u (skipped)\n", total.ulCorruptedRecords);
+  printf("In a crash loop:   %u\n", total.ulCrashLoopRecords);
+  printf("Header only:       %u\n", total.ulSampledRecords);
+  printf("Dropped crashes:   %u\n", total.ulDroppedCrashes);
+  printf("Crash clusters:    %zu\n", total.clusters.size());
+  if (!buildFilter.empty())
+  {
+    printf("Other builds:      %u\n", total.ulOtherBuildRecords);
+  }
+
+  std::vector<std::pair<std::string, uint32_t>> entries;
+  char pcLabel[LINE_BUFFER_SIZE];
+
+  entries.assign(total.builds.begin(), total.builds.end());
+  _sort_entries(entries);
+  _print_histogram("Crashes per firmware:", entries, total.ulRecords);
+
+  entries.clear();
+  for (const auto& entry : total.exceptions)
+  {
+    snprintf(pcLabel, sizeof(pcLabel), "%2u %s", entry.first, crashRecordExceptionName(entry.first));
+    entries.push_back(std::make_pair(std::string(pcLabel), entry.second));
+  }
+  _sort_entries(entries);
+  _print_histogram("Crashes per exception cause:", entries, total.ulRecords);
+
+  entries.clear();
+  for (const auto& entry : total.reasons)
+  {
+    snprintf(pcLabel, sizeof(pcLabel), "%u", entry.first);
+    entries.push_back(std::make_pair(std::string(pcLabel), entry.second));
+  }
+  _sort_entries(entries);
+  _print_histogram("Crashes per restart reason:", entries, total.ulRecords);
+
+  // largest clusters first
+  std::vector<const Cluster*> clusters;
+  for (const auto& entry : total.clusters)
+  {
+    clusters.push_back(&entry.second);
+  }
+  std::sort(clusters.begin(), clusters.end(), [](const Cluster* a, const Cluster* b) {
+    return (a->ulCount != b->ulCount) ? (a->ulCount > b->ulCount) : (a->example < b->example);
+  });
+  if (clusters.size() > ulClusters)
+  {
+    clusters.resize(ulClusters);
+  }
+
+  std::map<uint32_t, std::string> symbols;
+  if (!elfPath.empty())
+  {
+    std::vector<uint32_t> addresses;
+    for (const Cluster* cluster : clusters)
+    {
+      addresses.push_back(cluster->ulEpc1);
+      addresses.insert(addresses.end(), cluster->pulBacktrace, cluster->pulBacktrace + cluster->uwBacktrace);
+    }
+    std::sort(addresses.begin(), addresses.end());
+    addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+
+    symbols = _symbolicate(addr2line, elfPath, addresses);
+  }
+
+  printf("\nLargest crash clusters:\n");
+  for (const Cluster* cluster : clusters)
+  {
+    printf("\n  %u crashes, exception %u %s, e.g. '%s'\n", cluster->ulCount, cluster->ulException, crashRecordExceptionName(cluster->ulException), cluster->example.c_str());
+
+    for (int16_t i = -1; i < (int16_t)cluster->uwBacktrace; i++)
+    {
+      uint32_t ulAddress = (i < 0) ? cluster->ulEpc1 : cluster->pulBacktrace[i];
+      auto symbol = symbols.find(ulAddress);
+
+      printf("    %s 0x%08x %s\n", (i < 0) ? "epc1" : "    ", ulAddress, (symbol != symbols.end()) ? symbol->second.c_str() : "");
+    }
+  }
+
+  return 0;
+}
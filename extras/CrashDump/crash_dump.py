@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+# -*- coding: UTF-8 -*-
+
+"""
+Host client of the framed binary crash log transfer of EspSaveCrashDump
+
+Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+File: crash_dump.py
+Revision: 0.1.0
+Date: 04-Jan-2020
+Author: brainelectronics
+
+Requires pyserial, install it with 'pip install pyserial'
+
+Usage:
+  crash_dump.py -p /dev/ttyUSB0 -b 921600 list
+  crash_dump.py -p /dev/ttyUSB0 -b 921600 fetch 12 -o logs
+  crash_dump.py -p /dev/ttyUSB0 -b 921600 fetch-range 2 500 -o logs
+  crash_dump.py -p /dev/ttyUSB0 -b 921600 delete 2 500
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+import zlib
+
+SOF = 0xA5
+
+CMD_LIST = 0x01
+CMD_FETCH = 0x02
+CMD_FETCH_RANGE = 0x03
+CMD_DELETE = 0x04
+
+RSP_ENTRY = 0x81
+RSP_FILE = 0x82
+RSP_DATA = 0x83
+RSP_END = 0x84
+RSP_ERROR = 0x8F
+
+ERRORS = {
+    0x01: 'CRC mismatch of the request',
+    0x02: 'unknown command',
+    0x03: 'invalid request length',
+    0x04: 'crash log not found',
+}
+
+
+class CrashDumpError(Exception):
+    """Transfer failed, e.g. timeout or CRC mismatch"""
+    pass
+
+
+class CrashDumpClient(object):
+    """Client of the EspSaveCrashDump protocol over a serial port"""
+
+    def __init__(self, port, timeout=2.0):
+        """
+        :param port:     opened port with read(size) and write(data)
+        :param timeout:  time in seconds to wait for each frame
+        """
+        self._port = port
+        self._timeout = timeout
+        self._sequence = 0
+
+    def list(self):
+        """
+        Get the index and size of each crash log, sorted by index
+
+        :returns: list of (index, size)
+        """
+        entries = []
+
+        for frame_type, payload in self._request(CMD_LIST):
+            if frame_type == RSP_ENTRY:
+                entries.append(struct.unpack('<II', payload))
+
+        return sorted(entries)
+
+    def fetch(self, index):
+        """
+        Get a single crash log
+
+        :returns: the content as bytes
+        """
+        for _, content in self._fetch(CMD_FETCH, struct.pack('<I', index)):
+            return content
+
+        raise CrashDumpError('crash log %u not received' % index)
+
+    def fetch_range(self, first, last):
+        """
+        Get all crash logs of an index range
+
+        :returns: generator of (index, content) in the order of the device
+        """
+        return self._fetch(CMD_FETCH_RANGE, struct.pack('<II', first, last))
+
+    def delete(self, first, last):
+        """
+        Remove all rotated crash logs of an index range, the current crash
+        log with index 1 is kept by the device
+
+        :returns: the number of removed crash logs
+        """
+        for frame_type, payload in self._request(CMD_DELETE, struct.pack('<II', first, last)):
+            if frame_type == RSP_END:
+                return struct.unpack('<I', payload)[0]
+
+        return 0
+
+    def _fetch(self, command, payload):
+        index = None
+        size = 0
+        content = bytearray()
+
+        for frame_type, frame_payload in self._request(command, payload):
+            if frame_type == RSP_FILE:
+                index, size = struct.unpack('<II', frame_payload)
+                content = bytearray()
+
+                if not size:
+                    yield index, b''
+                    index = None
+            elif frame_type == RSP_DATA:
+                content += frame_payload
+
+                if (index is not None) and (len(content) >= size):
+                    yield index, bytes(content)
+                    index = None
+
+    def _request(self, command, payload=b''):
+        """Send a request and yield the response frames up to the END frame"""
+        self._sequence = (self._sequence + 1) & 0xFF
+
+        header = struct.pack('<BBH', command, self._sequence, len(payload))
+        crc = zlib.crc32(header + payload) & 0xFFFFFFFF
+        self._port.write(bytes([SOF]) + header + payload + struct.pack('<I', crc))
+
+        while True:
+            frame_type, sequence, frame_payload = self._read_frame()
+
+            # skip answers of an earlier, timed out request
+            if sequence != self._sequence:
+                continue
+
+            if frame_type == RSP_ERROR:
+                raise CrashDumpError(ERRORS.get(frame_payload[0], 'error %u' % frame_payload[0]))
+
+            yield frame_type, frame_payload
+
+            if frame_type == RSP_END:
+                return
+
+    def _read_frame(self):
+        # skip everything before the start of a frame, e.g. debug output
+        while self._read(1)[0] != SOF:
+            pass
+
+        header = self._read(4)
+        frame_type, sequence, length = struct.unpack('<BBH', header)
+        payload = self._read(length)
+        crc = struct.unpack('<I', self._read(4))[0]
+
+        if crc != (zlib.crc32(header + payload) & 0xFFFFFFFF):
+            raise CrashDumpError('CRC mismatch of a response frame')
+
+        return frame_type, sequence, payload
+
+    def _read(self, size):
+        data = bytearray()
+        deadline = time.time() + self._timeout
+
+        while len(data) < size:
+            chunk = self._port.read(size - len(data))
+            if chunk:
+                data += chunk
+            elif time.time() > deadline:
+                raise CrashDumpError('timeout')
+
+        return bytes(data)
+
+
+def _save(output, pattern, extension, index, content):
+    path = os.path.join(output, '%s-%u.%s' % (pattern, index, extension))
+
+    with open(path, 'wb') as log_file:
+        log_file.write(content)
+
+    print('%s (%u byte)' % (path, len(content)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pull crash logs from an EspSaveCrashDump device')
+    parser.add_argument('-p', '--port', required=True, help='serial port, e.g. /dev/ttyUSB0')
+    parser.add_argument('-b', '--baudrate', type=int, default=115200, help='baudrate of the device')
+    parser.add_argument('-o', '--output', default='.', help='directory to save the crash logs to')
+    parser.add_argument('-n', '--pattern', default='crashLog', help='file pattern of the saved crash logs')
+    parser.add_argument('-e', '--extension', default='log', help='file extension of the saved crash logs')
+    parser.add_argument('command', choices=['list', 'fetch', 'fetch-range', 'delete'])
+    parser.add_argument('indexes', type=int, nargs='*', help='index, or first and last index')
+    args = parser.parse_args()
+
+    needed_indexes = {'list': 0, 'fetch': 1, 'fetch-range': 2, 'delete': 2}[args.command]
+    if len(args.indexes) != needed_indexes:
+        parser.error('%s needs %u indexes' % (args.command, needed_indexes))
+
+    import serial
+
+    port = serial.Serial(args.port, args.baudrate, timeout=0.1)
+    client = CrashDumpClient(port)
+
+    try:
+        if args.command == 'list':
+            for index, size in client.list():
+                print('%s-%u.%s %u' % (args.pattern, index, args.extension, size))
+        elif args.command == 'fetch':
+            _save(args.output, args.pattern, args.extension, args.indexes[0], client.fetch(args.indexes[0]))
+        elif args.command == 'fetch-range':
+            start = time.time()
+            count = 0
+            for index, content in client.fetch_range(args.indexes[0], args.indexes[1]):
+                _save(args.output, args.pattern, args.extension, index, content)
+                count += 1
+            print('%u crash logs in %.1f s' % (count, time.time() - start))
+        else:
+            print('%u crash logs removed' % client.delete(args.indexes[0], args.indexes[1]))
+    except CrashDumpError as error:
+        print('Error: %s' % error, file=sys.stderr)
+        return 1
+    finally:
+        port.close()
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+# -*- coding: UTF-8 -*-
+
+"""
+Loopback test of the host client and the frame codec of EspSaveCrashDump
+
+Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+File: test_crash_dump.py
+Revision: 0.1.0
+Date: 04-Jan-2020
+Author: brainelectronics
+
+The client talks over a socketpair to the dump device of extras/HostTest,
+which runs EspSaveCrashDump on the host. No pyserial is needed.
+
+Usage:
+  cd ../HostTest
+  g++ -std=c++11 -g -Wno-int-to-pointer-cast -Icore -I../../src DumpDevice.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o dump-device
+  cd ../CrashDump
+  python3 test_crash_dump.py
+
+Set CRASH_DUMP_DEVICE to use a dump device at another path.
+"""
+
+import os
+import shutil
+import socket
+import struct
+import subprocess
+import tempfile
+import time
+import unittest
+import zlib
+
+import crash_dump
+
+DEVICE = os.environ.get('CRASH_DUMP_DEVICE', os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'HostTest', 'dump-device'))
+
+# crash logs of the device, several DATA frames for index 3
+FILES = {
+    'crashLog-1.log': b'Crashed at 1200 ms\nRestart reason: 2\nException cause: 28\n',
+    'crashLog-2.log': b'Crashed at 800 ms\n',
+    'crashLog-3.log': bytes(range(256)) * 3,
+    'crashLog-5.log': b'',
+    'other.txt': b'no crash log\n',
+}
+
+
+class SocketPort(object):
+    """Port of the client on a socket, optionally corrupting a received byte"""
+
+    def __init__(self, sock):
+        self._sock = sock
+        self._sock.settimeout(0.1)
+        self.corrupt_at = None
+        self._received = 0
+
+    def read(self, size):
+        try:
+            data = bytearray(self._sock.recv(size))
+        except socket.timeout:
+            return b''
+
+        if (self.corrupt_at is not None) and (self._received <= self.corrupt_at < (self._received + len(data))):
+            data[self.corrupt_at - self._received] ^= 0xFF
+        self._received += len(data)
+
+        return bytes(data)
+
+    def write(self, data):
+        self._sock.sendall(data)
+
+
+def _frame(command, sequence, payload=b'', crc=None):
+    """Encode a request frame, with a given CRC to corrupt it"""
+    header = struct.pack('<BBH', command, sequence, len(payload))
+    if crc is None:
+        crc = zlib.crc32(header + payload) & 0xFFFFFFFF
+
+    return bytes([crash_dump.SOF]) + header + payload + struct.pack('<I', crc)
+
+
+@unittest.skipUnless(os.path.exists(DEVICE), 'dump device not built, see the usage')
+class CrashDumpLoopbackTest(unittest.TestCase):
+
+    def setUp(self):
+        self._directory = tempfile.mkdtemp()
+        paths = []
+        for name, content in sorted(FILES.items()):
+            path = os.path.join(self._directory, name)
+            with open(path, 'wb') as file:
+                file.write(content)
+            paths.append(path)
+
+        self._sock, device_sock = socket.socketpair()
+        self._device = subprocess.Popen([DEVICE] + paths, stdin=device_sock, stdout=device_sock)
+        device_sock.close()
+
+        self._port = SocketPort(self._sock)
+        self._client = crash_dump.CrashDumpClient(self._port)
+
+    def tearDown(self):
+        self._sock.close()
+        self._device.wait(5)
+        shutil.rmtree(self._directory)
+
+    def _raw_request(self, data):
+        """Send raw bytes and get the next response frame"""
+        self._port.write(data)
+
+        return self._client._read_frame()
+
+    def _crash_logs(self, *indexes):
+        return [(index, len(FILES['crashLog-%u.log' % index])) for index in indexes]
+
+    def test_list(self):
+        self.assertEqual(self._client.list(), self._crash_logs(1, 2, 3, 5))
+
+    def test_fetch(self):
+        for index in (1, 2, 3, 5):
+            self.assertEqual(self._client.fetch(index), FILES['crashLog-%u.log' % index])
+
+    def test_fetch_range(self):
+        logs = dict(self._client.fetch_range(2, 5))
+
+        self.assertEqual(sorted(logs), [2, 3, 5])
+        for index, content in logs.items():
+            self.assertEqual(content, FILES['crashLog-%u.log' % index])
+
+    def test_fetch_missing(self):
+        with self.assertRaisesRegex(crash_dump.CrashDumpError, 'not found'):
+            self._client.fetch(4)
+
+        # the client is in sync afterwards
+        self.assertEqual(self._client.fetch(2), FILES['crashLog-2.log'])
+
+    def test_delete_keeps_current(self):
+        self.assertEqual(self._client.delete(1, 3), 2)
+        self.assertEqual(self._client.list(), self._crash_logs(1, 5))
+        self.assertEqual(self._client.delete(1, 1), 0)
+        self.assertEqual(self._client.list(), self._crash_logs(1, 5))
+
+    def test_request_crc_mismatch(self):
+        frame_type, sequence, payload = self._raw_request(_frame(crash_dump.CMD_LIST, 7, crc=0x12345678))
+
+        self.assertEqual((frame_type, sequence, payload), (crash_dump.RSP_ERROR, 7, b'\x01'))
+
+    def test_unknown_command(self):
+        frame_type, sequence, payload = self._raw_request(_frame(0x42, 8))
+
+        self.assertEqual((frame_type, sequence, payload), (crash_dump.RSP_ERROR, 8, b'\x02'))
+
+    def test_invalid_length(self):
+        frame_type, _, payload = self._raw_request(_frame(crash_dump.CMD_FETCH, 9, struct.pack('<II', 1, 2)))
+        self.assertEqual((frame_type, payload), (crash_dump.RSP_ERROR, b'\x03'))
+
+        # longer than any request, answered right after the header
+        frame_type, _, payload = self._raw_request(_frame(crash_dump.CMD_LIST, 10, bytes(9))[:5])
+        self.assertEqual((frame_type, payload), (crash_dump.RSP_ERROR, b'\x03'))
+
+    def test_noise_before_request(self):
+        self._port.write(b'\x00garbage\xa4\n')
+
+        self.assertEqual(self._client.list(), self._crash_logs(1, 2, 3, 5))
+
+    def test_partial_request_dropped(self):
+        self._port.write(_frame(crash_dump.CMD_LIST, 11)[:4])
+        time.sleep(0.2)
+
+        self.assertEqual(self._client.list(), self._crash_logs(1, 2, 3, 5))
+
+    def test_response_crc_mismatch(self):
+        # a byte of the FILE frame of the fetched crash log, behind the
+        # debug output of the device
+        self._port.corrupt_at = len(b'Booting dump device\n') + 6
+
+        with self.assertRaisesRegex(crash_dump.CrashDumpError, 'CRC mismatch'):
+            self._client.fetch(2)
+
+    def test_codec_round_trip(self):
+        # each sequence number and a payload of each length
+        for sequence in (0, 1, 0x7F, 0xFF):
+            for length in range(0, 9):
+                payload = struct.pack('<II', 1, 5)[:length]
+                frame_type, response_sequence, _ = self._raw_request(_frame(crash_dump.CMD_FETCH_RANGE, sequence, payload))
+
+                self.assertEqual(response_sequence, sequence)
+                if length == 8:
+                    # FILE frames of the crash logs, up to the END frame
+                    while frame_type != crash_dump.RSP_END:
+                        frame_type, _, _ = self._client._read_frame()
+                else:
+                    self.assertEqual(frame_type, crash_dump.RSP_ERROR)
+
+
+if __name__ == '__main__':
+    unittest.main()
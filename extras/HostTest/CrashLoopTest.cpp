@@ -0,0 +1,249 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: CrashLoopTest.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Test of the crash loop detection, see EspSaveCrashLoop
+ *
+ * The window and the threshold are checked against the class alone. The
+ * boots are run through the crash store with the state kept in the RTC
+ * user memory, each crash updates it like the crash callback does.
+ *
+ * Build it from this directory:
+ *   g++ -std=c++11 -g -fsanitize=address,undefined -Wno-int-to-pointer-cast -Icore -I../../src CrashLoopTest.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o crash-loop-test
+ *   ./crash-loop-test
+ */
+
+#include "HostCore.h"
+#include "EspSaveCrashSpiffs.h"
+
+#if !CRASH_ENABLE_CRASHLOOP
+#error "Build the crash loop test with CRASH_ENABLE_CRASHLOOP"
+#endif
+
+#define LOOP_THRESHOLD  3
+#define LOOP_WINDOW_MS  30000
+
+extern EspSaveCrashSpiffs* pCrashStore;
+extern EspSaveCrashLoop* pCrashLoop;
+extern EspSaveCrashPolicy* pCrashPolicy;
+
+static unsigned long ulFailures;
+static uint32_t ulCallbackCount;
+
+/**
+ * @brief      Report a failed check and continue.
+ */
+#define LOOP_CHECK(condition, ...) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "Check failed at line %d: %s\n  ", __LINE__, #condition); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      ulFailures++; \
+    } \
+  } while (0)
+
+/**
+ * @brief      Boot with the given reset reason.
+ *
+ * @param      crashStore  The crash store
+ * @param[in]  ulReason    The reset reason
+ */
+static void _boot(EspSaveCrashSpiffs& crashStore, uint32_t ulReason)
+{
+  hostSetResetReason(ulReason);
+  crashStore.setCrashStore();
+}
+
+/**
+ * @brief      Crash after the given uptime, like the crash callback.
+ *
+ * @param[in]  ulCrashTime  The crash time
+ */
+static void _crash(uint32_t ulCrashTime)
+{
+  pCrashLoop->onCrash(ulCrashTime);
+  ESP.rtcUserMemoryWrite(CRASHLOOP_RTC_OFFSET, (uint32_t*)&pCrashLoop->state, sizeof(pCrashLoop->state));
+}
+
+/**
+ * @brief      Count the calls of the crash loop callback.
+ *
+ * @param[in]  ulCrashCount  The crash count
+ */
+static void _on_crash_loop(uint32_t ulCrashCount)
+{
+  ulCallbackCount = ulCrashCount;
+}
+
+/**
+ * @brief      Check the crashes inside and outside of the window.
+ */
+static void _test_window()
+{
+  EspSaveCrashLoop crashLoop(LOOP_THRESHOLD, LOOP_WINDOW_MS);
+
+  LOOP_CHECK(crashLoop.isValid() && !crashLoop.isDetected() && (crashLoop.getCrashCount() == 0), "reset: %u crashes", crashLoop.getCrashCount());
+
+  // the threshold is reached with the accumulated uptime right at the window
+  crashLoop.onCrash(10000);
+  crashLoop.onCrash(10000);
+  LOOP_CHECK(!crashLoop.isDetected() && (crashLoop.getCrashCount() == 2), "below threshold: %u crashes", crashLoop.getCrashCount());
+  crashLoop.onCrash(10000);
+  LOOP_CHECK(crashLoop.isDetected() && (crashLoop.getCrashCount() == 3), "threshold: %u crashes", crashLoop.getCrashCount());
+  crashLoop.onCrash(0);
+  LOOP_CHECK(crashLoop.isDetected() && (crashLoop.getCrashCount() == 4), "above threshold: %u crashes", crashLoop.getCrashCount());
+
+  // a crash beyond the window starts a new one
+  crashLoop.reset();
+  crashLoop.onCrash(5000);
+  crashLoop.onCrash(5000);
+  crashLoop.onCrash(20001);
+  LOOP_CHECK(!crashLoop.isDetected() && (crashLoop.getCrashCount() == 1), "outside window: %u crashes", crashLoop.getCrashCount());
+  LOOP_CHECK(crashLoop.state.ulWindowTime == 20001, "outside window: window time %u", crashLoop.state.ulWindowTime);
+
+  // an overflowing uptime does not wrap into the window
+  crashLoop.onCrash(UINT32_MAX);
+  LOOP_CHECK(!crashLoop.isDetected() && (crashLoop.getCrashCount() == 1), "overflow: %u crashes", crashLoop.getCrashCount());
+}
+
+/**
+ * @brief      Check the crash loop over several boots.
+ */
+static void _test_boots()
+{
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+
+  hostFsReset(SPIFFS);
+  hostRtcClear();
+  ulCallbackCount = 0;
+  crashStore.setCrashLoopCallback(_on_crash_loop);
+
+  // power on, then a crash loop right after boot
+  _boot(crashStore, REASON_DEFAULT_RST);
+  LOOP_CHECK(pCrashLoop && (crashStore.getCrashLoopCount() == 0), "power on: %u crashes", crashStore.getCrashLoopCount());
+  _crash(1000);
+  _boot(crashStore, REASON_EXCEPTION_RST);
+  _crash(1000);
+  _boot(crashStore, REASON_SOFT_WDT_RST);
+  LOOP_CHECK(!crashStore.isCrashLoop() && (ulCallbackCount == 0), "two crashes: callback with %u crashes", ulCallbackCount);
+  _crash(1000);
+  _boot(crashStore, REASON_EXCEPTION_RST);
+  LOOP_CHECK(crashStore.isCrashLoop() && (crashStore.getCrashLoopCount() == 3), "crash loop: %u crashes", crashStore.getCrashLoopCount());
+  LOOP_CHECK(ulCallbackCount == 3, "crash loop: callback with %u crashes", ulCallbackCount);
+
+  // a crash after a stable uptime ends the crash loop
+  ulCallbackCount = 0;
+  _crash(LOOP_WINDOW_MS + 1);
+  _boot(crashStore, REASON_EXCEPTION_RST);
+  LOOP_CHECK(!crashStore.isCrashLoop() && (crashStore.getCrashLoopCount() == 1), "stable uptime: %u crashes", crashStore.getCrashLoopCount());
+  LOOP_CHECK(ulCallbackCount == 0, "stable uptime: callback with %u crashes", ulCallbackCount);
+
+  // any restart not caused by a crash ends it as well
+  _crash(1000);
+  _crash(1000);
+  _crash(1000);
+  _boot(crashStore, REASON_EXCEPTION_RST);
+  LOOP_CHECK(crashStore.isCrashLoop(), "crash loop: %u crashes", crashStore.getCrashLoopCount());
+  _boot(crashStore, REASON_EXT_SYS_RST);
+  LOOP_CHECK(!crashStore.isCrashLoop() && (crashStore.getCrashLoopCount() == 0), "external reset: %u crashes", crashStore.getCrashLoopCount());
+
+  // clearing it is kept over the next crash reset
+  _crash(1000);
+  _crash(1000);
+  _crash(1000);
+  crashStore.clearCrashLoop();
+  _boot(crashStore, REASON_EXCEPTION_RST);
+  LOOP_CHECK(!crashStore.isCrashLoop() && (crashStore.getCrashLoopCount() == 0), "cleared: %u crashes", crashStore.getCrashLoopCount());
+
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+/**
+ * @brief      Check that a corrupted state is rejected.
+ */
+static void _test_corrupted_state()
+{
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+  EspSaveCrashLoop crashLoop(LOOP_THRESHOLD, LOOP_WINDOW_MS);
+  crash_loop_state_t state;
+
+  hostFsReset(SPIFFS);
+  hostRtcClear();
+
+  crashLoop.onCrash(1000);
+  crashLoop.onCrash(1000);
+  crashLoop.onCrash(1000);
+
+  // a single corrupted word is no crash loop, neither before nor after boot
+  for (uint32_t i = 0; i < (sizeof(state) / 4); i++)
+  {
+    EspSaveCrashLoop corrupted(LOOP_THRESHOLD, LOOP_WINDOW_MS);
+    corrupted.state = crashLoop.state;
+    ((uint32_t*)&corrupted.state)[i] ^= 0x00000100;
+    LOOP_CHECK(!corrupted.isValid() && !corrupted.isDetected() && (corrupted.getCrashCount() == 0), "corrupted word %u: %u crashes", i, corrupted.getCrashCount());
+
+    ESP.rtcUserMemoryWrite(CRASHLOOP_RTC_OFFSET, (uint32_t*)&corrupted.state, sizeof(corrupted.state));
+    _boot(crashStore, REASON_EXCEPTION_RST);
+    LOOP_CHECK(!crashStore.isCrashLoop() && (crashStore.getCrashLoopCount() == 0), "corrupted word %u: %u crashes after boot", i, crashStore.getCrashLoopCount());
+    ESP.rtcUserMemoryRead(CRASHLOOP_RTC_OFFSET, (uint32_t*)&state, sizeof(state));
+    LOOP_CHECK((state.ulMagic == CRASHLOOP_MAGIC) && (state.ulCrashCount == 0), "corrupted word %u: state not reset", i);
+  }
+
+  // a crash on top of a corrupted state starts a new window
+  EspSaveCrashLoop corrupted(LOOP_THRESHOLD, LOOP_WINDOW_MS);
+  corrupted.state = crashLoop.state;
+  corrupted.state.ulCrashCount = 100;
+  corrupted.onCrash(1000);
+  LOOP_CHECK(corrupted.isValid() && (corrupted.getCrashCount() == 1), "crash on corrupted state: %u crashes", corrupted.getCrashCount());
+
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+int main()
+{
+  _test_window();
+  _test_boots();
+  _test_corrupted_state();
+
+  if (ulFailures)
+  {
+    printf("%lu checks failed\n", ulFailures);
+    return 1;
+  }
+
+  printf("Crash loop window, threshold, resets and RTC state checked\n");
+
+  return 0;
+}
@@ -0,0 +1,204 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: DumpDevice.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Host device of the framed binary crash log transfer, see EspSaveCrashDump
+ *
+ * The given files are copied to the root directory of an in-memory SPIFFS,
+ * which is transferred by EspSaveCrashDump over stdin and stdout until
+ * stdin is closed. Some debug output is written before the first frame.
+ * Used by the loopback test of the host client in extras/CrashDump.
+ *
+ * Build from this directory:
+ *   g++ -std=c++11 -g -Wno-int-to-pointer-cast -Icore -I../../src DumpDevice.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o dump-device
+ *   ./dump-device crashLog-1.log crashLog-2.log
+ */
+
+#include "HostCore.h"
+#include "EspSaveCrashSpiffs.h"
+#include "EspSaveCrashDump.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/**
+ * Stream over a pair of file descriptors
+ */
+class FdStream : public Stream
+{
+  public:
+    FdStream(int iReadFd, int iWriteFd) : _iReadFd(iReadFd), _iWriteFd(iWriteFd), _iPeek(-1), _bClosed(false) {}
+
+    int available() override
+    {
+      if (_iPeek < 0)
+      {
+        _iPeek = _read_byte();
+      }
+
+      return (_iPeek < 0) ? 0 : 1;
+    }
+
+    int read() override
+    {
+      int iByte = (_iPeek < 0) ? _read_byte() : _iPeek;
+
+      _iPeek = -1;
+
+      return iByte;
+    }
+
+    int peek() override
+    {
+      available();
+
+      return _iPeek;
+    }
+
+    size_t write(uint8_t ubByte) override
+    {
+      return write(&ubByte, 1);
+    }
+
+    size_t write(const uint8_t* pubBuffer, size_t size) override
+    {
+      size_t written = 0;
+
+      while (written < size)
+      {
+        ssize_t result = ::write(_iWriteFd, pubBuffer + written, size - written);
+        if (result <= 0)
+        {
+          if ((result < 0) && (errno == EINTR))
+          {
+            continue;
+          }
+          break;
+        }
+        written += result;
+      }
+
+      return written;
+    }
+
+    using Print::write;
+
+    bool isClosed() const
+    {
+      return _bClosed && (_iPeek < 0);
+    }
+
+    /**
+     * @brief      Wait for the next byte.
+     *
+     * @param[in]  iTimeout  The timeout in ms
+     */
+    void wait(int iTimeout)
+    {
+      struct pollfd poller = {_iReadFd, POLLIN, 0};
+
+      if (!_bClosed && (_iPeek < 0))
+      {
+        poll(&poller, 1, iTimeout);
+      }
+    }
+  private:
+    int _read_byte()
+    {
+      uint8_t ubByte;
+      struct pollfd poller = {_iReadFd, POLLIN, 0};
+
+      if (_bClosed || (poll(&poller, 1, 0) <= 0))
+      {
+        return -1;
+      }
+
+      ssize_t result = ::read(_iReadFd, &ubByte, 1);
+      if (result <= 0)
+      {
+        // the host has closed the connection
+        _bClosed = (result == 0) || (errno != EINTR && errno != EAGAIN);
+        return -1;
+      }
+
+      return ubByte;
+    }
+
+    int _iReadFd;
+    int _iWriteFd;
+    int _iPeek;
+    bool _bClosed;
+};
+
+int main(int argc, char** argv)
+{
+  hostFsReset(SPIFFS);
+  hostRtcClear();
+  hostSetResetReason(REASON_DEFAULT_RST);
+
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+
+  // copy the files after begin(), the current crash log is not rotated
+  for (int i = 1; i < argc; i++)
+  {
+    std::ifstream file(argv[i], std::ios::binary);
+    std::stringstream content;
+    std::string path(argv[i]);
+
+    if (!file)
+    {
+      fprintf(stderr, "Can not open '%s'\n", argv[i]);
+      return 1;
+    }
+    content << file.rdbuf();
+
+    size_t nameStart = path.find_last_of('/');
+    hostFsWrite(SPIFFS, "/" + path.substr((nameStart == std::string::npos) ? 0 : (nameStart + 1)), content.str());
+  }
+
+  FdStream stream(STDIN_FILENO, STDOUT_FILENO);
+  EspSaveCrashDump crashDump(crashStore, stream);
+
+  // debug output on the same interface is skipped by the host
+  stream.print("Booting dump device\n");
+
+  while (!stream.isClosed())
+  {
+    stream.wait(10);
+    crashDump.handle();
+  }
+
+  return 0;
+}
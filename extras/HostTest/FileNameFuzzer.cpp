@@ -0,0 +1,944 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: FileNameFuzzer.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Fuzz and property test of the crash log rotation, listing and removal
+ *
+ * Each input is turned into a set of files, malformed, overlong and
+ * overflowing names included, and a sequence of operations on the crash
+ * store. After each operation the in-memory filesystem is compared with a
+ * reference model of the expected files:
+ *  - the rotation renames the current log to the highest index + 1, also
+ *    if the next crash log is created while rotating
+ *  - the removal functions remove exactly the selected crash logs, never
+ *    the current '-1' log and never any other file
+ *  - the latest crash log name is kept up to date
+ *  - readSince returns all rotated crash logs in the order of their index,
+ *    at most maxBytes per call
+ *
+ * Build and run with libFuzzer (clang) from this directory:
+ *   clang++ -std=c++11 -g -fsanitize=fuzzer,address,undefined -Wno-int-to-pointer-cast -Icore -I../../src FileNameFuzzer.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o file-name-fuzzer
+ *   ./file-name-fuzzer
+ *
+ * Build and run with random inputs (g++ or clang++):
+ *   g++ -std=c++11 -g -fsanitize=address,undefined -DFUZZ_STANDALONE -Wno-int-to-pointer-cast -Icore -I../../src FileNameFuzzer.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o file-name-fuzzer
+ *   ./file-name-fuzzer [iterations] [seed]
+ *
+ * A failing input is printed as hex. Both builds replay inputs given as file
+ * arguments.
+ */
+
+#include "HostCore.h"
+#include "EspSaveCrashSpiffs.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// maximum number of operations and created files per input
+#define FUZZ_MAX_OPERATIONS  48
+#define FUZZ_MAX_FILES       48
+
+// highest crash log index, see CRASH_MAX_FILE_INDEX
+#define FUZZ_MAX_FILE_INDEX  4294967289ULL
+
+extern EspSaveCrashSpiffs* pCrashStore;
+extern EspSaveCrashLoop* pCrashLoop;
+extern EspSaveCrashPolicy* pCrashPolicy;
+
+/**
+ * Reader of the fuzz input, returns zeros after the end
+ */
+class FuzzInput
+{
+  public:
+    FuzzInput(const uint8_t* pubData, size_t size) : _pubData(pubData), _size(size), _position(0) {}
+
+    bool empty() const { return _position >= _size; }
+    uint8_t byte() { return empty() ? 0 : _pubData[_position++]; }
+    uint32_t u32()
+    {
+      uint32_t ulValue = 0;
+      for (uint8_t i = 0; i < 4; i++)
+      {
+        ulValue = (ulValue << 8) | byte();
+      }
+      return ulValue;
+    }
+  private:
+    const uint8_t* _pubData;
+    size_t _size;
+    size_t _position;
+};
+
+/**
+ * Configuration of the crash store under test
+ */
+struct FuzzStore
+{
+  FS* fileSystem;
+  bool bSpiffsNames;
+  const char* directoryName;
+  const char* filePattern;
+  const char* fileExtension;
+};
+
+static const FuzzStore pStores[] = {
+  {&SPIFFS, true, "/", CRASHFILEPATTERN, CRASHFILEEXTENSION},
+  {&SPIFFS, true, "/c/", "e", "x"},
+  {&LittleFS, false, "/", CRASHFILEPATTERN, CRASHFILEEXTENSION},
+  {&LittleFS, false, "/crash/", CRASHFILEPATTERN, CRASHFILEEXTENSION}
+};
+
+// chars used to mutate file names
+static const char pcNameChars[] = "crashLogex0123456789-._/ ~";
+
+/**
+ * Reference of the expected filesystem content
+ */
+typedef std::map<std::string, std::string> FuzzFiles;
+
+static const FuzzStore* pStore;
+static std::string lastNamePath;
+static std::string indexPath;
+static std::string currentPath;
+
+/**
+ * @brief      Stop with the failed property.
+ */
+#define FUZZ_CHECK(condition, ...) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "Property failed at line %d: %s\n  ", __LINE__, #condition); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      abort(); \
+    } \
+  } while (0)
+
+/**
+ * @brief      Reference of the crash log index of a file name.
+ *
+ * @param[in]  name          The name without the directory
+ * @param      pulFileIndex  The file index
+ *
+ * @retval     True   The file is a crash log
+ * @retval     False  Some other file
+ */
+static bool _reference_index(const std::string& name, uint32_t* pulFileIndex)
+{
+  std::string prefix = std::string(pStore->filePattern) + "-";
+  std::string suffix = std::string(".") + pStore->fileExtension;
+  uint64_t ullIndex = 0;
+
+  if ((name.size() >= (CRASH_NAME_BUFFER_SIZE - CRASHFILEPATH_SIZE)) || (name.size() < (prefix.size() + suffix.size() + 1)))
+  {
+    return false;
+  }
+  if ((name.compare(0, prefix.size(), prefix) != 0) || (name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0))
+  {
+    return false;
+  }
+
+  for (size_t i = prefix.size(); i < (name.size() - suffix.size()); i++)
+  {
+    if ((name[i] < '0') || (name[i] > '9'))
+    {
+      return false;
+    }
+    ullIndex = std::min<uint64_t>((ullIndex * 10) + (name[i] - '0'), FUZZ_MAX_FILE_INDEX + 1);
+  }
+
+  if ((ullIndex == 0) || (ullIndex > FUZZ_MAX_FILE_INDEX))
+  {
+    return false;
+  }
+
+  *pulFileIndex = (uint32_t)ullIndex;
+
+  return true;
+}
+
+/**
+ * @brief      Gets the name of a file directly in the crash log directory.
+ *
+ * @param[in]  path  The path
+ * @param      name  The name
+ *
+ * @retval     True   The file is directly in the crash log directory
+ * @retval     False  Some other file
+ */
+static bool _reference_name(const std::string& path, std::string* name)
+{
+  std::string directory(pStore->directoryName);
+
+  if ((path.compare(0, directory.size(), directory) != 0) || (path.find('/', directory.size()) != std::string::npos))
+  {
+    return false;
+  }
+
+  *name = path.substr(directory.size());
+
+  return true;
+}
+
+/**
+ * @brief      Gets the canonical path of a crash log.
+ *
+ * @param[in]  ulFileIndex  The file index
+ *
+ * @return     The path
+ */
+static std::string _crash_log_path(uint64_t ullFileIndex)
+{
+  return std::string(pStore->directoryName) + pStore->filePattern + "-" + std::to_string(ullFileIndex) + "." + pStore->fileExtension;
+}
+
+/**
+ * @brief      Gets the directory listing in the order of the filesystem.
+ *
+ * @return     The entries as returned by Dir::fileName()
+ */
+static std::vector<std::string> _list_directory()
+{
+  std::vector<std::string> entries;
+  Dir thisDirectory = pStore->fileSystem->openDir(pStore->directoryName);
+
+  while (thisDirectory.next())
+  {
+    entries.push_back(thisDirectory.fileName().c_str());
+  }
+
+  return entries;
+}
+
+/**
+ * @brief      Gets the path of a directory entry.
+ *
+ * @param[in]  entry  The entry as returned by Dir::fileName()
+ *
+ * @return     The path
+ */
+static std::string _entry_path(const std::string& entry)
+{
+  return pStore->bSpiffsNames ? entry : (std::string(pStore->directoryName) + entry);
+}
+
+/**
+ * @brief      Reference of the latest crash log.
+ *
+ * The first crash log with the highest index in the listing order.
+ *
+ * @param      pulLatestIndex  The latest index, zero if there is none
+ *
+ * @return     The path, the directory name if there is no crash log
+ */
+static std::string _reference_latest(uint32_t* pulLatestIndex = NULL)
+{
+  std::string latestPath(pStore->directoryName);
+  uint32_t ulLatestIndex = 0;
+  FuzzFiles files;
+
+  for (const HostFileEntry& file : hostFsFiles(*pStore->fileSystem))
+  {
+    files[file.path] = file.content;
+  }
+
+  for (const std::string& entry : _list_directory())
+  {
+    std::string path = _entry_path(entry);
+    std::string name;
+    uint32_t ulFileIndex;
+
+    if (files.count(path) && _reference_name(path, &name) && _reference_index(name, &ulFileIndex) && (ulFileIndex > ulLatestIndex))
+    {
+      ulLatestIndex = ulFileIndex;
+      latestPath = path;
+    }
+  }
+
+  if (pulLatestIndex)
+  {
+    *pulLatestIndex = ulLatestIndex;
+  }
+
+  return latestPath;
+}
+
+/**
+ * @brief      Gets the current files, without the files managed by the store.
+ *
+ * @return     The files
+ */
+static FuzzFiles _get_files()
+{
+  FuzzFiles files;
+
+  for (const HostFileEntry& file : hostFsFiles(*pStore->fileSystem))
+  {
+    if ((file.path != lastNamePath) && (file.path != indexPath))
+    {
+      files[file.path] = file.content;
+    }
+  }
+
+  return files;
+}
+
+/**
+ * @brief      Compare the filesystem with the reference.
+ *
+ * @param[in]  expected    The expected files
+ * @param[in]  operation   The name of the operation
+ */
+static void _check_files(const FuzzFiles& expected, const char* operation)
+{
+  FuzzFiles actual = _get_files();
+
+  for (const auto& file : expected)
+  {
+    auto found = actual.find(file.first);
+    FUZZ_CHECK(found != actual.end(), "%s: '%s' is missing", operation, file.first.c_str());
+    FUZZ_CHECK(found->second == file.second, "%s: '%s' has been modified", operation, file.first.c_str());
+  }
+  for (const auto& file : actual)
+  {
+    FUZZ_CHECK(expected.count(file.first), "%s: '%s' is unexpected", operation, file.first.c_str());
+  }
+}
+
+/**
+ * @brief      Check the name of the latest crash log.
+ *
+ * @param[in]  operation  The name of the operation
+ */
+static void _check_last_name(const char* operation)
+{
+  std::string lastName;
+  std::string latestPath = _reference_latest();
+
+  FUZZ_CHECK(hostFsRead(*pStore->fileSystem, lastNamePath, &lastName), "%s: no latest crash log name", operation);
+  FUZZ_CHECK(lastName == latestPath, "%s: latest crash log is '%s' instead of '%s'", operation, lastName.c_str(), latestPath.c_str());
+}
+
+/**
+ * @brief      Create a file name out of the input.
+ *
+ * @param      input  The input
+ *
+ * @return     The name without the directory
+ */
+static std::string _make_name(FuzzInput& input)
+{
+  std::string prefix = std::string(pStore->filePattern) + "-";
+  std::string suffix = std::string(".") + pStore->fileExtension;
+  std::string name;
+
+  switch (input.byte() % 6)
+  {
+    case 0:
+      // small index
+      name = prefix + std::to_string(input.byte() % 24) + suffix;
+      break;
+    case 1:
+      // any index, including the ones close to the overflow
+      name = prefix + std::to_string((input.byte() & 1) ? (FUZZ_MAX_FILE_INDEX - (input.byte() % 12)) : input.u32()) + suffix;
+      break;
+    case 2:
+    {
+      // leading zeros or too many digits
+      uint8_t ubDigits = input.byte() % 32;
+      name = prefix;
+      for (uint8_t i = 0; i <= ubDigits; i++)
+      {
+        name += (char)('0' + (input.byte() % 10));
+      }
+      name += suffix;
+      break;
+    }
+    case 3:
+    {
+      // mutated crash log name
+      name = prefix + std::to_string(input.byte() % 24) + suffix;
+      uint8_t ubMutations = 1 + (input.byte() % 4);
+      for (uint8_t i = 0; i < ubMutations; i++)
+      {
+        size_t position = input.byte() % (name.size() + 1);
+        char c = pcNameChars[input.byte() % (sizeof(pcNameChars) - 1)];
+
+        switch (input.byte() % 3)
+        {
+          case 0:
+            name.insert(position, 1, c);
+            break;
+          case 1:
+            if (position < name.size())
+            {
+              name[position] = c;
+            }
+            break;
+          default:
+            if (position < name.size())
+            {
+              name.erase(position, 1);
+            }
+            break;
+        }
+      }
+      break;
+    }
+    case 4:
+    {
+      // long name, up to the name limit of LittleFS and beyond
+      size_t length = 150 + (input.byte() * 2);
+      name = prefix + std::string(length, '0') + "7" + suffix;
+      if (input.byte() & 1)
+      {
+        name = std::string(length, 'x');
+      }
+      break;
+    }
+    default:
+    {
+      // any bytes
+      uint8_t ubLength = 1 + (input.byte() % 40);
+      for (uint8_t i = 0; i < ubLength; i++)
+      {
+        char c = (char)input.byte();
+        name += c ? c : '_';
+      }
+      break;
+    }
+  }
+
+  return name;
+}
+
+/**
+ * @brief      Create content of a file out of the input.
+ *
+ * @param      input  The input
+ *
+ * @return     The content
+ */
+static std::string _make_content(FuzzInput& input)
+{
+  std::string content;
+  uint8_t ubLines = input.byte() % 6;
+
+  for (uint8_t i = 0; i < ubLines; i++)
+  {
+    content += "line " + std::to_string(input.byte()) + std::string(input.byte() % 80, '.') + "\n";
+  }
+  if (input.byte() & 1)
+  {
+    // no line end at the end
+    content += "tail";
+  }
+
+  return content;
+}
+
+/**
+ * @brief      Read all rotated crash logs with readSince.
+ *
+ * @param      cursor    The cursor
+ * @param[in]  maxBytes  The maximum number of bytes per call
+ *
+ * @return     The content
+ */
+static std::string _read_since(crash_cursor_t* cursor, size_t maxBytes)
+{
+  class StringPrint : public Print
+  {
+    public:
+      std::string content;
+      size_t write(uint8_t ubByte) override { content += (char)ubByte; return 1; }
+      size_t write(const uint8_t* pubBuffer, size_t size) override { content.append((const char*)pubBuffer, size); return size; }
+  };
+
+  StringPrint output;
+  size_t calls = 0;
+  size_t printed;
+
+  while ((printed = pCrashStore->readSince(cursor, output, maxBytes)))
+  {
+    FUZZ_CHECK(++calls < 100000, "readSince does not make progress");
+    FUZZ_CHECK(printed <= maxBytes, "readSince(%zu): printed %zu bytes", maxBytes, printed);
+  }
+
+  return output.content;
+}
+
+/**
+ * @brief      Reference of the content of all rotated crash logs.
+ *
+ * @param[in]  ulAfterIndex  Only crash logs with a higher index
+ *
+ * @return     The content
+ */
+static std::string _reference_read(uint32_t ulAfterIndex)
+{
+  std::map<uint32_t, std::string> logs;
+
+  for (const auto& file : _get_files())
+  {
+    std::string name;
+    uint32_t ulFileIndex;
+
+    // only the files with the canonical name can be read
+    if (_reference_name(file.first, &name) && _reference_index(name, &ulFileIndex) && (ulFileIndex >= 2) && (ulFileIndex > ulAfterIndex) && (file.first == _crash_log_path(ulFileIndex)))
+    {
+      logs[ulFileIndex] = file.second;
+    }
+  }
+
+  std::string content;
+  for (const auto& log : logs)
+  {
+    content += log.second;
+  }
+
+  return content;
+}
+
+/**
+ * @brief      Filter of removeMatching, keeps a pseudo random selection.
+ */
+static bool _filter_selected(uint32_t ulFileIndex, const char* filePath, void* context)
+{
+  uint32_t ulSelection = *(uint32_t*)context;
+
+  return (ulSelection >> (ulFileIndex % 32)) & 1;
+}
+
+/**
+ * @brief      Expect the removal of the selected crash logs.
+ *
+ * @param      expected    The expected files
+ * @param[in]  selected    Return true for a selected crash log index
+ *
+ * @return     The number of removed crash logs
+ */
+template <typename Selected>
+static uint32_t _expect_removal(FuzzFiles& expected, Selected selected)
+{
+  uint32_t ulRemoved = 0;
+
+  for (auto file = expected.begin(); file != expected.end();)
+  {
+    std::string name;
+    uint32_t ulFileIndex;
+
+    if (_reference_name(file->first, &name) && _reference_index(name, &ulFileIndex) && (ulFileIndex >= 2) && selected(ulFileIndex))
+    {
+      file = expected.erase(file);
+      ulRemoved++;
+    }
+    else
+    {
+      ++file;
+    }
+  }
+
+  return ulRemoved;
+}
+
+/**
+ * @brief      Rotate the current crash log and check the result.
+ *
+ * With a pending asynchronous rotation, the next crash log may be created
+ * after the directory has been crawled, e.g. by the compactor.
+ *
+ * @param[in]  ubOptions  The options of begin()
+ * @param[in]  bRace      Create the next crash log while rotating
+ */
+static void _check_rotation(uint8_t ubOptions, bool bRace)
+{
+  FuzzFiles expected = _get_files();
+  uint32_t ulLatestIndex = 0;
+  std::string lastName;
+  bool bLastName = hostFsRead(*pStore->fileSystem, lastNamePath, &lastName);
+  std::string racePath;
+
+  _reference_latest(&ulLatestIndex);
+
+  // a current log has at least the index 1
+  if (expected.count(currentPath) && (ulLatestIndex < FUZZ_MAX_FILE_INDEX))
+  {
+    if (bRace && (ubOptions & CRASH_BEGIN_ASYNC_ROTATE) && ((ulLatestIndex + 1) < FUZZ_MAX_FILE_INDEX))
+    {
+      racePath = _crash_log_path((uint64_t)ulLatestIndex + 1);
+      expected[racePath] = "raced";
+      ulLatestIndex++;
+    }
+
+    std::string nextPath = _crash_log_path((uint64_t)ulLatestIndex + 1);
+
+    expected[nextPath] = expected[currentPath];
+    expected.erase(currentPath);
+    bLastName = true;
+    lastName = nextPath;
+  }
+
+  pCrashStore->begin(ubOptions);
+  if (!racePath.empty())
+  {
+    // the directory listing has already been opened by begin()
+    hostFsWrite(*pStore->fileSystem, racePath, "raced");
+  }
+  while (pCrashStore->rotateAsync());
+  FUZZ_CHECK(!pCrashStore->isRotateFailed(), "rotation: renaming failed");
+
+  _check_files(expected, "rotation");
+
+  if (bLastName)
+  {
+    std::string actual;
+    FUZZ_CHECK(hostFsRead(*pStore->fileSystem, lastNamePath, &actual) && (actual == lastName), "rotation: latest crash log is '%s' instead of '%s'", actual.c_str(), lastName.c_str());
+  }
+}
+
+/**
+ * @brief      Run the operations of a single input.
+ *
+ * @param[in]  pubData  The data
+ * @param[in]  size     The size
+ */
+static void _run(const uint8_t* pubData, size_t size)
+{
+  FuzzInput input(pubData, size);
+
+  pStore = &pStores[input.byte() % (sizeof(pStores) / sizeof(pStores[0]))];
+  hostFsReset(*pStore->fileSystem, HOST_FS_TOTAL_BYTES, input.u32());
+  hostRtcClear();
+  hostSetResetReason(REASON_DEFAULT_RST);
+
+  lastNamePath = std::string(pStore->directoryName) + LASTCRASHFILENAME;
+  indexPath = std::string(pStore->directoryName) + CRASHINDEXFILENAME;
+  currentPath = _crash_log_path(1);
+
+  EspSaveCrashSpiffs crashStore(*pStore->fileSystem, pStore->directoryName, pStore->filePattern, pStore->fileExtension);
+
+  // each input starts without an active crash store
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+  FUZZ_CHECK(pCrashStore == &crashStore, "begin: crash store not set");
+
+  uint8_t ubFiles = 0;
+
+  for (uint8_t ubOperation = 0; (ubOperation < FUZZ_MAX_OPERATIONS) && !input.empty(); ubOperation++)
+  {
+    uint8_t ubCode = input.byte() % 11;
+
+    switch (ubCode)
+    {
+      case 0:
+      case 1:
+      {
+        // some file in the crash log directory or in a sub directory
+        if (ubFiles++ >= FUZZ_MAX_FILES)
+        {
+          break;
+        }
+        std::string name = _make_name(input);
+        uint32_t ulFileIndex;
+
+        // a LittleFS directory named like a crash log is listed like one,
+        // this is not supported
+        if (!pStore->bSpiffsNames && (name.find('/') != std::string::npos) && _reference_index(name.substr(0, name.find('/')), &ulFileIndex))
+        {
+          name.insert(0, "d");
+        }
+
+        hostFsWrite(*pStore->fileSystem, std::string(pStore->directoryName) + name, _make_content(input));
+        break;
+      }
+      case 2:
+        // a crash saved to the current log
+        hostFsWrite(*pStore->fileSystem, currentPath, _make_content(input));
+        break;
+      case 3:
+      {
+        uint8_t ubRotation = input.byte();
+        _check_rotation(CRASH_BEGIN_NO_MOUNT | ((ubRotation & 1) ? CRASH_BEGIN_ASYNC_ROTATE : 0), (ubRotation & 2) != 0);
+        break;
+      }
+      case 4:
+      {
+        // rotate some other file, like a split crash log
+        std::string segmentPath = std::string(pStore->directoryName) + "seg.tmp";
+        std::string content = _make_content(input);
+        FuzzFiles expected = _get_files();
+        uint32_t ulLatestIndex;
+        char* nextFilePath = crashBufferAlloc();
+
+        _reference_latest(&ulLatestIndex);
+        hostFsWrite(*pStore->fileSystem, segmentPath, content);
+        bool bRotated = crashStore.rotateFile(segmentPath.c_str(), nextFilePath, pStore->directoryName, pStore->filePattern, pStore->fileExtension);
+
+        // rotateFile needs a crash log to find the next name
+        if (ulLatestIndex && (ulLatestIndex < FUZZ_MAX_FILE_INDEX))
+        {
+          std::string nextPath = _crash_log_path((uint64_t)ulLatestIndex + 1);
+          FUZZ_CHECK(bRotated && (nextPath == nextFilePath), "rotateFile: '%s' instead of '%s'", nextFilePath, nextPath.c_str());
+          expected[nextPath] = content;
+        }
+        else
+        {
+          FUZZ_CHECK(!bRotated, "rotateFile: rotated without a next name");
+          expected[segmentPath] = content;
+        }
+        crashBufferFree(nextFilePath);
+
+        _check_files(expected, "rotateFile");
+        pStore->fileSystem->remove(segmentPath.c_str());
+        break;
+      }
+      case 5:
+      {
+        // remove by the position in the directory listing
+        std::vector<std::string> entries = _list_directory();
+        uint32_t ulFileNumber = input.byte() % (entries.size() + 2);
+        FuzzFiles expected = _get_files();
+        std::string latestPath = _reference_latest();
+        bool bExpected = false;
+        bool bLatest = false;
+        std::string removedPath;
+
+        if (!ulFileNumber)
+        {
+          bExpected = expected.count(currentPath) > 0;
+          removedPath = currentPath;
+          bLatest = bExpected;
+        }
+        else if (ulFileNumber <= entries.size())
+        {
+          std::string name;
+
+          removedPath = _entry_path(entries[ulFileNumber - 1]);
+
+          // a file in a sub directory or a path longer than the name buffer
+          bExpected = _reference_name(removedPath, &name) && (removedPath.size() < CRASH_NAME_BUFFER_SIZE);
+          bLatest = bExpected && (removedPath == latestPath);
+        }
+
+        if (bExpected)
+        {
+          expected.erase(removedPath);
+        }
+
+        bool bResult = crashStore.removeFile(ulFileNumber);
+        FUZZ_CHECK(bResult == bExpected, "removeFile(%u): %d instead of %d for '%s'", ulFileNumber, bResult, bExpected, removedPath.c_str());
+        _check_files(expected, "removeFile");
+        if (bLatest)
+        {
+          _check_last_name("removeFile");
+        }
+        break;
+      }
+      case 6:
+      {
+        uint32_t ulFirstIndex = (input.byte() & 1) ? input.u32() : (input.byte() % 24);
+        uint32_t ulLastIndex = (input.byte() & 1) ? input.u32() : (input.byte() % 24);
+        FuzzFiles expected = _get_files();
+        uint32_t ulExpected = _expect_removal(expected, [&](uint32_t ulFileIndex) { return (ulFileIndex >= ulFirstIndex) && (ulFileIndex <= ulLastIndex); });
+
+        uint32_t ulRemoved = crashStore.removeRange(ulFirstIndex, ulLastIndex);
+        FUZZ_CHECK(ulRemoved == ulExpected, "removeRange(%u, %u): %u instead of %u", ulFirstIndex, ulLastIndex, ulRemoved, ulExpected);
+        _check_files(expected, "removeRange");
+        if (ulRemoved)
+        {
+          _check_last_name("removeRange");
+        }
+        break;
+      }
+      case 7:
+      {
+        uint32_t ulFileIndex = input.byte() % 24;
+        FuzzFiles expected = _get_files();
+        uint32_t ulExpected = _expect_removal(expected, [&](uint32_t ulThisFileIndex) { return ulThisFileIndex < ulFileIndex; });
+
+        uint32_t ulRemoved = crashStore.removeOlderThan(ulFileIndex);
+        FUZZ_CHECK(ulRemoved == ulExpected, "removeOlderThan(%u): %u instead of %u", ulFileIndex, ulRemoved, ulExpected);
+        _check_files(expected, "removeOlderThan");
+        if (ulRemoved)
+        {
+          _check_last_name("removeOlderThan");
+        }
+        break;
+      }
+      case 8:
+      {
+        uint32_t ulSelection = input.u32();
+        FuzzFiles expected = _get_files();
+        uint32_t ulExpected = _expect_removal(expected, [&](uint32_t ulFileIndex) { return _filter_selected(ulFileIndex, NULL, &ulSelection); });
+
+        uint32_t ulRemoved = crashStore.removeMatching(_filter_selected, &ulSelection);
+        FUZZ_CHECK(ulRemoved == ulExpected, "removeMatching: %u instead of %u", ulRemoved, ulExpected);
+        _check_files(expected, "removeMatching");
+        if (ulRemoved)
+        {
+          _check_last_name("removeMatching");
+        }
+        break;
+      }
+      case 9:
+      {
+        // read everything, then only a new crash log
+        crash_cursor_t cursor = {0, 0};
+        size_t maxBytes = 1 + (input.byte() * 4);
+        std::string expected = _reference_read(0);
+        std::string actual = _read_since(&cursor, maxBytes);
+        uint32_t ulLatestIndex;
+
+        FUZZ_CHECK(actual == expected, "readSince(%zu): %zu bytes instead of %zu", maxBytes, actual.size(), expected.size());
+
+        _reference_latest(&ulLatestIndex);
+        if ((ulLatestIndex >= 1) && (ulLatestIndex < FUZZ_MAX_FILE_INDEX))
+        {
+          std::string content = _make_content(input);
+          hostFsWrite(*pStore->fileSystem, _crash_log_path((uint64_t)ulLatestIndex + 1), content);
+
+          actual = _read_since(&cursor, maxBytes);
+          FUZZ_CHECK(actual == content, "readSince(%zu): %zu new bytes instead of %zu", maxBytes, actual.size(), content.size());
+        }
+        break;
+      }
+      default:
+      {
+        // listing, the array is sized like the examples do
+        uint32_t ulFiles = crashStore.getNumberOfFiles(NULL);
+        uint32_t ulLongest = crashStore.getLongestFileName(NULL);
+        FuzzFiles expected = _get_files();
+
+        FUZZ_CHECK(ulFiles == _list_directory().size(), "getNumberOfFiles: %u instead of %zu", ulFiles, _list_directory().size());
+
+        uint8_t ubArraySize = std::min(ulFiles, (uint32_t)(input.byte() % 64));
+        std::vector<std::vector<char>> fileList(ubArraySize, std::vector<char>(ulLongest + 1));
+        std::vector<char*> ppcFileList;
+        for (auto& entry : fileList)
+        {
+          ppcFileList.push_back(entry.data());
+        }
+
+        crashStore.getFileList(NULL, ppcFileList.data(), ubArraySize);
+        crashStore.count(NULL, (char*)pStore->fileExtension);
+        _check_files(expected, "listing");
+        break;
+      }
+    }
+  }
+
+  crashStore.getFileSystem().end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* pubData, size_t size)
+{
+  _run(pubData, size);
+
+  return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+/**
+ * @brief      Run a file as input.
+ *
+ * @param[in]  path  The path
+ */
+static void _run_file(const char* path)
+{
+  FILE* file = fopen(path, "rb");
+  std::vector<uint8_t> data;
+  int iChar;
+
+  if (!file)
+  {
+    fprintf(stderr, "Can not open '%s'\n", path);
+    exit(1);
+  }
+  while ((iChar = fgetc(file)) != EOF)
+  {
+    data.push_back((uint8_t)iChar);
+  }
+  fclose(file);
+
+  _run(data.data(), data.size());
+}
+
+int main(int argc, char** argv)
+{
+  if ((argc > 1) && (argv[1][0] < '0' || argv[1][0] > '9'))
+  {
+    for (int i = 1; i < argc; i++)
+    {
+      _run_file(argv[i]);
+    }
+    printf("Replayed %d inputs\n", argc - 1);
+    return 0;
+  }
+
+  unsigned long ulIterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : 20000;
+  unsigned long ulSeed = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1;
+  std::mt19937 random(ulSeed);
+
+  for (unsigned long i = 0; i < ulIterations; i++)
+  {
+    std::vector<uint8_t> data(random() % 512);
+    for (uint8_t& ubByte : data)
+    {
+      ubByte = (uint8_t)random();
+    }
+
+    // print the input before it runs, to reproduce a failure
+    if (getenv("FUZZ_VERBOSE"))
+    {
+      for (uint8_t ubByte : data)
+      {
+        fprintf(stderr, "%02x", ubByte);
+      }
+      fprintf(stderr, "\n");
+    }
+
+    _run(data.data(), data.size());
+  }
+
+  printf("Passed %lu inputs with seed %lu\n", ulIterations, ulSeed);
+
+  return 0;
+}
+#endif
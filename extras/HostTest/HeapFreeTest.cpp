@@ -0,0 +1,430 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: HeapFreeTest.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Test of the heap free mode, see CRASH_HEAP_FREE
+ *
+ * The crash capture, the rotation, the listing, the printing and the
+ * removal of the crash logs must not allocate any heap memory. All
+ * allocations of the code under test are counted, allocations within the
+ * stand-in core, e.g. the String of Dir::fileName(), are not. With all
+ * scratch buffers of the arena in use, each function has to fail cleanly
+ * without touching the crash logs.
+ *
+ * The allocations are counted by replacing malloc of the glibc, so build it
+ * without sanitizers on Linux from this directory:
+ *   g++ -std=c++11 -g -DCRASH_HEAP_FREE=1 -Wno-int-to-pointer-cast -Icore -I../../src HeapFreeTest.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o heap-free-test
+ *   ./heap-free-test
+ */
+
+#include "HostCore.h"
+#include "EspSaveCrashSpiffs.h"
+#include "EspSaveCrashCompactor.h"
+
+#include <sys/mman.h>
+
+#include <string>
+#include <vector>
+
+#if !CRASH_HEAP_FREE
+#error "Build the heap free test with -DCRASH_HEAP_FREE=1"
+#endif
+
+// address of the stack given to the crash callback, within the data RAM
+#define HEAP_STACK_ADDRESS  0x3FFFE000
+#define HEAP_STACK_BYTES    0x100
+
+// size of the file list given to getFileList
+#define HEAP_LIST_FILES  16
+
+extern EspSaveCrashSpiffs* pCrashStore;
+extern EspSaveCrashLoop* pCrashLoop;
+extern EspSaveCrashPolicy* pCrashPolicy;
+
+extern "C" void custom_crash_callback(struct rst_info* rst_info, uint32_t stack, uint32_t stack_end);
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pvMemory, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void* pvMemory);
+
+static bool bCounting;
+static unsigned long ulAllocations;
+static unsigned long ulFailures;
+
+/**
+ * @brief      Count an allocation of the code under test.
+ */
+static void _count_allocation()
+{
+  if (bCounting && (hostCoreDepth == 0))
+  {
+    ulAllocations++;
+  }
+}
+
+extern "C" void* malloc(size_t size)
+{
+  _count_allocation();
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+  _count_allocation();
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pvMemory, size_t size)
+{
+  _count_allocation();
+  return __libc_realloc(pvMemory, size);
+}
+
+extern "C" int posix_memalign(void** ppvMemory, size_t alignment, size_t size)
+{
+  _count_allocation();
+  *ppvMemory = __libc_memalign(alignment, size);
+  return *ppvMemory ? 0 : 12;
+}
+
+extern "C" void free(void* pvMemory)
+{
+  __libc_free(pvMemory);
+}
+
+/**
+ * @brief      Report a failed check and continue.
+ */
+#define HEAP_CHECK(condition, ...) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "Check failed at line %d: %s\n  ", __LINE__, #condition); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      ulFailures++; \
+    } \
+  } while (0)
+
+/**
+ * Output discarding all content, without any allocation
+ */
+class NullPrint : public Print
+{
+  public:
+    size_t write(uint8_t ubByte) override { return 1; }
+    size_t write(const uint8_t* pubBuffer, size_t size) override { return size; }
+};
+
+/**
+ * @brief      Start counting the allocations.
+ */
+static void _start_counting()
+{
+  ulAllocations = 0;
+  bCounting = true;
+}
+
+/**
+ * @brief      Stop counting and check that nothing has been allocated.
+ *
+ * @param[in]  pcOperation  The name of the counted operations
+ */
+static void _check_no_allocation(const char* pcOperation)
+{
+  bCounting = false;
+  HEAP_CHECK(ulAllocations == 0, "%s: %lu heap allocations", pcOperation, ulAllocations);
+}
+
+/**
+ * @brief      Get a crash record as saved by the crash callback.
+ *
+ * @param[in]  ulCrashTime  The crash time
+ *
+ * @return     The crash record
+ */
+static std::string _make_record(uint32_t ulCrashTime)
+{
+  char pcRecord[128];
+
+  snprintf(pcRecord, sizeof(pcRecord), "Crashed at %u ms\nRestart reason: 2\nException cause: 28\nBuild: test\n>>>stack>>>\n<<<stack<<<\n", ulCrashTime);
+
+  return std::string(pcRecord);
+}
+
+/**
+ * @brief      Create the rotated crash logs 2 to 5.
+ *
+ * @param      fileSystem     The file system
+ * @param[in]  directoryName  The directory name
+ */
+static void _create_crash_logs(FS& fileSystem, const std::string& directoryName)
+{
+  for (uint32_t i = 2; i <= 5; i++)
+  {
+    hostFsWrite(fileSystem, directoryName + CRASHFILEPATTERN "-" + std::to_string(i) + "." CRASHFILEEXTENSION, _make_record(i * 100));
+  }
+
+  // a crash log with two records, split by the compactor
+  hostFsWrite(fileSystem, directoryName + CRASHFILEPATTERN "-6." CRASHFILEEXTENSION, _make_record(600) + _make_record(601));
+}
+
+/**
+ * @brief      Crash into the crash callback with some stack.
+ */
+static void _crash()
+{
+  // only the faulting data address is readable on the host
+  struct rst_info info = {REASON_EXCEPTION_RST, 28, 0, 0, 0, HEAP_STACK_ADDRESS + 0x10, 0};
+
+  custom_crash_callback(&info, HEAP_STACK_ADDRESS, HEAP_STACK_ADDRESS + HEAP_STACK_BYTES);
+}
+
+/**
+ * @brief      Check all functions of the crash store for heap allocations.
+ *
+ * @param      fileSystem     The file system
+ * @param[in]  directoryName  The directory name
+ */
+static void _test_no_allocation(FS& fileSystem, const char* directoryName)
+{
+  std::string directory(directoryName);
+  std::string currentPath = directory + CRASHFILEPATTERN "-1." CRASHFILEEXTENSION;
+  NullPrint output;
+
+  hostFsReset(fileSystem);
+  hostRtcClear();
+  hostSetResetReason(REASON_DEFAULT_RST);
+  _create_crash_logs(fileSystem, directory);
+
+  EspSaveCrashSpiffs crashStore(fileSystem, directoryName);
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+
+  _start_counting();
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+  crashStore.rebuildIndex();
+  _check_no_allocation("begin");
+
+  _start_counting();
+  _crash();
+  _check_no_allocation("crash capture");
+  HEAP_CHECK(hostFsRead(fileSystem, currentPath, NULL), "%s: no crash log saved", currentPath.c_str());
+
+  _start_counting();
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+  _check_no_allocation("rotation");
+  HEAP_CHECK(!hostFsRead(fileSystem, currentPath, NULL), "%s: not rotated", currentPath.c_str());
+
+  _crash();
+  _start_counting();
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT | CRASH_BEGIN_ASYNC_ROTATE);
+  while (crashStore.rotateAsync());
+  _check_no_allocation("asynchronous rotation");
+  HEAP_CHECK(!hostFsRead(fileSystem, currentPath, NULL), "%s: not rotated", currentPath.c_str());
+
+  EspSaveCrashCompactor compactor(crashStore);
+  _start_counting();
+  while (compactor.handle(10));
+  _check_no_allocation("compaction");
+  HEAP_CHECK(compactor.getSplitFiles() == 2, "compaction: %u split files", compactor.getSplitFiles());
+
+  // the array given to getFileList is allocated by the caller
+  std::vector<std::vector<char>> files(HEAP_LIST_FILES, std::vector<char>(CRASH_NAME_BUFFER_SIZE));
+  std::vector<char*> fileList;
+  for (auto& file : files)
+  {
+    fileList.push_back(file.data());
+  }
+
+  _start_counting();
+  uint32_t ulFiles = crashStore.getNumberOfFiles((char*)directoryName);
+  uint32_t ulLongest = crashStore.getLongestFileName((char*)directoryName);
+  crashStore.getFileList((char*)directoryName, fileList.data(), HEAP_LIST_FILES);
+  crashStore.count((char*)directoryName, (char*)CRASHFILEPATTERN);
+  _check_no_allocation("listing");
+  HEAP_CHECK(ulFiles >= 8, "listing: %u files", ulFiles);
+  HEAP_CHECK(ulLongest < CRASH_NAME_BUFFER_SIZE, "listing: longest file name %u", ulLongest);
+
+  uint32_t pulFileIndexes[16];
+  crash_cursor_t cursor = {0, 0};
+  std::string latestPath = directory + CRASHFILEPATTERN "-2." CRASHFILEEXTENSION;
+
+  _start_counting();
+  bool bPrinted = crashStore.print(latestPath.c_str(), output);
+  while (crashStore.readSince(&cursor, output, 64));
+  crashStore.getBuildFiles("test", pulFileIndexes, 16);
+  _check_no_allocation("printing");
+  HEAP_CHECK(bPrinted, "printing: %s not printed", latestPath.c_str());
+
+  _start_counting();
+  crashStore.removeFile(1);
+  crashStore.removeRange(2, 3);
+  crashStore.removeOlderThan(5);
+  crashStore.removeMatching([](uint32_t ulFileIndex, const char* filePath, void* context) { return (ulFileIndex % 2) == 0; });
+  crashStore.removeFile(0);
+  _check_no_allocation("removal");
+
+  HEAP_CHECK(crashBufferGetPeak() <= CRASH_ARENA_BUFFERS, "arena: peak of %u buffers", crashBufferGetPeak());
+
+  fileSystem.end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+/**
+ * @brief      Check that all functions fail cleanly without a scratch buffer.
+ *
+ * With some buffers left, the functions fail at different allocations and
+ * have to return without a crash. Without any buffer left, no function may
+ * touch the files.
+ *
+ * @param      fileSystem     The file system
+ * @param[in]  directoryName  The directory name
+ * @param[in]  ubFreeBuffers  The number of buffers left in the arena
+ */
+static void _test_arena_exhausted(FS& fileSystem, const char* directoryName, uint8_t ubFreeBuffers)
+{
+  std::string directory(directoryName);
+  std::string currentPath = directory + CRASHFILEPATTERN "-1." CRASHFILEEXTENSION;
+  std::string otherPath = directory + "other.txt";
+  char* ppcBuffers[CRASH_ARENA_BUFFERS];
+  NullPrint output;
+
+  hostFsReset(fileSystem);
+  hostRtcClear();
+  hostSetResetReason(REASON_DEFAULT_RST);
+  _create_crash_logs(fileSystem, directory);
+
+  EspSaveCrashSpiffs crashStore(fileSystem, directoryName);
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+  crashStore.rebuildIndex();
+  _crash();
+  hostFsWrite(fileSystem, otherPath, "other");
+
+  std::vector<HostFileEntry> before = hostFsFiles(fileSystem);
+
+  // use up the arena
+  for (uint8_t i = 0; i < (CRASH_ARENA_BUFFERS - ubFreeBuffers); i++)
+  {
+    ppcBuffers[i] = crashBufferAlloc();
+    HEAP_CHECK(ppcBuffers[i], "arena: buffer %u not available", i);
+  }
+
+  uint32_t pulFileIndexes[16];
+  crash_cursor_t cursor = {0, 0};
+  std::string latestPath = directory + CRASHFILEPATTERN "-2." CRASHFILEEXTENSION;
+  std::string rotatePath = directory + "rotate.tmp";
+
+  hostFsWrite(fileSystem, rotatePath, _make_record(700));
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+  bool bRotated = crashStore.rotateFile(rotatePath.c_str(), NULL, directoryName, CRASHFILEPATTERN, CRASHFILEEXTENSION);
+  bool bPrinted = crashStore.print(latestPath.c_str(), output);
+  size_t printed = crashStore.readSince(&cursor, output, 64);
+  uint32_t ulBuildFiles = crashStore.getBuildFiles("test", pulFileIndexes, 16);
+  uint32_t ulIndexed = crashStore.rebuildIndex();
+
+  EspSaveCrashCompactor compactor(crashStore);
+  while (compactor.handle(10));
+
+  bool bRemoved = crashStore.removeFile(1);
+  uint32_t ulRemoved = crashStore.removeRange(2, 3) + crashStore.removeOlderThan(5);
+  ulRemoved += crashStore.removeMatching([](uint32_t ulFileIndex, const char* filePath, void* context) { return true; });
+
+  if (!ubFreeBuffers)
+  {
+    HEAP_CHECK(!bRotated, "rotateFile: succeeded");
+    HEAP_CHECK(!bPrinted, "print: succeeded");
+    HEAP_CHECK(printed == 0, "readSince: printed %zu bytes", printed);
+    HEAP_CHECK(ulBuildFiles == 0, "getBuildFiles: %u files", ulBuildFiles);
+    HEAP_CHECK(ulIndexed == 0, "rebuildIndex: %u files", ulIndexed);
+    HEAP_CHECK(compactor.getSplitFiles() == 0, "compaction: %u split files", compactor.getSplitFiles());
+    HEAP_CHECK(!bRemoved, "removeFile: succeeded");
+    HEAP_CHECK(ulRemoved == 0, "removal: %u files", ulRemoved);
+
+    fileSystem.remove(rotatePath.c_str());
+
+    std::vector<HostFileEntry> after = hostFsFiles(fileSystem);
+    HEAP_CHECK(before.size() == after.size(), "arena: %zu files before, %zu after", before.size(), after.size());
+    for (size_t i = 0; (i < before.size()) && (i < after.size()); i++)
+    {
+      HEAP_CHECK((before[i].path == after[i].path) && (before[i].content == after[i].content), "arena: %s changed", before[i].path.c_str());
+    }
+  }
+
+  for (uint8_t i = 0; i < (CRASH_ARENA_BUFFERS - ubFreeBuffers); i++)
+  {
+    crashBufferFree(ppcBuffers[i]);
+  }
+
+  fileSystem.end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+int main()
+{
+  // the stack of the crash callback at an address of the ESP8266 data RAM
+  void* pvStack = mmap((void*)HEAP_STACK_ADDRESS, 0x1000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  if (pvStack != (void*)HEAP_STACK_ADDRESS)
+  {
+    fprintf(stderr, "Can not map the stack at 0x%08x\n", HEAP_STACK_ADDRESS);
+    return 1;
+  }
+  for (uint32_t i = 0; i < (HEAP_STACK_BYTES / 4); i++)
+  {
+    ((uint32_t*)pvStack)[i] = 0x40200000 + (i * 4);
+  }
+
+  _test_no_allocation(SPIFFS, "/");
+  _test_no_allocation(LittleFS, "/crash/");
+  for (uint8_t i = 0; i <= CRASH_ARENA_BUFFERS; i++)
+  {
+    _test_arena_exhausted(SPIFFS, "/", i);
+    _test_arena_exhausted(LittleFS, "/crash/", i);
+  }
+
+  if (ulFailures)
+  {
+    printf("%lu checks failed\n", ulFailures);
+    return 1;
+  }
+
+  printf("No heap allocations, all functions fail cleanly without buffers\n");
+
+  return 0;
+}
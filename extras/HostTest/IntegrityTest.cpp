@@ -0,0 +1,405 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: IntegrityTest.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Test of the integrity check of the crash records, see EspSaveCrashVerifier
+ *
+ * Valid, corrupted and truncated records are checked against the verifier
+ * alone, fed line by line and in small pieces. print() has to flag each
+ * corrupted and each truncated record of a crash log, a record cut by the
+ * end of the file included.
+ *
+ * Build it from this directory:
+ *   g++ -std=c++11 -O2 -g -fsanitize=address,undefined -Wno-int-to-pointer-cast -Icore -I../../src IntegrityTest.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o integrity-test
+ *   ./integrity-test
+ *
+ * With the argument "bench" it measures the throughput of crashCrc32() and
+ * of print() on the in-memory filesystem instead, build it without
+ * sanitizers for this.
+ */
+
+#include "HostCore.h"
+#include "EspSaveCrashSpiffs.h"
+#include "EspSaveCrashRecord.h"
+
+#include <chrono>
+#include <string>
+
+#if !CRASH_ENABLE_CRC
+#error "Build the integrity test with CRASH_ENABLE_CRC"
+#endif
+
+#define INTEGRITY_TRUNCATED  "!!! CRC missing, the record above is truncated !!!\n"
+#define INTEGRITY_CORRUPTED  "!!! CRC mismatch, the record above is corrupted !!!\n"
+
+// size of the buffer and number of runs of the CRC benchmark
+#define INTEGRITY_BENCH_BYTES  (64 * 1024)
+#define INTEGRITY_BENCH_RUNS   256
+
+// number of records of the print() benchmark
+#define INTEGRITY_BENCH_RECORDS  64
+
+extern EspSaveCrashSpiffs* pCrashStore;
+extern EspSaveCrashLoop* pCrashLoop;
+extern EspSaveCrashPolicy* pCrashPolicy;
+
+static unsigned long ulFailures;
+
+/**
+ * @brief      Report a failed check and continue.
+ */
+#define INTEGRITY_CHECK(condition, ...) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "Check failed at line %d: %s\n  ", __LINE__, #condition); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      ulFailures++; \
+    } \
+  } while (0)
+
+/**
+ * Output collecting everything printed
+ */
+class StringPrint : public Print
+{
+  public:
+    size_t write(uint8_t ubByte) override { content += (char)ubByte; return 1; }
+    size_t write(const uint8_t* pubBuffer, size_t size) override { content.append((const char*)pubBuffer, size); return size; }
+
+    std::string content;
+};
+
+/**
+ * Output discarding all content
+ */
+class NullPrint : public Print
+{
+  public:
+    size_t write(uint8_t ubByte) override { return 1; }
+    size_t write(const uint8_t* pubBuffer, size_t size) override { return size; }
+};
+
+/**
+ * @brief      Get the lines of a record up to the CRC line.
+ *
+ * @param[in]  ulCrashTime  The crash time
+ *
+ * @return     The lines covered by the CRC
+ */
+static std::string _make_record_body(uint32_t ulCrashTime)
+{
+  char pcRecord[256];
+
+  snprintf(pcRecord, sizeof(pcRecord), "Crashed at %u ms\nRestart reason: 2\nException cause: 28\nBuild: test\nepc1=0x40201234 epc2=0x00000000 epc3=0x00000000 excvaddr=0x00000000 depc=0x00000000\n>>>stack>>>\n3ffffdd0:  40201234 3ffe8a2c 00000000 4020a0b8\n", ulCrashTime);
+
+  return std::string(pcRecord);
+}
+
+/**
+ * @brief      Get a record as saved by the crash callback.
+ *
+ * @param[in]  ulCrashTime  The crash time
+ * @param[in]  bCorrupted   Flip a bit after the CRC has been calculated
+ *
+ * @return     The record
+ */
+static std::string _make_record(uint32_t ulCrashTime, bool bCorrupted = false)
+{
+  std::string body = _make_record_body(ulCrashTime);
+  char pcCrc[32];
+
+  snprintf(pcCrc, sizeof(pcCrc), "CRC: %08x\n", crashCrc32(0, body.data(), body.size()));
+  if (bCorrupted)
+  {
+    body[body.find("28")] ^= 0x01;
+  }
+
+  return body + pcCrc + "<<<stack<<<\n\n";
+}
+
+/**
+ * @brief      Feed a text to the verifier in pieces.
+ *
+ * @param      verifier    The verifier
+ * @param[in]  text        The text
+ * @param[in]  pieceSize   The maximum size of each piece, 0 for lines
+ * @param      pulResults  The number of results per crashIntegrity_t
+ */
+static void _feed(EspSaveCrashVerifier& verifier, const std::string& text, size_t pieceSize, uint32_t* pulResults)
+{
+  size_t position = 0;
+
+  while (position < text.size())
+  {
+    size_t length = text.find('\n', position) - position + 1;
+    if (text.find('\n', position) == std::string::npos)
+    {
+      length = text.size() - position;
+    }
+    if (pieceSize && (length > pieceSize))
+    {
+      length = pieceSize;
+    }
+
+    pulResults[verifier.parseLine(text.substr(position, length).c_str())]++;
+    position += length;
+  }
+}
+
+/**
+ * @brief      Check a crash log with the verifier.
+ *
+ * @param[in]  text        The crash log
+ * @param[in]  ulValid     The expected valid records
+ * @param[in]  ulInvalid   The expected corrupted records
+ * @param[in]  ulTruncated The expected truncated records
+ * @param[in]  ulLine      The line of the caller
+ */
+static void _check_verifier(const std::string& text, uint32_t ulValid, uint32_t ulInvalid, uint32_t ulTruncated, uint32_t ulLine)
+{
+  // the markers at the start of a line have to be within the first piece
+  static const size_t pPieceSizes[] = {0, 16, 23};
+
+  for (size_t pieceSize : pPieceSizes)
+  {
+    EspSaveCrashVerifier verifier;
+    uint32_t pulResults[CRASH_INTEGRITY_TRUNCATED + 1] = {0};
+
+    _feed(verifier, text, pieceSize, pulResults);
+    pulResults[verifier.finish()]++;
+
+    INTEGRITY_CHECK((pulResults[CRASH_INTEGRITY_VALID] == ulValid) && (verifier.getValidRecords() == ulValid), "line %u, pieces of %zu: %u valid records", ulLine, pieceSize, verifier.getValidRecords());
+    INTEGRITY_CHECK((pulResults[CRASH_INTEGRITY_INVALID] == ulInvalid) && (verifier.getInvalidRecords() == ulInvalid), "line %u, pieces of %zu: %u corrupted records", ulLine, pieceSize, verifier.getInvalidRecords());
+    INTEGRITY_CHECK((pulResults[CRASH_INTEGRITY_TRUNCATED] == ulTruncated) && (verifier.getTruncatedRecords() == ulTruncated), "line %u, pieces of %zu: %u truncated records", ulLine, pieceSize, verifier.getTruncatedRecords());
+
+    // nothing is left open
+    INTEGRITY_CHECK(verifier.finish() == CRASH_INTEGRITY_NONE, "line %u, pieces of %zu: finished twice", ulLine, pieceSize);
+  }
+}
+
+/**
+ * @brief      Check valid, corrupted and truncated records.
+ */
+static void _test_verifier()
+{
+  std::string body = _make_record_body(1000);
+
+  _check_verifier("", 0, 0, 0, __LINE__);
+  _check_verifier(_make_record(1000), 1, 0, 0, __LINE__);
+  _check_verifier(_make_record(1000, true), 0, 1, 0, __LINE__);
+  _check_verifier("boot\n" + _make_record(1000) + "other\n" + _make_record(2000) + "\r\n", 2, 0, 0, __LINE__);
+
+  // a record of an older version of this library has no CRC
+  _check_verifier(body + "<<<stack<<<\n\n", 0, 0, 0, __LINE__);
+
+  // cut by the end of the file, within a line or right after it
+  _check_verifier(body, 0, 0, 1, __LINE__);
+  _check_verifier(body.substr(0, body.size() - 5), 0, 0, 1, __LINE__);
+  _check_verifier("Crashed at 1000 ms", 0, 0, 1, __LINE__);
+
+  // cut by the next record, which is still checked
+  _check_verifier(body + _make_record(2000), 1, 0, 1, __LINE__);
+  _check_verifier(body + body + _make_record(3000, true) + body, 0, 1, 3, __LINE__);
+
+  // a cut CRC line does not match
+  std::string record = _make_record(1000);
+  _check_verifier(record.substr(0, record.find("CRC: ") + 8) + "\n", 0, 1, 0, __LINE__);
+
+  // "Crashed at" within a line does not start a record
+  _check_verifier("log: Crashed at 5 ms\n", 0, 0, 0, __LINE__);
+}
+
+/**
+ * @brief      Check the records flagged by print().
+ *
+ * @param      fileSystem     The file system
+ * @param[in]  directoryName  The directory name
+ */
+static void _test_print(FS& fileSystem, const char* directoryName)
+{
+  std::string path = std::string(directoryName) + CRASHFILEPATTERN "-2." CRASHFILEEXTENSION;
+  std::string body = _make_record_body(2000);
+
+  hostFsReset(fileSystem);
+  hostRtcClear();
+  hostSetResetReason(REASON_DEFAULT_RST);
+
+  EspSaveCrashSpiffs crashStore(fileSystem, directoryName);
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+
+  // the flags follow the record they refer to
+  std::string content = _make_record(1000) + body + _make_record(3000, true) + _make_record(4000) + body;
+  std::string expected = _make_record(1000) + body + INTEGRITY_TRUNCATED + _make_record(3000, true).substr(0, _make_record(3000).find("<<<stack<<<")) + INTEGRITY_CORRUPTED + "<<<stack<<<\n\n" + _make_record(4000) + body + INTEGRITY_TRUNCATED;
+
+  hostFsWrite(fileSystem, path, content);
+  StringPrint output;
+  INTEGRITY_CHECK(crashStore.print(path.c_str(), output), "%s: not printed", path.c_str());
+  INTEGRITY_CHECK(output.content == expected, "%s: printed\n%s\ninstead of\n%s", path.c_str(), output.content.c_str(), expected.c_str());
+
+  // a line longer than the line buffer, cut by the end of the file
+  std::string longLine = body + "Breadcrumbs:" + std::string(CRASH_NAME_BUFFER_SIZE * 3, ' ');
+  hostFsWrite(fileSystem, path, longLine);
+  output.content.clear();
+  crashStore.print(path.c_str(), output);
+  INTEGRITY_CHECK(output.content == (longLine + INTEGRITY_TRUNCATED), "%s: long line printed as %zu bytes", path.c_str(), output.content.size());
+
+  // intact records are printed unchanged
+  hostFsWrite(fileSystem, path, _make_record(1000) + _make_record(2000));
+  output.content.clear();
+  crashStore.print(path.c_str(), output);
+  INTEGRITY_CHECK(output.content == (_make_record(1000) + _make_record(2000)), "%s: intact records changed", path.c_str());
+
+  fileSystem.end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+/**
+ * @brief      Check the integrity of the records returned by the parser.
+ */
+static void _test_parser()
+{
+  EspSaveCrashRecordParser parser;
+  std::string content = _make_record(1000) + _make_record_body(2000) + _make_record(3000, true) + _make_record_body(4000);
+  uint32_t pulIntegrity[CRASH_INTEGRITY_TRUNCATED + 1] = {0};
+  uint32_t ulIncomplete = 0;
+  size_t position = 0;
+
+  while (position < content.size())
+  {
+    size_t length = content.find('\n', position) - position + 1;
+
+    if (parser.parseLine(content.substr(position, length).c_str()))
+    {
+      pulIntegrity[parser.getRecord().integrity]++;
+      ulIncomplete += parser.getRecord().bComplete ? 0 : 1;
+    }
+    position += length;
+  }
+  if (parser.finish())
+  {
+    pulIntegrity[parser.getRecord().integrity]++;
+    ulIncomplete += parser.getRecord().bComplete ? 0 : 1;
+  }
+
+  // truncated records are returned as incomplete, without a CRC result
+  INTEGRITY_CHECK(parser.getRecordCount() == 4, "parser: %u records", parser.getRecordCount());
+  INTEGRITY_CHECK((pulIntegrity[CRASH_INTEGRITY_VALID] == 1) && (pulIntegrity[CRASH_INTEGRITY_INVALID] == 1) && (pulIntegrity[CRASH_INTEGRITY_NONE] == 2), "parser: %u valid, %u corrupted, %u without CRC", pulIntegrity[CRASH_INTEGRITY_VALID], pulIntegrity[CRASH_INTEGRITY_INVALID], pulIntegrity[CRASH_INTEGRITY_NONE]);
+  INTEGRITY_CHECK(ulIncomplete == 2, "parser: %u incomplete records", ulIncomplete);
+  INTEGRITY_CHECK(parser.getVerifier().getTruncatedRecords() == 2, "parser: %u truncated records", parser.getVerifier().getTruncatedRecords());
+}
+
+/**
+ * @brief      Prints the result of a benchmark run.
+ *
+ * @param[in]  pcName      The name of the run
+ * @param[in]  ullBytes    The number of processed bytes
+ * @param[in]  ullDuration The duration in us
+ */
+static void _print_result(const char* pcName, uint64_t ullBytes, uint64_t ullDuration)
+{
+  printf("%s: %llu byte in %llu us, %llu MB/s\n", pcName, (unsigned long long)ullBytes, (unsigned long long)ullDuration, (unsigned long long)(ullBytes / (ullDuration ? ullDuration : 1)));
+}
+
+/**
+ * @brief      Measure the throughput of the CRC and of print().
+ */
+static void _run_benchmark()
+{
+  std::string buffer(INTEGRITY_BENCH_BYTES, '\0');
+  uint32_t ulCrc = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < INTEGRITY_BENCH_RUNS; i++)
+  {
+    ulCrc = crashCrc32(ulCrc, buffer.data(), buffer.size());
+  }
+  uint64_t ullDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  _print_result("crashCrc32", (uint64_t)INTEGRITY_BENCH_BYTES * INTEGRITY_BENCH_RUNS, ullDuration);
+
+  std::string path = "/" CRASHFILEPATTERN "-2." CRASHFILEEXTENSION;
+  std::string content;
+  for (uint32_t i = 0; i < INTEGRITY_BENCH_RECORDS; i++)
+  {
+    content += _make_record(i);
+  }
+
+  hostFsReset(SPIFFS);
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+  pCrashStore = NULL;
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+  hostFsWrite(SPIFFS, path, content);
+
+  NullPrint output;
+  start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < INTEGRITY_BENCH_RUNS; i++)
+  {
+    crashStore.print(path.c_str(), output);
+  }
+  ullDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  _print_result("print() with CRC check", (uint64_t)content.size() * INTEGRITY_BENCH_RUNS, ullDuration);
+
+  // keep the CRC from being optimized away
+  printf("CRC: %08x\n", ulCrc);
+
+  SPIFFS.end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+int main(int argc, char** argv)
+{
+  if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+  {
+    _run_benchmark();
+    return 0;
+  }
+
+  _test_verifier();
+  _test_print(SPIFFS, "/");
+  _test_print(LittleFS, "/crash/");
+  _test_parser();
+
+  if (ulFailures)
+  {
+    printf("%lu checks failed\n", ulFailures);
+    return 1;
+  }
+
+  printf("Valid, corrupted and truncated records checked\n");
+
+  return 0;
+}
@@ -0,0 +1,296 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: LoggerTest.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Test of the buffered event log, see EspSaveCrashLogger
+ *
+ * Lines of all lengths are logged with staging buffers of several sizes,
+ * below CRASHLOGGER_MIN_BUFFER_SIZE included. Each line has to end up
+ * complete in the log file, only a line longer than the whole staging
+ * buffer is truncated, and nothing is written outside of the buffer.
+ *
+ * Build it from this directory:
+ *   g++ -std=c++11 -O2 -g -fsanitize=address,undefined -Wno-int-to-pointer-cast -Icore -I../../src LoggerTest.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o logger-test
+ *   ASAN_OPTIONS=detect_leaks=0 ./logger-test
+ *
+ * The staging buffer is never freed, like on the device, so the leak check
+ * is disabled.
+ *
+ * With the argument "bench" it measures the messages per second of the
+ * logger and of saveToSpiffsFile on the in-memory filesystem instead, build
+ * it without sanitizers for this.
+ */
+
+#include "HostCore.h"
+#include "EspSaveCrashSpiffs.h"
+#include "EspSaveCrashLogger.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// number of messages of each benchmark run, like the LoggerBenchmark example
+#define LOGGER_BENCH_MESSAGES  200
+
+// number of benchmark runs
+#define LOGGER_BENCH_RUNS  100
+
+extern EspSaveCrashSpiffs* pCrashStore;
+extern EspSaveCrashLoop* pCrashLoop;
+extern EspSaveCrashPolicy* pCrashPolicy;
+
+static unsigned long ulFailures;
+
+/**
+ * @brief      Report a failed check and continue.
+ */
+#define LOGGER_CHECK(condition, ...) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "Check failed at line %d: %s\n  ", __LINE__, #condition); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      ulFailures++; \
+    } \
+  } while (0)
+
+/**
+ * @brief      Get the messages of the log file without time and level.
+ *
+ * @param[in]  content  The content of the log file
+ *
+ * @return     The messages
+ */
+static std::vector<std::string> _get_messages(const std::string& content)
+{
+  std::vector<std::string> messages;
+  size_t position = 0;
+
+  while (position < content.size())
+  {
+    size_t end = content.find('\n', position);
+    if (end == std::string::npos)
+    {
+      messages.push_back("<no line end>");
+      break;
+    }
+
+    // '<millis> I <message>'
+    std::string line = content.substr(position, end - position);
+    size_t start = line.find(" I ");
+    messages.push_back((start == std::string::npos) ? ("<no level> " + line) : line.substr(start + 3));
+    position = end + 1;
+  }
+
+  return messages;
+}
+
+/**
+ * @brief      Log lines of all lengths with the given staging buffer.
+ *
+ * @param[in]  uwBufferSize  The size of the staging buffer
+ */
+static void _test_buffer_size(uint16_t uwBufferSize)
+{
+  uint16_t uwActualSize = std::max(uwBufferSize, (uint16_t)CRASHLOGGER_MIN_BUFFER_SIZE);
+#if CRASH_HEAP_FREE
+  uwActualSize = std::min(uwActualSize, (uint16_t)CRASHLOGGER_BUFFER_SIZE);
+#endif
+  std::vector<std::string> expected;
+  std::string logPath = "/" CRASHLOGGER_FILEPATTERN "-1." CRASHFILEEXTENSION;
+
+  hostFsReset(SPIFFS);
+  hostRtcClear();
+  hostSetResetReason(REASON_DEFAULT_RST);
+
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+
+  EspSaveCrashLogger logger(crashStore, CRASHLOGGER_FILEPATTERN, uwBufferSize);
+  LOGGER_CHECK(logger.begin(), "buffer of %u: begin failed", uwBufferSize);
+  logger.setMaxFileSize(UINT32_MAX);
+
+  // the time prefix takes up to 13 chars, the line end one more
+  for (uint16_t uwLength = 0; uwLength < (uwActualSize + 20); uwLength += 3)
+  {
+    std::string message(uwLength, (char)('a' + (uwLength % 26)));
+
+    LOGGER_CHECK(logger.log(CRASH_LOG_INFO, "%s", message.c_str()), "buffer of %u: line of %u dropped", uwBufferSize, uwLength);
+    expected.push_back(message);
+
+    // a line with its own line end is terminated only once
+    logger.log(CRASH_LOG_INFO, "%s\n", message.c_str());
+    expected.push_back(message);
+  }
+  logger.flush();
+
+  std::string content;
+  hostFsRead(SPIFFS, logPath, &content);
+  std::vector<std::string> messages = _get_messages(content);
+
+  LOGGER_CHECK(messages.size() == expected.size(), "buffer of %u: %zu lines instead of %zu", uwBufferSize, messages.size(), expected.size());
+
+  size_t position = 0;
+  for (size_t i = 0; (i < messages.size()) && (i < expected.size()); i++)
+  {
+    size_t lineLength = content.find('\n', position) + 1 - position;
+    position += lineLength;
+
+    // no line is longer than the buffer, including the '\0'
+    LOGGER_CHECK(lineLength < uwActualSize, "buffer of %u: line %zu of %zu chars", uwBufferSize, i, lineLength);
+
+    // only a line longer than the whole buffer is truncated
+    if (messages[i] != expected[i])
+    {
+      bool bTruncated = (lineLength == (size_t)(uwActualSize - 1)) && (expected[i].compare(0, messages[i].size(), messages[i]) == 0);
+      LOGGER_CHECK(bTruncated, "buffer of %u: line %zu of %zu chars logged as %zu chars", uwBufferSize, i, expected[i].size(), messages[i].size());
+    }
+  }
+  LOGGER_CHECK(logger.getDroppedLines() == 0, "buffer of %u: %u dropped lines", uwBufferSize, logger.getDroppedLines());
+
+  SPIFFS.end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+/**
+ * @brief      Check that the buffer is flushed only if a line does not fit.
+ */
+static void _test_flush()
+{
+  std::string logPath = "/" CRASHLOGGER_FILEPATTERN "-1." CRASHFILEEXTENSION;
+  std::string content;
+
+  hostFsReset(SPIFFS);
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+  pCrashStore = NULL;
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+
+  EspSaveCrashLogger logger(crashStore, CRASHLOGGER_FILEPATTERN, 128);
+  logger.begin();
+
+  // two short lines fit into the buffer, the third one flushes the first two
+  logger.log(CRASH_LOG_INFO, "%s", std::string(40, 'a').c_str());
+  logger.log(CRASH_LOG_INFO, "%s", std::string(40, 'b').c_str());
+  LOGGER_CHECK(!hostFsRead(SPIFFS, logPath, NULL), "flushed before the buffer is full");
+  logger.log(CRASH_LOG_INFO, "%s", std::string(40, 'c').c_str());
+  LOGGER_CHECK(hostFsRead(SPIFFS, logPath, &content) && (_get_messages(content).size() == 2), "%zu lines flushed instead of 2", _get_messages(content).size());
+
+  // the pending line is saved in case of a crash
+  logger.flush();
+  LOGGER_CHECK(hostFsRead(SPIFFS, logPath, &content) && (_get_messages(content).size() == 3), "%zu lines after flush", _get_messages(content).size());
+
+  SPIFFS.end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+/**
+ * @brief      Measure the messages per second of the logger.
+ */
+static void _run_benchmark()
+{
+  char pcMessage[64];
+  std::string benchPath = "/benchLog-1.log";
+
+  hostFsReset(SPIFFS);
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+  pCrashStore = NULL;
+  crashStore.begin(CRASH_BEGIN_NO_MOUNT);
+
+  EspSaveCrashLogger logger(crashStore);
+  logger.begin();
+  logger.setMaxFileSize(UINT32_MAX);
+
+  // unbuffered, each message opens, writes and closes the file
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < (LOGGER_BENCH_MESSAGES * LOGGER_BENCH_RUNS); i++)
+  {
+    snprintf(pcMessage, sizeof(pcMessage), "%u I Benchmark message %u\n", (uint32_t)millis(), i % LOGGER_BENCH_MESSAGES);
+    saveToSpiffsFile(pcMessage, benchPath.c_str());
+    if ((i % LOGGER_BENCH_MESSAGES) == 0)
+    {
+      SPIFFS.remove(benchPath.c_str());
+    }
+  }
+  uint64_t ullDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  printf("saveToSpiffsFile: %u messages in %llu us, %llu messages/s\n", LOGGER_BENCH_MESSAGES * LOGGER_BENCH_RUNS, (unsigned long long)ullDuration, (unsigned long long)(((uint64_t)LOGGER_BENCH_MESSAGES * LOGGER_BENCH_RUNS * 1000000) / (ullDuration ? ullDuration : 1)));
+
+  // buffered, the staging buffer is written if it is full
+  start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < (LOGGER_BENCH_MESSAGES * LOGGER_BENCH_RUNS); i++)
+  {
+    logger.log(CRASH_LOG_INFO, "Benchmark message %u", i % LOGGER_BENCH_MESSAGES);
+    if ((i % LOGGER_BENCH_MESSAGES) == 0)
+    {
+      logger.flush();
+      SPIFFS.remove(logger.getLogFileName());
+    }
+  }
+  logger.flush();
+  ullDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  printf("EspSaveCrashLogger: %u messages in %llu us, %llu messages/s\n", LOGGER_BENCH_MESSAGES * LOGGER_BENCH_RUNS, (unsigned long long)ullDuration, (unsigned long long)(((uint64_t)LOGGER_BENCH_MESSAGES * LOGGER_BENCH_RUNS * 1000000) / (ullDuration ? ullDuration : 1)));
+
+  SPIFFS.end();
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+int main(int argc, char** argv)
+{
+  if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+  {
+    _run_benchmark();
+    return 0;
+  }
+
+  static const uint16_t puwBufferSizes[] = {0, 10, CRASHLOGGER_MIN_BUFFER_SIZE, 100, 101, CRASHLOGGER_BUFFER_SIZE};
+  for (uint16_t uwBufferSize : puwBufferSizes)
+  {
+    _test_buffer_size(uwBufferSize);
+  }
+  _test_flush();
+
+  if (ulFailures)
+  {
+    printf("%lu checks failed\n", ulFailures);
+    return 1;
+  }
+
+  printf("Lines of all lengths logged with all buffer sizes\n");
+
+  return 0;
+}
@@ -0,0 +1,279 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: PolicyTest.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Test of the crash report policy, see EspSaveCrashPolicy
+ *
+ * The token bucket, the signature ring and the sampling decision are
+ * checked against the class alone, with a bucket of 1 byte per second.
+ * The state kept in the RTC user memory is checked through the crash store,
+ * a corrupted state has to be reset on boot.
+ *
+ * Build it from this directory:
+ *   g++ -std=c++11 -g -fsanitize=address,undefined -Wno-int-to-pointer-cast -Icore -I../../src PolicyTest.cpp core/HostCore.cpp ../../src/EspSaveCrash*.cpp -o policy-test
+ *   ./policy-test
+ */
+
+#include "HostCore.h"
+#include "EspSaveCrashSpiffs.h"
+
+#if !CRASH_ENABLE_POLICY
+#error "Build the policy test with CRASH_ENABLE_POLICY"
+#endif
+
+// size of a full crash log and of the header only
+#define POLICY_FULL_BYTES    300
+#define POLICY_HEADER_BYTES  50
+
+// 1 byte per second, up to 1000 bytes
+#define POLICY_BYTES_PER_HOUR  3600
+#define POLICY_BURST_BYTES     1000
+
+#define POLICY_SIGNATURE_A  0xA
+#define POLICY_SIGNATURE_B  0xB
+
+extern EspSaveCrashSpiffs* pCrashStore;
+extern EspSaveCrashLoop* pCrashLoop;
+extern EspSaveCrashPolicy* pCrashPolicy;
+
+static unsigned long ulFailures;
+
+/**
+ * @brief      Report a failed check and continue.
+ */
+#define POLICY_CHECK(condition, ...) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf(stderr, "Check failed at line %d: %s\n  ", __LINE__, #condition); \
+      fprintf(stderr, __VA_ARGS__); \
+      fprintf(stderr, "\n"); \
+      ulFailures++; \
+    } \
+  } while (0)
+
+/**
+ * @brief      Crash, check the decision and write the crash log.
+ *
+ * @param      policy       The policy
+ * @param[in]  ulCrashTime  The crash time
+ * @param[in]  ulSignature  The signature of the crash
+ * @param[in]  expected     The expected decision
+ * @param[in]  ulLine       The line of the caller
+ */
+static void _crash(EspSaveCrashPolicy& policy, uint32_t ulCrashTime, uint32_t ulSignature, crashPolicyDecision_t expected, uint32_t ulLine)
+{
+  crashPolicyDecision_t decision = policy.onCrash(ulCrashTime, ulSignature, POLICY_FULL_BYTES, POLICY_HEADER_BYTES);
+
+  POLICY_CHECK(decision == expected, "line %u: decision %d instead of %d with %u tokens", ulLine, decision, expected, policy.state.ulTokens);
+  if (decision == CRASH_POLICY_FULL)
+  {
+    policy.onWrite(POLICY_FULL_BYTES);
+  }
+  else if (decision == CRASH_POLICY_HEADER)
+  {
+    policy.onWrite(POLICY_HEADER_BYTES);
+  }
+}
+
+/**
+ * @brief      Check the token bucket with a burst of crashes and the refill.
+ */
+static void _test_token_bucket()
+{
+  EspSaveCrashPolicy policy(3, POLICY_BYTES_PER_HOUR, POLICY_BURST_BYTES);
+
+  POLICY_CHECK(policy.isValid() && (policy.state.ulTokens == POLICY_BURST_BYTES), "reset: %u tokens", policy.state.ulTokens);
+
+  // a burst of the same crash, the first three with a full dump
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_FULL, __LINE__);
+  POLICY_CHECK(policy.state.ulTokens == 100, "burst: %u tokens left", policy.state.ulTokens);
+
+  // the bucket holds only headers, then nothing at all
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_HEADER, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_HEADER, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_DROP, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_DROP, __LINE__);
+  POLICY_CHECK(policy.getDropped() == 2, "burst: %u dropped", policy.getDropped());
+
+  // 60 s of uptime refill 60 bytes, enough for a header
+  _crash(policy, 60000, POLICY_SIGNATURE_A, CRASH_POLICY_HEADER, __LINE__);
+  POLICY_CHECK(policy.getDropped() == 0, "refill: %u dropped after a written crash log", policy.getDropped());
+  POLICY_CHECK(policy.state.ulTokens == 10, "refill: %u tokens left", policy.state.ulTokens);
+
+  // not enough for a full dump, even with a new signature
+  _crash(policy, 200000, POLICY_SIGNATURE_B, CRASH_POLICY_HEADER, __LINE__);
+
+  // the uptime overflowing the bucket ends the crash storm
+  _crash(policy, UINT32_MAX, POLICY_SIGNATURE_A, CRASH_POLICY_FULL, __LINE__);
+  POLICY_CHECK(policy.state.ulTokens == (POLICY_BURST_BYTES - POLICY_FULL_BYTES), "quiet period: %u tokens left", policy.state.ulTokens);
+  POLICY_CHECK(policy.state.ulCrashCount == 1, "quiet period: crash count %u", policy.state.ulCrashCount);
+}
+
+/**
+ * @brief      Check the sampling of repeated crashes.
+ */
+static void _test_sampling()
+{
+  EspSaveCrashPolicy policy(3, POLICY_BYTES_PER_HOUR, POLICY_BURST_BYTES);
+
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_A, CRASH_POLICY_FULL, __LINE__);
+
+  // 300 s refill enough for a full dump, a repeat is sampled anyway
+  crashPolicyDecision_t decision = policy.onCrash(300000, POLICY_SIGNATURE_A, POLICY_FULL_BYTES, POLICY_HEADER_BYTES);
+  POLICY_CHECK(decision == CRASH_POLICY_HEADER, "repeat: decision %d with %u tokens", decision, policy.state.ulTokens);
+
+  // a new crash gets a full dump
+  _crash(policy, 0, POLICY_SIGNATURE_B, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, POLICY_SIGNATURE_B, CRASH_POLICY_HEADER, __LINE__);
+
+  POLICY_CHECK(crashPolicySignature(REASON_EXCEPTION_RST, 28, 0x40201234) == crashPolicySignature(REASON_EXCEPTION_RST, 28, 0x40201234), "signature: not stable");
+  POLICY_CHECK(crashPolicySignature(REASON_EXCEPTION_RST, 28, 0x40201234) != crashPolicySignature(REASON_EXCEPTION_RST, 28, 0x40201238), "signature: epc1 ignored");
+  POLICY_CHECK(crashPolicySignature(REASON_EXCEPTION_RST, 28, 0x40201234) != crashPolicySignature(REASON_EXCEPTION_RST, 29, 0x40201234), "signature: exception cause ignored");
+  POLICY_CHECK(crashPolicySignature(REASON_EXCEPTION_RST, 28, 0x40201234) != crashPolicySignature(REASON_SOFT_WDT_RST, 28, 0x40201234), "signature: restart reason ignored");
+}
+
+/**
+ * @brief      Check the ring of the latest signatures.
+ *
+ * Without full dumps for repeats and with a bucket never running empty,
+ * only new signatures get a full dump.
+ */
+static void _test_signature_ring()
+{
+  EspSaveCrashPolicy policy(0, 0, 100000);
+
+  // the empty slots do not match a signature of 0
+  _crash(policy, 0, 0, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, 0, CRASH_POLICY_HEADER, __LINE__);
+
+  policy.reset();
+  for (uint32_t i = 1; i <= CRASH_POLICY_SIGNATURES; i++)
+  {
+    _crash(policy, 0, i, CRASH_POLICY_FULL, __LINE__);
+  }
+  for (uint32_t i = 1; i <= CRASH_POLICY_SIGNATURES; i++)
+  {
+    _crash(policy, 0, i, CRASH_POLICY_HEADER, __LINE__);
+  }
+
+  // a new signature replaces the oldest one
+  _crash(policy, 0, CRASH_POLICY_SIGNATURES + 1, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, 1, CRASH_POLICY_FULL, __LINE__);
+  _crash(policy, 0, 3, CRASH_POLICY_HEADER, __LINE__);
+  _crash(policy, 0, 2, CRASH_POLICY_FULL, __LINE__);
+
+  // the ring keeps working after the head wrapped several times
+  for (uint32_t i = 0; i < (4 * CRASH_POLICY_SIGNATURES); i++)
+  {
+    _crash(policy, 0, 100 + i, CRASH_POLICY_FULL, __LINE__);
+  }
+  POLICY_CHECK(policy.state.ulSignatureHead < (2 * CRASH_POLICY_SIGNATURES), "ring: head %u", policy.state.ulSignatureHead);
+  for (uint32_t i = (3 * CRASH_POLICY_SIGNATURES); i < (4 * CRASH_POLICY_SIGNATURES); i++)
+  {
+    _crash(policy, 0, 100 + i, CRASH_POLICY_HEADER, __LINE__);
+  }
+  _crash(policy, 0, 100, CRASH_POLICY_FULL, __LINE__);
+}
+
+/**
+ * @brief      Check the state kept in the RTC user memory.
+ */
+static void _test_rtc_state()
+{
+  EspSaveCrashSpiffs crashStore(SPIFFS, "/");
+  crash_policy_state_t state;
+  EspSaveCrashPolicy policy;
+
+  hostFsReset(SPIFFS);
+  hostRtcClear();
+
+  // a power on resets the state
+  hostSetResetReason(REASON_DEFAULT_RST);
+  crashStore.setCrashStore();
+  ESP.rtcUserMemoryRead(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&state, sizeof(state));
+  POLICY_CHECK(state.ulMagic == CRASH_POLICY_MAGIC, "power on: magic 0x%08x", state.ulMagic);
+  POLICY_CHECK(state.ulTokens == CRASH_POLICY_BURST_BYTES, "power on: %u tokens", state.ulTokens);
+
+  // a valid state is kept over any restart
+  policy.onCrash(0, POLICY_SIGNATURE_A, CRASH_POLICY_BURST_BYTES + 1, CRASH_POLICY_BURST_BYTES + 1);
+  POLICY_CHECK(policy.getDropped() == 1, "setup: %u dropped", policy.getDropped());
+  ESP.rtcUserMemoryWrite(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&policy.state, sizeof(policy.state));
+  hostSetResetReason(REASON_EXT_SYS_RST);
+  crashStore.setCrashStore();
+  ESP.rtcUserMemoryRead(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&state, sizeof(state));
+  POLICY_CHECK((state.ulDropped == 1) && (state.ulCrashCount == 1), "restart: %u dropped, %u crashes", state.ulDropped, state.ulCrashCount);
+  POLICY_CHECK(pCrashPolicy && (pCrashPolicy->getDropped() == 1), "restart: dropped crash lost");
+
+  // a single corrupted word resets the state
+  for (uint32_t i = 0; i < CRASH_POLICY_RTC_BLOCKS; i++)
+  {
+    state = policy.state;
+    ((uint32_t*)&state)[i] ^= 0x00010000;
+    ESP.rtcUserMemoryWrite(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&state, sizeof(state));
+    crashStore.setCrashStore();
+    ESP.rtcUserMemoryRead(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&state, sizeof(state));
+    POLICY_CHECK((state.ulDropped == 0) && (state.ulCrashCount == 0), "corrupted block %u: %u dropped, %u crashes", i, state.ulDropped, state.ulCrashCount);
+    POLICY_CHECK(state.ulTokens == CRASH_POLICY_BURST_BYTES, "corrupted block %u: %u tokens", i, state.ulTokens);
+  }
+
+  // the crash loop state next to it is not touched
+  EspSaveCrashLoop crashLoop;
+  crashLoop.onCrash(100);
+  ESP.rtcUserMemoryWrite(CRASHLOOP_RTC_OFFSET, (uint32_t*)&crashLoop.state, sizeof(crashLoop.state));
+  hostSetResetReason(REASON_EXCEPTION_RST);
+  crashStore.setCrashStore();
+  POLICY_CHECK(pCrashLoop && (pCrashLoop->getCrashCount() == 1), "crash loop: state lost");
+
+  pCrashStore = NULL;
+  pCrashLoop = NULL;
+  pCrashPolicy = NULL;
+}
+
+int main()
+{
+  _test_token_bucket();
+  _test_sampling();
+  _test_signature_ring();
+  _test_rtc_state();
+
+  if (ulFailures)
+  {
+    printf("%lu checks failed\n", ulFailures);
+    return 1;
+  }
+
+  printf("Token bucket, sampling, signature ring and RTC state checked\n");
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: Arduino.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Host stand-in of the ESP8266 Arduino core
+ *
+ * Only the parts used by the library are provided, with the same names and
+ * signatures as the core. All functions are defined in HostCore.cpp, so
+ * every allocation done by the stand-in happens there and not in the
+ * library code, see HostCoreScope.
+ */
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define ICACHE_FLASH_ATTR
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void yield();
+void delay(unsigned long ms);
+
+class String
+{
+  public:
+    String(const char* pcString = "");
+    String(const String& other);
+    String(String&& other);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator=(String&& other);
+
+    const char* c_str() const;
+    unsigned int length() const;
+    bool startsWith(const char* pcPrefix) const;
+    bool endsWith(const char* pcSuffix) const;
+  private:
+    char* _pcBuffer;
+};
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t ubByte) = 0;
+    virtual size_t write(const uint8_t* pubBuffer, size_t size);
+    size_t write(const char* pcBuffer, size_t size);
+
+    size_t print(const char* pcString);
+    size_t println(const char* pcString = "");
+    size_t printf(const char* pcFormat, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(char* pcBuffer, size_t length);
+    size_t readBytes(uint8_t* pubBuffer, size_t length);
+    size_t readBytesUntil(char terminator, char* pcBuffer, size_t length);
+    void setTimeout(unsigned long ulTimeout);
+};
+
+// discards the output, nothing is ever received
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long ulBaudrate);
+
+    size_t write(uint8_t ubByte) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+  public:
+    void getHeapStats(uint32_t* pulFree = NULL, uint16_t* puwMax = NULL, uint8_t* pubFrag = NULL);
+    bool rtcUserMemoryRead(uint32_t ulOffset, uint32_t* pulData, size_t size);
+    bool rtcUserMemoryWrite(uint32_t ulOffset, uint32_t* pulData, size_t size);
+    struct rst_info* getResetInfoPtr();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,146 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: FS.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Host stand-in of the filesystem API of the ESP8266 Arduino core
+ *
+ * The files are kept in memory, see HostCore.h to set up and inspect a
+ * filesystem. Each FS behaves like SPIFFS or like LittleFS:
+ *  - SPIFFS: Dir::fileName() returns the whole path, rename() does not
+ *    replace an existing file and names are limited to 31 chars
+ *  - LittleFS: Dir::fileName() returns only the name, sub directories are
+ *    listed and rename() replaces an existing file
+ */
+
+#ifndef _HOST_FS_H_
+#define _HOST_FS_H_
+
+#include "Arduino.h"
+
+#include <memory>
+
+struct HostFile;
+struct HostDir;
+struct HostFileSystem;
+
+namespace fs
+{
+
+enum SeekMode
+{
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+struct FSInfo
+{
+  size_t totalBytes;
+  size_t usedBytes;
+  size_t blockSize;
+  size_t pageSize;
+  size_t maxOpenFiles;
+  size_t maxPathLength;
+};
+
+class File : public Stream
+{
+  public:
+    File();
+    explicit File(std::shared_ptr<HostFile> file);
+
+    size_t write(uint8_t ubByte) override;
+    size_t write(const uint8_t* pubBuffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* pubBuffer, size_t size);
+    bool seek(uint32_t ulPosition, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close();
+    operator bool() const;
+  private:
+    std::shared_ptr<HostFile> _file;
+};
+
+class Dir
+{
+  public:
+    Dir();
+    explicit Dir(std::shared_ptr<HostDir> dir);
+
+    bool next();
+    String fileName();
+    size_t fileSize();
+    bool isFile() const;
+    bool isDirectory() const;
+    bool rewind();
+  private:
+    std::shared_ptr<HostDir> _dir;
+};
+
+class FS
+{
+  public:
+    explicit FS(bool bSpiffsNames);
+
+    bool begin();
+    void end();
+    bool info(FSInfo& info);
+    File open(const char* path, const char* mode);
+    bool exists(const char* path);
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+    Dir openDir(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* pathFrom, const char* pathTo);
+
+    HostFileSystem* getHost();
+  private:
+    HostFileSystem* _host;
+};
+
+}
+
+#ifndef FS_NO_GLOBALS
+using fs::FS;
+using fs::File;
+using fs::Dir;
+using fs::FSInfo;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+#endif
+
+extern fs::FS SPIFFS;
+
+#endif
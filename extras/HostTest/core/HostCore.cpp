@@ -0,0 +1,1056 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: HostCore.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Host stand-in of the ESP8266 Arduino core, see Arduino.h and FS.h
+ */
+
+#include "HostCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+
+// maximum name length of SPIFFS and LittleFS
+#define HOST_SPIFFS_NAME_SIZE    31
+#define HOST_LITTLEFS_NAME_SIZE  255
+
+// size of the RTC user memory in byte
+#define HOST_RTC_USER_MEMORY_SIZE  512
+
+int hostCoreDepth;
+
+HardwareSerial Serial;
+EspClass ESP;
+fs::FS SPIFFS(true);
+fs::FS LittleFS(false);
+
+static unsigned long ulMillisOffset;
+static uint32_t pulRtcUserMemory[HOST_RTC_USER_MEMORY_SIZE / 4];
+static struct rst_info resetInfo;
+
+/**
+ * The in-memory filesystem behind a FS
+ */
+struct HostFileSystem
+{
+  bool bSpiffsNames;
+  size_t totalBytes;
+  uint32_t ulOrderSeed;
+  std::map<std::string, std::shared_ptr<std::string>> files;
+  // directories without the trailing '/', LittleFS only
+  std::set<std::string> directories;
+};
+
+/**
+ * An opened file, the content is shared with the filesystem
+ */
+struct HostFile
+{
+  HostFileSystem* host;
+  std::shared_ptr<std::string> content;
+  size_t position;
+  bool bRead;
+  bool bWrite;
+  bool bAppend;
+};
+
+struct HostDirEntry
+{
+  std::string name;
+  std::shared_ptr<std::string> content;
+};
+
+/**
+ * A directory listing, taken when the directory is opened
+ */
+struct HostDir
+{
+  std::vector<HostDirEntry> entries;
+  size_t next;
+};
+
+/**
+ * @brief      Gets the used bytes of a filesystem.
+ *
+ * @param      host  The filesystem
+ *
+ * @return     The sum of all file sizes
+ */
+static size_t _used_bytes(HostFileSystem* host)
+{
+  size_t usedBytes = 0;
+
+  for (const auto& file : host->files)
+  {
+    usedBytes += file.second->size();
+  }
+
+  return usedBytes;
+}
+
+/**
+ * @brief      Check the name length limits of the filesystem.
+ *
+ * @param      host  The filesystem
+ * @param[in]  path  The path
+ *
+ * @retval     True   The path can be stored
+ * @retval     False  The path or a part of it is too long or empty
+ */
+static bool _is_valid_path(HostFileSystem* host, const std::string& path)
+{
+  if ((path.size() < 2) || (path[0] != '/') || (path.back() == '/'))
+  {
+    return false;
+  }
+
+  if (host->bSpiffsNames)
+  {
+    return (path.size() <= HOST_SPIFFS_NAME_SIZE);
+  }
+
+  size_t start = 1;
+  while (start < path.size())
+  {
+    size_t end = path.find('/', start);
+    if (end == std::string::npos)
+    {
+      end = path.size();
+    }
+    if ((end == start) || ((end - start) > HOST_LITTLEFS_NAME_SIZE))
+    {
+      return false;
+    }
+    start = end + 1;
+  }
+
+  return true;
+}
+
+/**
+ * @brief      Check if a file can be created.
+ *
+ * @param      host  The filesystem
+ * @param[in]  path  The path
+ *
+ * @retval     True   The path is valid and no directory or file is in the way
+ * @retval     False  The file can not be created
+ */
+static bool _can_create(HostFileSystem* host, const std::string& path)
+{
+  if (!_is_valid_path(host, path) || host->directories.count(path))
+  {
+    return false;
+  }
+
+  // LittleFS can not create a file within a file
+  for (size_t slash = path.find('/', 1); !host->bSpiffsNames && (slash != std::string::npos); slash = path.find('/', slash + 1))
+  {
+    if (host->files.count(path.substr(0, slash)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief      Create the parent directories of a path, LittleFS only.
+ *
+ * @param      host  The filesystem
+ * @param[in]  path  The path
+ */
+static void _make_parents(HostFileSystem* host, const std::string& path)
+{
+  if (host->bSpiffsNames)
+  {
+    return;
+  }
+
+  for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+  {
+    host->directories.insert(path.substr(0, slash));
+  }
+}
+
+/**
+ * @brief      Order of the directory listing.
+ *
+ * Real filesystems do not list sorted, the order is mixed by the seed.
+ *
+ * @param[in]  ulSeed  The seed, zero for a sorted listing
+ * @param[in]  name    The name
+ *
+ * @return     The sort key
+ */
+static uint32_t _order_key(uint32_t ulSeed, const std::string& name)
+{
+  uint32_t ulHash = ulSeed;
+
+  if (!ulSeed)
+  {
+    return 0;
+  }
+
+  // FNV-1a
+  for (char c : name)
+  {
+    ulHash = (ulHash ^ (uint8_t)c) * 16777619UL;
+  }
+
+  return ulHash;
+}
+
+unsigned long millis()
+{
+  static const auto start = std::chrono::steady_clock::now();
+
+  return ulMillisOffset + std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long micros()
+{
+  static const auto start = std::chrono::steady_clock::now();
+
+  return (ulMillisOffset * 1000) + std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void yield()
+{
+}
+
+void delay(unsigned long ms)
+{
+  hostAdvanceMillis(ms);
+}
+
+String::String(const char* pcString)
+{
+  if (!pcString)
+  {
+    pcString = "";
+  }
+
+  _pcBuffer = new char[strlen(pcString) + 1];
+  strcpy(_pcBuffer, pcString);
+}
+
+String::String(const String& other) :
+  String(other._pcBuffer)
+{
+}
+
+String::String(String&& other)
+{
+  _pcBuffer = other._pcBuffer;
+  other._pcBuffer = NULL;
+}
+
+String::~String()
+{
+  delete[] _pcBuffer;
+}
+
+String& String::operator=(const String& other)
+{
+  if (this != &other)
+  {
+    String copy(other);
+    *this = std::move(copy);
+  }
+
+  return *this;
+}
+
+String& String::operator=(String&& other)
+{
+  std::swap(_pcBuffer, other._pcBuffer);
+
+  return *this;
+}
+
+const char* String::c_str() const
+{
+  return _pcBuffer ? _pcBuffer : "";
+}
+
+unsigned int String::length() const
+{
+  return strlen(c_str());
+}
+
+bool String::startsWith(const char* pcPrefix) const
+{
+  return strncmp(c_str(), pcPrefix, strlen(pcPrefix)) == 0;
+}
+
+bool String::endsWith(const char* pcSuffix) const
+{
+  size_t stringLength = length();
+  size_t suffixLength = strlen(pcSuffix);
+
+  return (stringLength >= suffixLength) && (strcmp(c_str() + stringLength - suffixLength, pcSuffix) == 0);
+}
+
+size_t Print::write(const uint8_t* pubBuffer, size_t size)
+{
+  HostCoreScope scope;
+  size_t written = 0;
+
+  while ((written < size) && write(pubBuffer[written]))
+  {
+    written++;
+  }
+
+  return written;
+}
+
+size_t Print::write(const char* pcBuffer, size_t size)
+{
+  return write((const uint8_t*)pcBuffer, size);
+}
+
+size_t Print::print(const char* pcString)
+{
+  return write(pcString, strlen(pcString));
+}
+
+size_t Print::println(const char* pcString)
+{
+  return print(pcString) + print("\r\n");
+}
+
+size_t Print::printf(const char* pcFormat, ...)
+{
+  HostCoreScope scope;
+  char pcBuffer[64];
+  va_list args;
+
+  va_start(args, pcFormat);
+  int length = vsnprintf(pcBuffer, sizeof(pcBuffer), pcFormat, args);
+  va_end(args);
+
+  if (length < 0)
+  {
+    return 0;
+  }
+  if ((size_t)length < sizeof(pcBuffer))
+  {
+    return write((const uint8_t*)pcBuffer, length);
+  }
+
+  std::vector<char> buffer(length + 1);
+  va_start(args, pcFormat);
+  vsnprintf(buffer.data(), buffer.size(), pcFormat, args);
+  va_end(args);
+
+  return write((const uint8_t*)buffer.data(), length);
+}
+
+size_t Stream::readBytes(char* pcBuffer, size_t length)
+{
+  HostCoreScope scope;
+  size_t count = 0;
+
+  while (count < length)
+  {
+    int iChar = read();
+    if (iChar < 0)
+    {
+      break;
+    }
+    pcBuffer[count++] = (char)iChar;
+  }
+
+  return count;
+}
+
+size_t Stream::readBytes(uint8_t* pubBuffer, size_t length)
+{
+  return readBytes((char*)pubBuffer, length);
+}
+
+size_t Stream::readBytesUntil(char terminator, char* pcBuffer, size_t length)
+{
+  HostCoreScope scope;
+  size_t count = 0;
+
+  while (count < length)
+  {
+    int iChar = read();
+    if ((iChar < 0) || (iChar == terminator))
+    {
+      break;
+    }
+    pcBuffer[count++] = (char)iChar;
+  }
+
+  return count;
+}
+
+void Stream::setTimeout(unsigned long ulTimeout)
+{
+}
+
+void HardwareSerial::begin(unsigned long ulBaudrate)
+{
+}
+
+size_t HardwareSerial::write(uint8_t ubByte)
+{
+  return 1;
+}
+
+int HardwareSerial::available()
+{
+  return 0;
+}
+
+int HardwareSerial::read()
+{
+  return -1;
+}
+
+int HardwareSerial::peek()
+{
+  return -1;
+}
+
+void EspClass::getHeapStats(uint32_t* pulFree, uint16_t* puwMax, uint8_t* pubFrag)
+{
+  if (pulFree)
+  {
+    *pulFree = 40000;
+  }
+  if (puwMax)
+  {
+    *puwMax = 30000;
+  }
+  if (pubFrag)
+  {
+    *pubFrag = 10;
+  }
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t ulOffset, uint32_t* pulData, size_t size)
+{
+  if (((ulOffset * 4) + size) > HOST_RTC_USER_MEMORY_SIZE)
+  {
+    return false;
+  }
+
+  memcpy(pulData, (uint8_t*)pulRtcUserMemory + (ulOffset * 4), size);
+
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t ulOffset, uint32_t* pulData, size_t size)
+{
+  if (((ulOffset * 4) + size) > HOST_RTC_USER_MEMORY_SIZE)
+  {
+    return false;
+  }
+
+  memcpy((uint8_t*)pulRtcUserMemory + (ulOffset * 4), pulData, size);
+
+  return true;
+}
+
+struct rst_info* EspClass::getResetInfoPtr()
+{
+  return &resetInfo;
+}
+
+namespace fs
+{
+
+File::File()
+{
+}
+
+File::File(std::shared_ptr<HostFile> file) :
+  _file(file)
+{
+}
+
+size_t File::write(uint8_t ubByte)
+{
+  return write(&ubByte, 1);
+}
+
+size_t File::write(const uint8_t* pubBuffer, size_t size)
+{
+  HostCoreScope scope;
+
+  if (!_file || !_file->bWrite)
+  {
+    return 0;
+  }
+
+  std::string& content = *_file->content;
+  if (_file->bAppend)
+  {
+    _file->position = content.size();
+  }
+
+  // only what fits into the filesystem is written
+  size_t usedBytes = _used_bytes(_file->host);
+  size_t growth = ((_file->position + size) > content.size()) ? ((_file->position + size) - content.size()) : 0;
+  if ((usedBytes + growth) > _file->host->totalBytes)
+  {
+    size_t freeBytes = _file->host->totalBytes - std::min(usedBytes, _file->host->totalBytes);
+    size = (content.size() - _file->position) + freeBytes;
+  }
+
+  if ((_file->position + size) > content.size())
+  {
+    content.resize(_file->position + size);
+  }
+  memcpy(&content[_file->position], pubBuffer, size);
+  _file->position += size;
+
+  return size;
+}
+
+int File::available()
+{
+  if (!_file || !_file->bRead || (_file->position >= _file->content->size()))
+  {
+    return 0;
+  }
+
+  return _file->content->size() - _file->position;
+}
+
+int File::read()
+{
+  if (!available())
+  {
+    return -1;
+  }
+
+  return (uint8_t)(*_file->content)[_file->position++];
+}
+
+int File::peek()
+{
+  if (!available())
+  {
+    return -1;
+  }
+
+  return (uint8_t)(*_file->content)[_file->position];
+}
+
+size_t File::read(uint8_t* pubBuffer, size_t size)
+{
+  size_t length = std::min(size, (size_t)available());
+
+  if (length)
+  {
+    memcpy(pubBuffer, _file->content->data() + _file->position, length);
+    _file->position += length;
+  }
+
+  return length;
+}
+
+bool File::seek(uint32_t ulPosition, SeekMode mode)
+{
+  if (!_file)
+  {
+    return false;
+  }
+
+  size_t position = ulPosition;
+  if (mode == SeekCur)
+  {
+    position += _file->position;
+  }
+  else if (mode == SeekEnd)
+  {
+    position = _file->content->size() - ulPosition;
+  }
+
+  if (position > _file->content->size())
+  {
+    return false;
+  }
+
+  _file->position = position;
+
+  return true;
+}
+
+size_t File::position() const
+{
+  return _file ? _file->position : 0;
+}
+
+size_t File::size() const
+{
+  return _file ? _file->content->size() : 0;
+}
+
+void File::flush()
+{
+}
+
+void File::close()
+{
+  HostCoreScope scope;
+
+  _file.reset();
+}
+
+File::operator bool() const
+{
+  return (bool)_file;
+}
+
+Dir::Dir()
+{
+}
+
+Dir::Dir(std::shared_ptr<HostDir> dir) :
+  _dir(dir)
+{
+}
+
+bool Dir::next()
+{
+  if (!_dir || (_dir->next >= _dir->entries.size()))
+  {
+    return false;
+  }
+
+  _dir->next++;
+
+  return true;
+}
+
+String Dir::fileName()
+{
+  HostCoreScope scope;
+
+  if (!_dir || !_dir->next)
+  {
+    return String();
+  }
+
+  return String(_dir->entries[_dir->next - 1].name.c_str());
+}
+
+size_t Dir::fileSize()
+{
+  if (!isFile())
+  {
+    return 0;
+  }
+
+  return _dir->entries[_dir->next - 1].content->size();
+}
+
+bool Dir::isFile() const
+{
+  return _dir && _dir->next && _dir->entries[_dir->next - 1].content;
+}
+
+bool Dir::isDirectory() const
+{
+  return _dir && _dir->next && !_dir->entries[_dir->next - 1].content;
+}
+
+bool Dir::rewind()
+{
+  if (_dir)
+  {
+    _dir->next = 0;
+  }
+
+  return true;
+}
+
+FS::FS(bool bSpiffsNames)
+{
+  HostCoreScope scope;
+
+  _host = new HostFileSystem();
+  _host->bSpiffsNames = bSpiffsNames;
+  _host->totalBytes = HOST_FS_TOTAL_BYTES;
+  _host->ulOrderSeed = 0;
+}
+
+bool FS::begin()
+{
+  return true;
+}
+
+void FS::end()
+{
+}
+
+bool FS::info(FSInfo& info)
+{
+  HostCoreScope scope;
+
+  info.totalBytes = _host->totalBytes;
+  info.usedBytes = _used_bytes(_host);
+  info.blockSize = 4096;
+  info.pageSize = 256;
+  info.maxOpenFiles = 5;
+  info.maxPathLength = _host->bSpiffsNames ? (HOST_SPIFFS_NAME_SIZE + 1) : (HOST_LITTLEFS_NAME_SIZE + 1);
+
+  return true;
+}
+
+File FS::open(const char* path, const char* mode)
+{
+  HostCoreScope scope;
+  std::string thisPath(path);
+  auto file = _host->files.find(thisPath);
+
+  std::shared_ptr<HostFile> opened(new HostFile());
+  opened->host = _host;
+  opened->position = 0;
+  opened->bRead = (mode[0] == 'r') || (mode[1] == '+');
+  opened->bWrite = (mode[0] != 'r') || (mode[1] == '+');
+  opened->bAppend = (mode[0] == 'a');
+
+  if (mode[0] == 'r')
+  {
+    if (file == _host->files.end())
+    {
+      return File();
+    }
+    opened->content = file->second;
+  }
+  else
+  {
+    if (file == _host->files.end())
+    {
+      if (!_can_create(_host, thisPath))
+      {
+        return File();
+      }
+      _make_parents(_host, thisPath);
+      file = _host->files.emplace(thisPath, std::make_shared<std::string>()).first;
+    }
+    opened->content = file->second;
+
+    if (mode[0] == 'w')
+    {
+      opened->content->clear();
+    }
+  }
+
+  return File(opened);
+}
+
+bool FS::exists(const char* path)
+{
+  HostCoreScope scope;
+  std::string thisPath(path);
+
+  // a trailing '/' of a directory is ignored
+  if ((thisPath.size() > 1) && (thisPath.back() == '/'))
+  {
+    thisPath.pop_back();
+  }
+
+  return (thisPath == "/") || _host->files.count(thisPath) || _host->directories.count(thisPath);
+}
+
+bool FS::mkdir(const char* path)
+{
+  HostCoreScope scope;
+  std::string thisPath(path);
+
+  // SPIFFS has no directories
+  if (_host->bSpiffsNames)
+  {
+    return true;
+  }
+
+  if ((thisPath.size() > 1) && (thisPath.back() == '/'))
+  {
+    thisPath.pop_back();
+  }
+  if (!_can_create(_host, thisPath) || _host->files.count(thisPath))
+  {
+    return false;
+  }
+
+  _make_parents(_host, thisPath);
+  _host->directories.insert(thisPath);
+
+  return true;
+}
+
+bool FS::rmdir(const char* path)
+{
+  HostCoreScope scope;
+  std::string thisPath(path);
+
+  if ((thisPath.size() > 1) && (thisPath.back() == '/'))
+  {
+    thisPath.pop_back();
+  }
+
+  return _host->directories.erase(thisPath) > 0;
+}
+
+Dir FS::openDir(const char* path)
+{
+  HostCoreScope scope;
+  std::string prefix(path);
+  std::vector<std::pair<uint32_t, HostDirEntry>> entries;
+
+  if (_host->bSpiffsNames)
+  {
+    // SPIFFS lists all files starting with the path
+    for (const auto& file : _host->files)
+    {
+      if (file.first.compare(0, prefix.size(), prefix) == 0)
+      {
+        entries.push_back({_order_key(_host->ulOrderSeed, file.first), {file.first, file.second}});
+      }
+    }
+  }
+  else
+  {
+    // LittleFS lists the files and directories within the directory
+    if (prefix.empty() || (prefix.back() != '/'))
+    {
+      prefix += '/';
+    }
+
+    for (const auto& file : _host->files)
+    {
+      if ((file.first.compare(0, prefix.size(), prefix) == 0) && (file.first.find('/', prefix.size()) == std::string::npos))
+      {
+        std::string name = file.first.substr(prefix.size());
+        entries.push_back({_order_key(_host->ulOrderSeed, name), {name, file.second}});
+      }
+    }
+    for (const auto& directory : _host->directories)
+    {
+      if ((directory.size() > prefix.size()) && (directory.compare(0, prefix.size(), prefix) == 0) && (directory.find('/', prefix.size()) == std::string::npos))
+      {
+        std::string name = directory.substr(prefix.size());
+        entries.push_back({_order_key(_host->ulOrderSeed, name), {name, nullptr}});
+      }
+    }
+  }
+
+  std::stable_sort(entries.begin(), entries.end(), [](const std::pair<uint32_t, HostDirEntry>& a, const std::pair<uint32_t, HostDirEntry>& b) { return a.first < b.first; });
+
+  std::shared_ptr<HostDir> dir(new HostDir());
+  dir->next = 0;
+  for (const auto& entry : entries)
+  {
+    dir->entries.push_back(entry.second);
+  }
+
+  return Dir(dir);
+}
+
+bool FS::remove(const char* path)
+{
+  HostCoreScope scope;
+
+  return _host->files.erase(path) > 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo)
+{
+  HostCoreScope scope;
+  std::string thisPathTo(pathTo);
+  auto file = _host->files.find(pathFrom);
+
+  if ((file == _host->files.end()) || !_can_create(_host, thisPathTo))
+  {
+    return false;
+  }
+  if (file->first == thisPathTo)
+  {
+    return true;
+  }
+
+  // SPIFFS does not replace an existing file, LittleFS does
+  if (_host->bSpiffsNames && _host->files.count(thisPathTo))
+  {
+    return false;
+  }
+
+  std::shared_ptr<std::string> content = file->second;
+  _host->files.erase(file);
+  _make_parents(_host, thisPathTo);
+  _host->files[thisPathTo] = content;
+
+  return true;
+}
+
+HostFileSystem* FS::getHost()
+{
+  return _host;
+}
+
+}
+
+/**
+ * @brief      Remove all files of a filesystem.
+ *
+ * @param      fileSystem   The filesystem
+ * @param[in]  totalBytes   The size of the filesystem
+ * @param[in]  ulOrderSeed  The seed of the listing order, zero for sorted
+ */
+void hostFsReset(FS& fileSystem, size_t totalBytes, uint32_t ulOrderSeed)
+{
+  HostFileSystem* host = fileSystem.getHost();
+
+  host->files.clear();
+  host->directories.clear();
+  host->totalBytes = totalBytes;
+  host->ulOrderSeed = ulOrderSeed;
+}
+
+/**
+ * @brief      Gets all files of a filesystem, sorted by path.
+ *
+ * @param      fileSystem  The filesystem
+ *
+ * @return     The files
+ */
+std::vector<HostFileEntry> hostFsFiles(FS& fileSystem)
+{
+  std::vector<HostFileEntry> files;
+
+  for (const auto& file : fileSystem.getHost()->files)
+  {
+    files.push_back({file.first, *file.second});
+  }
+
+  return files;
+}
+
+/**
+ * @brief      Create or replace a file, without the filesystem limits.
+ *
+ * @param      fileSystem  The filesystem
+ * @param[in]  path        The path
+ * @param[in]  content     The content
+ *
+ * @retval     True   Success
+ * @retval     False  The name is not valid for this filesystem
+ */
+bool hostFsWrite(FS& fileSystem, const std::string& path, const std::string& content)
+{
+  HostFileSystem* host = fileSystem.getHost();
+
+  if (!_can_create(host, path))
+  {
+    return false;
+  }
+
+  _make_parents(host, path);
+  host->files[path] = std::make_shared<std::string>(content);
+
+  return true;
+}
+
+/**
+ * @brief      Read a file.
+ *
+ * @param      fileSystem  The filesystem
+ * @param[in]  path        The path
+ * @param      pContent    The content, NULL to check only if the file exists
+ *
+ * @retval     True   Success
+ * @retval     False  No such file
+ */
+bool hostFsRead(FS& fileSystem, const std::string& path, std::string* pContent)
+{
+  HostFileSystem* host = fileSystem.getHost();
+  auto file = host->files.find(path);
+
+  if (file == host->files.end())
+  {
+    return false;
+  }
+
+  if (pContent)
+  {
+    *pContent = *file->second;
+  }
+
+  return true;
+}
+
+/**
+ * @brief      Gets the sum of all file sizes.
+ *
+ * @param      fileSystem  The filesystem
+ *
+ * @return     The used bytes
+ */
+size_t hostFsUsedBytes(FS& fileSystem)
+{
+  return _used_bytes(fileSystem.getHost());
+}
+
+/**
+ * @brief      Let some time pass, for millis() and micros().
+ *
+ * @param[in]  ulMillis  The time in ms
+ */
+void hostAdvanceMillis(unsigned long ulMillis)
+{
+  ulMillisOffset += ulMillis;
+}
+
+/**
+ * @brief      Sets the reason of the last reset.
+ *
+ * @param[in]  ulReason  The reason, e.g. REASON_EXCEPTION_RST
+ */
+void hostSetResetReason(uint32_t ulReason)
+{
+  resetInfo.reason = ulReason;
+}
+
+/**
+ * @brief      Clear the RTC user memory, like a power on.
+ */
+void hostRtcClear()
+{
+  memset(pulRtcUserMemory, 0, sizeof(pulRtcUserMemory));
+}
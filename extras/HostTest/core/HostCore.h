@@ -0,0 +1,81 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: HostCore.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * Control of the host stand-in of the ESP8266 Arduino core, used by the
+ * host tests only
+ */
+
+#ifndef _HOST_CORE_H_
+#define _HOST_CORE_H_
+
+#include "Arduino.h"
+#include "FS.h"
+#include "LittleFS.h"
+#include "user_interface.h"
+
+#include <string>
+#include <vector>
+
+// default size of a filesystem
+#define HOST_FS_TOTAL_BYTES  (1024 * 1024)
+
+/**
+ * A file of the in-memory filesystem
+ */
+struct HostFileEntry
+{
+  std::string path;
+  std::string content;
+};
+
+/**
+ * Number of stand-in core functions currently running
+ *
+ * Allocations while it is non zero are done by the core, all others by the
+ * code under test.
+ */
+extern int hostCoreDepth;
+
+struct HostCoreScope
+{
+  HostCoreScope() { hostCoreDepth++; }
+  ~HostCoreScope() { hostCoreDepth--; }
+};
+
+void hostFsReset(FS& fileSystem, size_t totalBytes = HOST_FS_TOTAL_BYTES, uint32_t ulOrderSeed = 0);
+std::vector<HostFileEntry> hostFsFiles(FS& fileSystem);
+bool hostFsWrite(FS& fileSystem, const std::string& path, const std::string& content);
+bool hostFsRead(FS& fileSystem, const std::string& path, std::string* pContent);
+size_t hostFsUsedBytes(FS& fileSystem);
+
+void hostAdvanceMillis(unsigned long ulMillis);
+void hostSetResetReason(uint32_t ulReason);
+void hostRtcClear();
+
+#endif
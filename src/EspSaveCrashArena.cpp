@@ -0,0 +1,116 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashArena.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "EspSaveCrashArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// number of buffers currently in use and the maximum ever in use
+static uint8_t ubBuffersUsed;
+static uint8_t ubBuffersPeak;
+
+#if CRASH_HEAP_FREE
+static_assert(CRASH_ARENA_BUFFERS <= 32, "CRASH_ARENA_BUFFERS must fit into the usage mask");
+
+// the static arena and a bit per buffer in use
+static char pcArena[CRASH_ARENA_BUFFERS][CRASH_NAME_BUFFER_SIZE];
+static uint32_t ulArenaMask;
+#endif
+
+/**
+ * @brief      Get a zero initialized scratch buffer.
+ *
+ * @return     Buffer of CRASH_NAME_BUFFER_SIZE bytes, NULL if none is left
+ */
+char* crashBufferAlloc()
+{
+  char* pcBuffer = NULL;
+
+#if CRASH_HEAP_FREE
+  for (uint8_t i = 0; i < CRASH_ARENA_BUFFERS; i++)
+  {
+    if (!(ulArenaMask & (1UL << i)))
+    {
+      ulArenaMask |= (1UL << i);
+      pcBuffer = pcArena[i];
+      memset(pcBuffer, 0, CRASH_NAME_BUFFER_SIZE);
+      break;
+    }
+  }
+#else
+  pcBuffer = (char*)calloc(CRASH_NAME_BUFFER_SIZE, sizeof(char));
+#endif
+
+  if (pcBuffer && (++ubBuffersUsed > ubBuffersPeak))
+  {
+    ubBuffersPeak = ubBuffersUsed;
+  }
+
+  return pcBuffer;
+}
+
+/**
+ * @brief      Return a scratch buffer.
+ *
+ * @param      pcBuffer  The buffer of crashBufferAlloc(), NULL is ignored
+ */
+void crashBufferFree(char* pcBuffer)
+{
+  if (!pcBuffer)
+  {
+    return;
+  }
+
+#if CRASH_HEAP_FREE
+  for (uint8_t i = 0; i < CRASH_ARENA_BUFFERS; i++)
+  {
+    if (pcBuffer == pcArena[i])
+    {
+      ulArenaMask &= ~(1UL << i);
+      ubBuffersUsed--;
+      break;
+    }
+  }
+#else
+  free(pcBuffer);
+  ubBuffersUsed--;
+#endif
+}
+
+/**
+ * @brief      Gets the maximum number of scratch buffers used at once.
+ *
+ * Use it to size CRASH_ARENA_BUFFERS for the used functions.
+ *
+ * @return     The peak number of buffers.
+ */
+uint8_t crashBufferGetPeak()
+{
+  return ubBuffersPeak;
+}
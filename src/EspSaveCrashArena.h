@@ -0,0 +1,50 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashArena.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHARENA_H_
+#define _ESPSAVECRASHARENA_H_
+
+#include <stdint.h>
+
+#include "EspSaveCrashConfig.h"
+
+/**
+ * Scratch buffers for file names and paths
+ *
+ * Each buffer has CRASH_NAME_BUFFER_SIZE bytes and is zero initialized.
+ * By default the buffers are allocated on the heap. With CRASH_HEAP_FREE
+ * they are taken from a static arena of CRASH_ARENA_BUFFERS buffers, so the
+ * library does not fragment the heap of long running devices.
+ *
+ * The arena is not locked, use it only from the main loop.
+ */
+char* crashBufferAlloc();
+void crashBufferFree(char* pcBuffer);
+uint8_t crashBufferGetPeak();
+
+#endif
@@ -0,0 +1,86 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashBreadcrumbs.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHBREADCRUMBS_H_
+#define _ESPSAVECRASHBREADCRUMBS_H_
+
+#include <stdint.h>
+
+#include "EspSaveCrashConfig.h"
+
+// number of breadcrumbs kept in the ring buffer, MUST be a power of two
+#ifndef CRASH_BREADCRUMBS_SIZE
+#define CRASH_BREADCRUMBS_SIZE 16
+#endif
+
+/**
+ * Ring buffer of the latest breadcrumbs
+ *
+ * Each entry holds the event code in the upper and a value in the lower
+ * 16 bit. ulHead is the total number of breadcrumbs ever added.
+ */
+struct crash_breadcrumbs_t
+{
+  volatile uint32_t ulHead;
+  volatile uint32_t pulEntries[CRASH_BREADCRUMBS_SIZE];
+};
+
+extern crash_breadcrumbs_t crashBreadcrumbs;
+
+/**
+ * @brief      Add a breadcrumb to the ring buffer.
+ *
+ * The breadcrumbs are saved with the next crash log to show what the device
+ * was doing before the crash. This is a single writer ring buffer without
+ * any lock, so call it only from the main loop, not from an interrupt.
+ *
+ * @param[in]  uwCode   The event code
+ * @param[in]  uwValue  The optional event value
+ *
+ * Example usage:
+ * @code
+ *    // mark the start of a WiFi reconnect with the number of attempts
+ *    crashBreadcrumb(0x0010, ubAttempts);
+ * @endcode
+ */
+#if CRASH_ENABLE_BREADCRUMBS
+static inline void crashBreadcrumb(uint16_t uwCode, uint16_t uwValue=0)
+{
+  static_assert((CRASH_BREADCRUMBS_SIZE & (CRASH_BREADCRUMBS_SIZE - 1)) == 0, "CRASH_BREADCRUMBS_SIZE must be a power of two");
+
+  uint32_t ulHead = crashBreadcrumbs.ulHead;
+
+  crashBreadcrumbs.pulEntries[ulHead & (CRASH_BREADCRUMBS_SIZE - 1)] = ((uint32_t)uwCode << 16) | uwValue;
+  crashBreadcrumbs.ulHead = ulHead + 1;
+}
+#else
+// compiled to nothing if the breadcrumbs are disabled
+static inline void crashBreadcrumb(uint16_t uwCode, uint16_t uwValue=0) {}
+#endif
+
+#endif
@@ -0,0 +1,428 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashCompactor.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "EspSaveCrashCompactor.h"
+
+/**
+ * @brief      Constructs a new instance.
+ *
+ * Nothing is opened here, the work starts with the first handle() call.
+ *
+ * @param      crashStore  The crash store to compact
+ */
+EspSaveCrashCompactor::EspSaveCrashCompactor(EspSaveCrashSpiffs& crashStore) :
+  _crashStore(crashStore)
+{
+  _state = COMPACT_FIND;
+  _ulFileIndex = 0;
+  _ulCompleteRecords = 0;
+  _ulTruncatedRecords = 0;
+  _bOtherContent = false;
+  _bSegmentContent = false;
+  _bSplitFailed = false;
+  _ulSplitFiles = 0;
+  _ulDroppedRecords = 0;
+  _uwLineLength = 0;
+  _pcLine[0] = '\0';
+  _pcFilePath[0] = '\0';
+  _pcSegmentPath[0] = '\0';
+}
+
+/**
+ * @brief      Do the next compaction steps.
+ *
+ * Call this in the loop(). Each line of a crash log is one step, steps are
+ * done until the time budget is used up. A single step may exceed the
+ * budget, as writing to flash takes some milliseconds.
+ *
+ * @param[in]  ulBudget  The time budget in ms
+ *
+ * @retval     True   More work is pending
+ * @retval     False  All crash logs are compact
+ *
+ * Example usage:
+ * @code
+ *    void loop()
+ *    {
+ *      // spend at most 2 ms per loop on the compaction
+ *      CrashCompactor.handle(2);
+ *    }
+ * @endcode
+ */
+bool EspSaveCrashCompactor::handle(uint32_t ulBudget)
+{
+  uint32_t ulStartTime = millis();
+
+  do
+  {
+    switch (_state)
+    {
+      case COMPACT_FIND:
+        if (!_open_next_file())
+        {
+          _state = COMPACT_DONE;
+          return false;
+        }
+
+        _parser.reset();
+        _ulCompleteRecords = 0;
+        _ulTruncatedRecords = 0;
+        _bOtherContent = false;
+        _state = COMPACT_SCAN;
+        break;
+      case COMPACT_SCAN:
+        if (_read_line())
+        {
+          _scan_line();
+          break;
+        }
+
+        // a record without the end of the stack
+        if (_parser.finish())
+        {
+          _ulTruncatedRecords++;
+        }
+
+        // split only files with several records, truncated records or
+        // other content besides a record
+        if ((_ulTruncatedRecords > 0) || (_ulCompleteRecords > 1) || (_ulCompleteRecords && _bOtherContent))
+        {
+          _file.seek(0, SeekSet);
+          _parser.reset();
+          _bSegmentContent = false;
+          _bSplitFailed = false;
+          _state = COMPACT_SPLIT;
+        }
+        else
+        {
+          _file.close();
+          _state = COMPACT_FIND;
+        }
+        break;
+      case COMPACT_SPLIT:
+        if (_read_line())
+        {
+          _split_line();
+          break;
+        }
+
+        _finish_file();
+        _state = COMPACT_FIND;
+        break;
+      default:
+        return false;
+    }
+  } while ((millis() - ulStartTime) < ulBudget);
+
+  return true;
+}
+
+/**
+ * @brief      Check all crash logs again.
+ *
+ * A file currently split is finished first.
+ */
+void EspSaveCrashCompactor::restart()
+{
+  // finish a started split to not lose any content
+  while (_state == COMPACT_SPLIT)
+  {
+    handle(0);
+  }
+
+  if (_file)
+  {
+    _file.close();
+  }
+
+  _ulFileIndex = 0;
+  _state = COMPACT_FIND;
+}
+
+/**
+ * @brief      Check if all crash logs are compact.
+ *
+ * @retval     True   All crash logs are compact
+ * @retval     False  More work is pending
+ */
+bool EspSaveCrashCompactor::isDone()
+{
+  return _state == COMPACT_DONE;
+}
+
+/**
+ * @brief      Gets the number of files created by splitting.
+ *
+ * @return     The split files.
+ */
+uint32_t EspSaveCrashCompactor::getSplitFiles()
+{
+  return _ulSplitFiles;
+}
+
+/**
+ * @brief      Gets the number of dropped truncated records.
+ *
+ * @return     The dropped records.
+ */
+uint32_t EspSaveCrashCompactor::getDroppedRecords()
+{
+  return _ulDroppedRecords;
+}
+
+/**
+ * @brief      Open the next rotated crash log.
+ *
+ * @retval     True   A crash log has been opened
+ * @retval     False  No crash log is left
+ */
+bool EspSaveCrashCompactor::_open_next_file()
+{
+  uint32_t ulNextIndex;
+  uint32_t ulLatestIndex;
+
+  if (!_pcSegmentPath[0])
+  {
+    // create the filepath (must always start with '/')
+    snprintf(_pcSegmentPath, sizeof(_pcSegmentPath), "%s%s", _crashStore.getDirectoryName(), CRASH_COMPACT_TMP_FILENAME);
+
+    // remove a segment left by a reset during the split
+    if (_crashStore.getFileSystem().exists(_pcSegmentPath))
+    {
+      _crashStore.getFileSystem().remove(_pcSegmentPath);
+    }
+  }
+
+  while (_crashStore._find_file_after(_ulFileIndex, &ulNextIndex, &ulLatestIndex))
+  {
+    _ulFileIndex = ulNextIndex;
+
+    snprintf(_pcFilePath, sizeof(_pcFilePath), "%s%s-%u.%s", _crashStore.getDirectoryName(), _crashStore.getFilePattern(), _ulFileIndex, _crashStore.getFileExtension());
+
+    _file = _crashStore.getFileSystem().open(_pcFilePath, "r");
+    if (_file)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief      Read the next line of the crash log including the '\n'
+ *
+ * Lines longer than the line buffer are read in several parts, the parser
+ * continues a line until its '\n'.
+ *
+ * @retval     True   A line has been read
+ * @retval     False  End of the file
+ */
+bool EspSaveCrashCompactor::_read_line()
+{
+  _uwLineLength = 0;
+
+  while (_uwLineLength < (sizeof(_pcLine) - 1))
+  {
+    int iChar = _file.read();
+    if (iChar < 0)
+    {
+      break;
+    }
+
+    _pcLine[_uwLineLength++] = (char)iChar;
+    if (iChar == '\n')
+    {
+      break;
+    }
+  }
+  _pcLine[_uwLineLength] = '\0';
+
+  return (_uwLineLength > 0);
+}
+
+/**
+ * @brief      Count the records and other content of the crash log.
+ */
+void EspSaveCrashCompactor::_scan_line()
+{
+  bool bWasInRecord = _parser.isInRecord();
+  bool bCompleted = _parser.parseLine(_pcLine);
+
+  if (bCompleted)
+  {
+    if (_parser.getRecord().bComplete)
+    {
+      _ulCompleteRecords++;
+    }
+    else
+    {
+      _ulTruncatedRecords++;
+    }
+  }
+  else if (!bWasInRecord && !_parser.isInRecord() && (strspn(_pcLine, " \t\r\n") < _uwLineLength))
+  {
+    // some non empty line outside of a record
+    _bOtherContent = true;
+  }
+}
+
+/**
+ * @brief      Copy the line to the segment it belongs to.
+ *
+ * A segment is a single record or the content between the records.
+ */
+void EspSaveCrashCompactor::_split_line()
+{
+  bool bWasInRecord = _parser.isInRecord();
+  bool bCompleted = _parser.parseLine(_pcLine);
+
+  if (bCompleted && !_parser.getRecord().bComplete)
+  {
+    // the next record starts, drop the truncated one
+    _finish_segment(false);
+    _ulDroppedRecords++;
+  }
+  else if (!bWasInRecord && _parser.isInRecord())
+  {
+    // a record starts, keep the content before if not empty
+    _finish_segment(_bSegmentContent);
+  }
+
+  _write_segment();
+
+  if (bCompleted && _parser.getRecord().bComplete)
+  {
+    _finish_segment(true);
+  }
+}
+
+/**
+ * @brief      Write the line to the segment file.
+ */
+void EspSaveCrashCompactor::_write_segment()
+{
+  if (!_segmentFile)
+  {
+    _segmentFile = _crashStore.getFileSystem().open(_pcSegmentPath, "w");
+  }
+
+  if (_segmentFile)
+  {
+    size_t written = _segmentFile.write((const uint8_t*)_pcLine, _uwLineLength);
+    _crashStore.getSpace().onWrite(written);
+  }
+
+  if (strspn(_pcLine, " \t\r\n") < _uwLineLength)
+  {
+    _bSegmentContent = true;
+  }
+}
+
+/**
+ * @brief      Finish the current segment.
+ *
+ * @param[in]  bKeep  Flag to keep the segment as crash log or to remove it
+ */
+void EspSaveCrashCompactor::_finish_segment(bool bKeep)
+{
+  _bSegmentContent = false;
+
+  if (!_segmentFile)
+  {
+    return;
+  }
+
+  size_t segmentSize = _segmentFile.size();
+  _segmentFile.close();
+
+  if (bKeep)
+  {
+    // allocate some space for the filepath
+    char *nextFilePath = crashBufferAlloc();
+
+    // the segment becomes the next crash log
+    bool bRotated = _crashStore.rotateFile(_pcSegmentPath, nextFilePath, _crashStore.getDirectoryName(), _crashStore.getFilePattern(), _crashStore.getFileExtension());
+    if (bRotated)
+    {
+      // without a buffer the crash log is added by rebuildIndex() only
+      if (nextFilePath)
+      {
+        _crashStore._index_file(nextFilePath);
+      }
+      _ulSplitFiles++;
+    }
+
+    // free the allocated space
+    crashBufferFree(nextFilePath);
+
+    if (bRotated)
+    {
+      return;
+    }
+
+    // keep the original crash log, this segment is lost otherwise
+    _bSplitFailed = true;
+  }
+
+  _crashStore.getSpace().onRemove(segmentSize);
+  _crashStore.getFileSystem().remove(_pcSegmentPath);
+}
+
+/**
+ * @brief      Finish the split and remove the original crash log.
+ *
+ * The original crash log is kept if a segment could not be rotated, e.g.
+ * if no scratch buffer is left.
+ */
+void EspSaveCrashCompactor::_finish_file()
+{
+  if (_parser.finish())
+  {
+    // drop the truncated record at the end of the file
+    _finish_segment(false);
+    _ulDroppedRecords++;
+  }
+  else
+  {
+    _finish_segment(_bSegmentContent);
+  }
+
+  size_t fileSize = _file.size();
+  _file.close();
+
+  if (!_bSplitFailed)
+  {
+    _crashStore.getSpace().onRemove(fileSize);
+    _crashStore.getFileSystem().remove(_pcFilePath);
+    _crashStore._prune_index();
+  }
+
+  // the latest crash log has changed
+  _crashStore._update_last_file_name();
+}
@@ -0,0 +1,98 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashCompactor.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHCOMPACTOR_H_
+#define _ESPSAVECRASHCOMPACTOR_H_
+
+#include "EspSaveCrashSpiffs.h"
+#include "EspSaveCrashRecord.h"
+
+// name of the temporary file in the crash log directory
+#define CRASH_COMPACT_TMP_FILENAME "compact.tmp"
+
+/**
+ * Incremental compaction of the crash logs
+ *
+ * Crash log files holding several records, e.g. if the crash store was not
+ * constructed before the next crash, are split into one file per record.
+ * Truncated records are dropped. Other content of the file, e.g. saved by
+ * saveToSpiffsLog, is kept in a file of its own. Files with a single
+ * complete record are not touched.
+ *
+ * The split records get the next free crash log index. All rotated crash
+ * logs are checked once per boot, call restart() to check them again.
+ * The work is done in small steps by handle(), called in the loop(), each
+ * step is limited to a time budget.
+ */
+class EspSaveCrashCompactor
+{
+  public:
+    EspSaveCrashCompactor(EspSaveCrashSpiffs& crashStore);
+
+    bool handle(uint32_t ulBudget=CRASH_COMPACT_BUDGET_MS);
+    void restart();
+    bool isDone();
+    uint32_t getSplitFiles();
+    uint32_t getDroppedRecords();
+  private:
+    enum compactorState_t
+    {
+      COMPACT_FIND = 0,
+      COMPACT_SCAN,
+      COMPACT_SPLIT,
+      COMPACT_DONE
+    };
+
+    bool _open_next_file();
+    bool _read_line();
+    void _scan_line();
+    void _split_line();
+    void _write_segment();
+    void _finish_segment(bool bKeep);
+    void _finish_file();
+
+    EspSaveCrashSpiffs& _crashStore;
+    EspSaveCrashRecordParser _parser;
+    compactorState_t _state;
+    File _file;
+    File _segmentFile;
+    uint32_t _ulFileIndex;
+    uint32_t _ulCompleteRecords;
+    uint32_t _ulTruncatedRecords;
+    bool _bOtherContent;
+    bool _bSegmentContent;
+    bool _bSplitFailed;
+    uint32_t _ulSplitFiles;
+    uint32_t _ulDroppedRecords;
+    uint16_t _uwLineLength;
+    char _pcLine[CRASH_NAME_BUFFER_SIZE];
+    char _pcFilePath[CRASH_NAME_BUFFER_SIZE];
+    char _pcSegmentPath[CRASHFILEPATH_SIZE];
+};
+
+#endif
@@ -0,0 +1,236 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashConfig.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHCONFIG_H_
+#define _ESPSAVECRASHCONFIG_H_
+
+/**
+ * Compile time configuration
+ *
+ * All values can be overwritten by build flags, e.g. with PlatformIO
+ *   build_flags = -DCRASH_STACK_MAX_BYTES=512 -DCRASH_ENABLE_BREADCRUMBS=0
+ * Disabled features are not compiled at all, so they cost no flash or RAM.
+ * This file does not depend on the Arduino core.
+ */
+
+// use LittleFS instead of SPIFFS as filesystem of the default constructor
+// #define CRASH_USE_LITTLEFS
+
+// the crash log file MUST end with '-1.log' to iterate correctly
+// these are the defaults, use the constructor to change them per instance
+#define CRASHFILEPATH       "/"
+#define CRASHFILENAME       "crashLog-1.log"
+#define CRASHFILEPATTERN    "crashLog"
+#define CRASHFILEEXTENSION  "log"
+
+// name of the file in the crash log directory keeping the latest log name
+#ifndef LASTCRASHFILENAME
+#define LASTCRASHFILENAME "lastName.txt"
+#endif
+
+// name of the file in the crash log directory mapping crash logs to builds
+#ifndef CRASHINDEXFILENAME
+#define CRASHINDEXFILENAME "crashIndex.txt"
+#endif
+
+// name of the temporary file used to drop entries from the index
+#ifndef CRASHINDEXTMPFILENAME
+#define CRASHINDEXTMPFILENAME "crashIndex.tmp"
+#endif
+
+// build id saved with each crash log, e.g. -DCRASH_BUILD_ID=\"v1.2.3\"
+// defaults to the compile time of this library, which is not rebuilt by
+// the Arduino IDE if only the sketch changes, so it does not identify the
+// firmware. Set it for each firmware build or use setBuildId()
+#ifndef CRASH_BUILD_ID
+#define CRASH_BUILD_ID __DATE__ " " __TIME__
+#endif
+
+// maximum length of a saved build id including the terminating '\0'
+#ifndef CRASH_RECORD_BUILD_ID_SIZE
+#define CRASH_RECORD_BUILD_ID_SIZE 48
+#endif
+
+#ifndef LASTCRASHFILEPATH
+#define LASTCRASHFILEPATH CRASHFILEPATH LASTCRASHFILENAME
+#endif
+
+// print debug output of the crash store, e.g. -DCRASH_DEBUG_PORT=Serial
+// nothing is printed by default, the serial interface belongs to the sketch
+#ifdef CRASH_DEBUG_PORT
+#define CRASH_DEBUG_PRINTF(...) CRASH_DEBUG_PORT.printf(__VA_ARGS__)
+#else
+#define CRASH_DEBUG_PRINTF(...)
+#endif
+
+// maximum length of a crash log filepath including the directory
+#ifndef CRASHFILEPATH_SIZE
+#define CRASHFILEPATH_SIZE  64
+#endif
+
+// size of the buffers used to crawl directories and build file names
+#ifndef CRASH_NAME_BUFFER_SIZE
+#define CRASH_NAME_BUFFER_SIZE 255
+#endif
+
+// take all scratch buffers from a static arena instead of the heap
+#ifndef CRASH_HEAP_FREE
+#define CRASH_HEAP_FREE 0
+#endif
+
+// number of scratch buffers of the static arena, removeFile needs 5 at once
+#ifndef CRASH_ARENA_BUFFERS
+#define CRASH_ARENA_BUFFERS 5
+#endif
+
+// size of the line buffer of the crash callback, the longest line is 83
+#ifndef CRASH_LINE_BUFFER_SIZE
+#define CRASH_LINE_BUFFER_SIZE 100
+#endif
+
+// maximum number of stack bytes saved, starting at the stack pointer
+#ifndef CRASH_STACK_MAX_BYTES
+#define CRASH_STACK_MAX_BYTES 4096
+#endif
+
+// maximum number of bytes returned by readSince, cut at a line end
+#ifndef CRASH_SYNC_MAX_BYTES
+#define CRASH_SYNC_MAX_BYTES 2048
+#endif
+
+// time budget in ms of a single EspSaveCrashCompactor::handle() call
+#ifndef CRASH_COMPACT_BUDGET_MS
+#define CRASH_COMPACT_BUDGET_MS 5
+#endif
+
+// number of directory entries crawled by a single rotateAsync() call
+#ifndef CRASH_ROTATE_STEP_ENTRIES
+#define CRASH_ROTATE_STEP_ENTRIES 8
+#endif
+
+// save free heap, heap fragmentation and max free block
+#ifndef CRASH_ENABLE_HEAP_INFO
+#define CRASH_ENABLE_HEAP_INFO 1
+#endif
+
+// save the breadcrumbs added by crashBreadcrumb()
+#ifndef CRASH_ENABLE_BREADCRUMBS
+#define CRASH_ENABLE_BREADCRUMBS 1
+#endif
+
+// save a CRC32 with each crash record to detect corrupted records
+#ifndef CRASH_ENABLE_CRC
+#define CRASH_ENABLE_CRC 1
+#endif
+
+// save a HMAC-SHA256 with each crash record, see setCrashHmacKey()
+#ifndef CRASH_ENABLE_HMAC
+#define CRASH_ENABLE_HMAC 0
+#endif
+
+// save a hexdump of the memory around excvaddr and each epc
+#ifndef CRASH_ENABLE_MEMORY_WINDOW
+#define CRASH_ENABLE_MEMORY_WINDOW 1
+#endif
+
+// number of bytes of each memory window, centered on the address
+#ifndef CRASH_MEMORY_WINDOW_BYTES
+#define CRASH_MEMORY_WINDOW_BYTES 32
+#endif
+
+// detect crash loops and keep the state in the RTC memory
+#ifndef CRASH_ENABLE_CRASHLOOP
+#define CRASH_ENABLE_CRASHLOOP 1
+#endif
+
+// offset in the RTC user memory (4 byte blocks) to keep the crash loop state
+#ifndef CRASHLOOP_RTC_OFFSET
+#define CRASHLOOP_RTC_OFFSET 124
+#endif
+
+// sample repeated crashes and limit the flash bytes of crash logs
+#ifndef CRASH_ENABLE_POLICY
+#define CRASH_ENABLE_POLICY 1
+#endif
+
+// number of crash signatures remembered to detect repeats
+#ifndef CRASH_POLICY_SIGNATURES
+#define CRASH_POLICY_SIGNATURES 8
+#endif
+
+// size of the policy state in the RTC user memory (4 byte blocks)
+#define CRASH_POLICY_RTC_BLOCKS (6 + CRASH_POLICY_SIGNATURES)
+
+// offset in the RTC user memory (4 byte blocks) to keep the policy state,
+// blocks 0 to 31 are overwritten by OTA updates and the boot loader
+#ifndef CRASH_POLICY_RTC_OFFSET
+#define CRASH_POLICY_RTC_OFFSET 32
+#endif
+
+// capture crashes with an IRAM handler, saved to flash on the next boot
+#ifndef CRASH_IRAM_CAPTURE
+#define CRASH_IRAM_CAPTURE 0
+#endif
+
+// offset in the RTC user memory (4 byte blocks) of the IRAM crash snapshot
+#ifndef CRASH_SNAPSHOT_RTC_OFFSET
+#define CRASH_SNAPSHOT_RTC_OFFSET (CRASH_POLICY_RTC_OFFSET + CRASH_POLICY_RTC_BLOCKS)
+#endif
+
+// number of stack words (4 byte) kept in the IRAM crash snapshot
+#ifndef CRASH_SNAPSHOT_STACK_WORDS
+#define CRASH_SNAPSHOT_STACK_WORDS 64
+#endif
+
+static_assert(CRASHFILEPATH_SIZE <= CRASH_NAME_BUFFER_SIZE, "CRASHFILEPATH_SIZE must fit into CRASH_NAME_BUFFER_SIZE");
+static_assert(CRASH_RECORD_BUILD_ID_SIZE >= 8, "CRASH_RECORD_BUILD_ID_SIZE must be at least 8");
+static_assert(CRASH_LINE_BUFFER_SIZE >= 84, "CRASH_LINE_BUFFER_SIZE must hold the longest line of 83 chars");
+static_assert((CRASH_STACK_MAX_BYTES % 16) == 0, "CRASH_STACK_MAX_BYTES must be a multiple of 16");
+static_assert(CRASH_STACK_MAX_BYTES <= 0x7FF0, "CRASH_STACK_MAX_BYTES must fit into int16_t");
+static_assert(((CRASH_MEMORY_WINDOW_BYTES % 8) == 0) && (CRASH_MEMORY_WINDOW_BYTES <= 256), "CRASH_MEMORY_WINDOW_BYTES must be a multiple of 8 up to 256");
+static_assert((CRASHLOOP_RTC_OFFSET >= 32) && (CRASHLOOP_RTC_OFFSET <= 124), "CRASHLOOP_RTC_OFFSET must be within the RTC user memory blocks 32 to 127");
+#if CRASH_ENABLE_POLICY
+static_assert(CRASH_POLICY_RTC_OFFSET >= 32, "CRASH_POLICY_RTC_OFFSET must not use the RTC user memory blocks 0 to 31 of OTA");
+static_assert((CRASH_POLICY_RTC_OFFSET + CRASH_POLICY_RTC_BLOCKS) <= 128, "Crash policy state must be within the 128 RTC user memory blocks");
+#if CRASH_ENABLE_CRASHLOOP
+static_assert(((CRASH_POLICY_RTC_OFFSET + CRASH_POLICY_RTC_BLOCKS) <= CRASHLOOP_RTC_OFFSET) || (CRASH_POLICY_RTC_OFFSET >= (CRASHLOOP_RTC_OFFSET + 4)), "Crash policy state overlaps the crash loop state");
+#endif
+#if CRASH_IRAM_CAPTURE
+static_assert(((CRASH_POLICY_RTC_OFFSET + CRASH_POLICY_RTC_BLOCKS) <= CRASH_SNAPSHOT_RTC_OFFSET) || (CRASH_POLICY_RTC_OFFSET >= (CRASH_SNAPSHOT_RTC_OFFSET + 12 + CRASH_SNAPSHOT_STACK_WORDS)), "Crash policy state overlaps the IRAM crash snapshot");
+#endif
+#endif
+static_assert((CRASH_SNAPSHOT_STACK_WORDS % 4) == 0, "CRASH_SNAPSHOT_STACK_WORDS must be a multiple of 4");
+#if CRASH_IRAM_CAPTURE
+static_assert(CRASH_SNAPSHOT_RTC_OFFSET >= 32, "CRASH_SNAPSHOT_RTC_OFFSET must not use the RTC user memory blocks 0 to 31 of OTA");
+static_assert((CRASH_SNAPSHOT_RTC_OFFSET + 12 + CRASH_SNAPSHOT_STACK_WORDS) <= 128, "IRAM crash snapshot must be within the 128 RTC user memory blocks");
+#if CRASH_ENABLE_CRASHLOOP
+static_assert(((CRASH_SNAPSHOT_RTC_OFFSET + 12 + CRASH_SNAPSHOT_STACK_WORDS) <= CRASHLOOP_RTC_OFFSET) || (CRASH_SNAPSHOT_RTC_OFFSET >= (CRASHLOOP_RTC_OFFSET + 4)), "IRAM crash snapshot overlaps the crash loop state");
+#endif
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashCrc.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "EspSaveCrashCrc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// CRC32 (IEEE 802.3, reflected) of each nibble, 64 byte instead of 1 kB
+static const uint32_t pulCrcTable[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+  0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+  0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/**
+ * @brief      Update a CRC32 with some data.
+ *
+ * Same result as the CRC32 of zlib, start with a CRC of zero and pass the
+ * result of the previous call to continue the calculation.
+ *
+ * @param[in]  ulCrc    The CRC of the previous data
+ * @param[in]  pvData   The data
+ * @param[in]  length   The length of the data
+ *
+ * @return     The updated CRC
+ */
+uint32_t crashCrc32(uint32_t ulCrc, const void* pvData, size_t length)
+{
+  const uint8_t* pubData = (const uint8_t*)pvData;
+
+  ulCrc = ~ulCrc;
+
+  while (length--)
+  {
+    ulCrc ^= *pubData++;
+    ulCrc = (ulCrc >> 4) ^ pulCrcTable[ulCrc & 0x0F];
+    ulCrc = (ulCrc >> 4) ^ pulCrcTable[ulCrc & 0x0F];
+  }
+
+  return ~ulCrc;
+}
+
+/**
+ * @brief      Constructs a new instance.
+ */
+EspSaveCrashVerifier::EspSaveCrashVerifier()
+{
+  _ulValidRecords = 0;
+  _ulInvalidRecords = 0;
+  _ulTruncatedRecords = 0;
+  reset();
+}
+
+/**
+ * @brief      Drop a partially checked record.
+ *
+ * Call this before checking another file.
+ */
+void EspSaveCrashVerifier::reset()
+{
+  _ulCrc = 0;
+  _bInRecord = false;
+  _bLineStart = true;
+}
+
+/**
+ * @brief      Check a line of a crash log.
+ *
+ * The line ends with the '\n', a line without '\n' is continued by the
+ * next call. Only the start of a line is checked for the record markers.
+ *
+ * @param[in]  pcLine  The line or a part of it
+ *
+ * @return     The result of the check if the line is the CRC of a record,
+ *             CRASH_INTEGRITY_TRUNCATED if it starts a record while the
+ *             previous one is still open, CRASH_INTEGRITY_NONE for any
+ *             other line
+ */
+crashIntegrity_t EspSaveCrashVerifier::parseLine(const char* pcLine)
+{
+  size_t lineLength = strcspn(pcLine, "\r\n");
+  bool bLineStart = _bLineStart;
+  crashIntegrity_t integrity = CRASH_INTEGRITY_NONE;
+
+  // the next call continues this line, unless it is complete
+  _bLineStart = (strchr(pcLine + lineLength, '\n') != NULL);
+
+  if (!bLineStart)
+  {
+    // the rest of a line is part of the CRC only
+    if (!_bInRecord)
+    {
+      return CRASH_INTEGRITY_NONE;
+    }
+  }
+  else if (strncmp(pcLine, "Crashed at ", strlen("Crashed at ")) == 0)
+  {
+    // a new record starts, a previous one without CRC has been truncated
+    if (_bInRecord)
+    {
+      _ulTruncatedRecords++;
+      integrity = CRASH_INTEGRITY_TRUNCATED;
+    }
+    _ulCrc = 0;
+    _bInRecord = true;
+  }
+  else if (!_bInRecord)
+  {
+    return CRASH_INTEGRITY_NONE;
+  }
+  else if (strncmp(pcLine, "CRC: ", strlen("CRC: ")) == 0)
+  {
+    char* pcEnd;
+    uint32_t ulCrc = strtoul(pcLine + strlen("CRC: "), &pcEnd, 16);
+
+    _bInRecord = false;
+
+    if ((pcEnd != (pcLine + strlen("CRC: "))) && (ulCrc == _ulCrc))
+    {
+      _ulValidRecords++;
+      return CRASH_INTEGRITY_VALID;
+    }
+
+    _ulInvalidRecords++;
+    return CRASH_INTEGRITY_INVALID;
+  }
+  else if (strncmp(pcLine, "<<<stack<<<", strlen("<<<stack<<<")) == 0)
+  {
+    // end of a record without CRC
+    _bInRecord = false;
+    return CRASH_INTEGRITY_NONE;
+  }
+
+  _ulCrc = crashCrc32(_ulCrc, pcLine, lineLength);
+  if (_bLineStart)
+  {
+    _ulCrc = crashCrc32(_ulCrc, "\n", 1);
+  }
+
+  return integrity;
+}
+
+/**
+ * @brief      Check the end of the input.
+ *
+ * Call this at the end of a file or transfer. A record without CRC line and
+ * without the end of the stack has been truncated, e.g. by a reset during
+ * the write.
+ *
+ * @return     CRASH_INTEGRITY_TRUNCATED if a record is open,
+ *             CRASH_INTEGRITY_NONE otherwise
+ */
+crashIntegrity_t EspSaveCrashVerifier::finish()
+{
+  bool bInRecord = _bInRecord;
+
+  reset();
+
+  if (bInRecord)
+  {
+    _ulTruncatedRecords++;
+    return CRASH_INTEGRITY_TRUNCATED;
+  }
+
+  return CRASH_INTEGRITY_NONE;
+}
+
+/**
+ * @brief      Gets the number of records with a valid CRC.
+ *
+ * @return     The valid records.
+ */
+uint32_t EspSaveCrashVerifier::getValidRecords() const
+{
+  return _ulValidRecords;
+}
+
+/**
+ * @brief      Gets the number of records with an invalid CRC.
+ *
+ * @return     The invalid records.
+ */
+uint32_t EspSaveCrashVerifier::getInvalidRecords() const
+{
+  return _ulInvalidRecords;
+}
+
+/**
+ * @brief      Gets the number of records truncated before their CRC.
+ *
+ * @return     The truncated records.
+ */
+uint32_t EspSaveCrashVerifier::getTruncatedRecords() const
+{
+  return _ulTruncatedRecords;
+}
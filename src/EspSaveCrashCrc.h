@@ -0,0 +1,83 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashCrc.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHCRC_H_
+#define _ESPSAVECRASHCRC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Result of the integrity check of a crash record
+ */
+enum crashIntegrity_t
+{
+  // no checksum, e.g. saved by an older version of this library
+  CRASH_INTEGRITY_NONE = 0,
+  CRASH_INTEGRITY_VALID,
+  CRASH_INTEGRITY_INVALID,
+  // no CRC, cut by the next record or the end of the input
+  CRASH_INTEGRITY_TRUNCATED
+};
+
+/**
+ * Line based integrity check of the crash records
+ *
+ * The CRC32 of a record covers all lines from "Crashed at" up to the
+ * "CRC: " line, each line with a single '\n' as line ending. Feed the lines
+ * including their '\n' or '\r\n'. A line may be fed in several parts, e.g.
+ * if it is longer than the line buffer, a part without '\n' is continued by
+ * the next one. A record cut before its CRC line is reported as truncated
+ * by the start of the next record or by finish() at the end of the input.
+ *
+ * This class does not depend on the Arduino core and does not allocate
+ * memory, so it is used on the device and by the host tools in extras.
+ */
+class EspSaveCrashVerifier
+{
+  public:
+    EspSaveCrashVerifier();
+
+    void reset();
+    crashIntegrity_t parseLine(const char* pcLine);
+    crashIntegrity_t finish();
+    uint32_t getValidRecords() const;
+    uint32_t getInvalidRecords() const;
+    uint32_t getTruncatedRecords() const;
+  private:
+    uint32_t _ulCrc;
+    bool _bInRecord;
+    bool _bLineStart;
+    uint32_t _ulValidRecords;
+    uint32_t _ulInvalidRecords;
+    uint32_t _ulTruncatedRecords;
+};
+
+uint32_t crashCrc32(uint32_t ulCrc, const void* pvData, size_t length);
+
+#endif
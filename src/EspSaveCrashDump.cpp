@@ -0,0 +1,385 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashDump.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "EspSaveCrashDump.h"
+
+/**
+ * @brief      Gets a 32 bit little endian value.
+ *
+ * @param[in]  pubData  The data
+ *
+ * @return     The value.
+ */
+static uint32_t _get_value(const uint8_t* pubData)
+{
+  return pubData[0] | (pubData[1] << 8) | (pubData[2] << 16) | ((uint32_t)pubData[3] << 24);
+}
+
+/**
+ * @brief      Sets a 32 bit little endian value.
+ *
+ * @param      pubData  The data
+ * @param[in]  ulValue  The value
+ */
+static void _set_value(uint8_t* pubData, uint32_t ulValue)
+{
+  pubData[0] = ulValue & 0xFF;
+  pubData[1] = (ulValue >> 8) & 0xFF;
+  pubData[2] = (ulValue >> 16) & 0xFF;
+  pubData[3] = (ulValue >> 24) & 0xFF;
+}
+
+/**
+ * @brief      Constructs a new instance.
+ *
+ * @param      crashStore  The crash store to transfer
+ * @param      stream      The stream, e.g. Serial
+ *
+ * Example usage:
+ * @code
+ *    EspSaveCrashSpiffs SaveCrashSpiffs(0);
+ *    EspSaveCrashDump CrashDump(SaveCrashSpiffs, Serial);
+ *
+ *    void setup()
+ *    {
+ *      // a higher baudrate speeds up the transfer
+ *      Serial.begin(921600);
+ *      SaveCrashSpiffs.begin();
+ *    }
+ *
+ *    void loop()
+ *    {
+ *      CrashDump.handle();
+ *    }
+ * @endcode
+ */
+EspSaveCrashDump::EspSaveCrashDump(EspSaveCrashSpiffs& crashStore, Stream& stream) :
+  _crashStore(crashStore),
+  _stream(stream)
+{
+  _uwRequestLength = 0;
+  _ubSequence = 0;
+  _ulLastByte = 0;
+}
+
+/**
+ * @brief      Receive and process the requests of the host.
+ *
+ * Call this in the loop(). The received bytes are collected without
+ * blocking, a complete request is processed at once.
+ *
+ * @retval     True   A request has been processed
+ * @retval     False  No complete request
+ */
+bool EspSaveCrashDump::handle()
+{
+  while (_stream.available() > 0)
+  {
+    int iByte = _stream.read();
+
+    if (iByte < 0)
+    {
+      break;
+    }
+
+    // drop a partial request of a host gone away
+    if (_uwRequestLength && ((millis() - _ulLastByte) > CRASH_DUMP_TIMEOUT_MS))
+    {
+      _uwRequestLength = 0;
+    }
+    _ulLastByte = millis();
+
+    // skip everything before the start of a frame
+    if (!_uwRequestLength && (iByte != CRASH_DUMP_SOF))
+    {
+      continue;
+    }
+
+    _pubRequest[_uwRequestLength++] = (uint8_t)iByte;
+
+    if (_uwRequestLength < CRASH_DUMP_HEADER_SIZE)
+    {
+      continue;
+    }
+
+    uint16_t uwPayloadLength = _pubRequest[3] | (_pubRequest[4] << 8);
+
+    if (uwPayloadLength > CRASH_DUMP_REQUEST_SIZE)
+    {
+      _ubSequence = _pubRequest[2];
+      _uwRequestLength = 0;
+      _send_error(CRASH_DUMP_ERR_LENGTH);
+      return true;
+    }
+
+    if (_uwRequestLength == (CRASH_DUMP_HEADER_SIZE + uwPayloadLength + CRASH_DUMP_CRC_SIZE))
+    {
+      _process_request();
+      _uwRequestLength = 0;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief      Check and process a complete request.
+ */
+void EspSaveCrashDump::_process_request()
+{
+  uint8_t ubCommand = _pubRequest[1];
+  uint16_t uwPayloadLength = _pubRequest[3] | (_pubRequest[4] << 8);
+  const uint8_t* pubPayload = _pubRequest + CRASH_DUMP_HEADER_SIZE;
+
+  _ubSequence = _pubRequest[2];
+
+  // the CRC covers everything behind the start of the frame
+  uint32_t ulCrc = crashCrc32(0, _pubRequest + 1, CRASH_DUMP_HEADER_SIZE - 1 + uwPayloadLength);
+  if (ulCrc != _get_value(pubPayload + uwPayloadLength))
+  {
+    _send_error(CRASH_DUMP_ERR_CRC);
+    return;
+  }
+
+  switch (ubCommand)
+  {
+    case CRASH_DUMP_CMD_LIST:
+      _list_files();
+      break;
+    case CRASH_DUMP_CMD_FETCH:
+      if (uwPayloadLength != 4)
+      {
+        _send_error(CRASH_DUMP_ERR_LENGTH);
+        break;
+      }
+      _fetch_files(_get_value(pubPayload), _get_value(pubPayload));
+      break;
+    case CRASH_DUMP_CMD_FETCH_RANGE:
+      if (uwPayloadLength != 8)
+      {
+        _send_error(CRASH_DUMP_ERR_LENGTH);
+        break;
+      }
+      _fetch_files(_get_value(pubPayload), _get_value(pubPayload + 4));
+      break;
+    case CRASH_DUMP_CMD_DELETE:
+      if (uwPayloadLength != 8)
+      {
+        _send_error(CRASH_DUMP_ERR_LENGTH);
+        break;
+      }
+      _send_values(CRASH_DUMP_RSP_END, _crashStore.removeRange(_get_value(pubPayload), _get_value(pubPayload + 4)), 0, 1);
+      break;
+    default:
+      _send_error(CRASH_DUMP_ERR_COMMAND);
+      break;
+  }
+}
+
+/**
+ * @brief      Send the index and size of each crash log.
+ *
+ * The directory is crawled once, the crash logs are not sorted.
+ */
+void EspSaveCrashDump::_list_files()
+{
+  uint32_t ulFiles = 0;
+  Dir thisDirectory = _crashStore.getFileSystem().openDir(_crashStore.getDirectoryName());
+
+  while (thisDirectory.next())
+  {
+    uint32_t ulThisFileIndex;
+
+    // keep the String, c_str() is only valid as long as it exists
+    String thisRawFilePath = thisDirectory.fileName();
+
+    // get only the filename without any directory
+    const char* thisFile = _crashStore._get_file_name(thisRawFilePath.c_str(), _crashStore.getDirectoryName());
+
+    if (!thisFile || !_crashStore._get_file_index(thisFile, _crashStore.getFilePattern(), _crashStore.getFileExtension(), &ulThisFileIndex))
+    {
+      continue;
+    }
+
+    _send_values(CRASH_DUMP_RSP_ENTRY, ulThisFileIndex, thisDirectory.fileSize(), 2);
+    ulFiles++;
+
+    // keep the WiFi and the watchdog alive
+    yield();
+  }
+
+  _send_values(CRASH_DUMP_RSP_END, ulFiles, 0, 1);
+}
+
+/**
+ * @brief      Send the crash logs of an index range.
+ *
+ * The directory is crawled once, the crash logs are not sorted. A single
+ * crash log not found is answered with CRASH_DUMP_ERR_NOT_FOUND.
+ *
+ * @param[in]  ulFirstIndex  The first index
+ * @param[in]  ulLastIndex   The last index
+ */
+void EspSaveCrashDump::_fetch_files(uint32_t ulFirstIndex, uint32_t ulLastIndex)
+{
+  uint32_t ulFiles = 0;
+  Dir thisDirectory = _crashStore.getFileSystem().openDir(_crashStore.getDirectoryName());
+
+  // allocate some space for the filepath and the file content
+  char *thisFilePath = crashBufferAlloc();
+  uint8_t *pubBuffer = (uint8_t*)crashBufferAlloc();
+
+  while (thisFilePath && pubBuffer && thisDirectory.next())
+  {
+    uint32_t ulThisFileIndex;
+
+    // keep the String, c_str() is only valid as long as it exists
+    String thisRawFilePath = thisDirectory.fileName();
+
+    // get only the filename without any directory
+    const char* thisFile = _crashStore._get_file_name(thisRawFilePath.c_str(), _crashStore.getDirectoryName());
+
+    if (!thisFile || !_crashStore._get_file_index(thisFile, _crashStore.getFilePattern(), _crashStore.getFileExtension(), &ulThisFileIndex))
+    {
+      continue;
+    }
+
+    if ((ulThisFileIndex < ulFirstIndex) || (ulThisFileIndex > ulLastIndex))
+    {
+      continue;
+    }
+
+    // SPIFFS returns the full path, LittleFS only the file name
+    if (_crashStore._get_file_path(thisRawFilePath.c_str(), thisFilePath) && _send_file(ulThisFileIndex, thisFilePath, pubBuffer))
+    {
+      ulFiles++;
+    }
+  }
+
+  // free the allocated space
+  crashBufferFree(thisFilePath);
+  crashBufferFree((char*)pubBuffer);
+
+  if (!ulFiles && (ulFirstIndex == ulLastIndex))
+  {
+    _send_error(CRASH_DUMP_ERR_NOT_FOUND);
+    return;
+  }
+
+  _send_values(CRASH_DUMP_RSP_END, ulFiles, 0, 1);
+}
+
+/**
+ * @brief      Send a crash log as FILE frame followed by DATA frames.
+ *
+ * @param[in]  ulFileIndex  The file index
+ * @param[in]  filePath     The file path
+ * @param      pubBuffer    The buffer of CRASH_NAME_BUFFER_SIZE byte
+ *
+ * @retval     True   Success
+ * @retval     False  Failed to open the file
+ */
+bool EspSaveCrashDump::_send_file(uint32_t ulFileIndex, const char* filePath, uint8_t* pubBuffer)
+{
+  File theFile = _crashStore.getFileSystem().open(filePath, "r");
+
+  if (!theFile)
+  {
+    return false;
+  }
+
+  _send_values(CRASH_DUMP_RSP_FILE, ulFileIndex, theFile.size(), 2);
+
+  while (theFile.available())
+  {
+    size_t length = theFile.read(pubBuffer, CRASH_NAME_BUFFER_SIZE);
+    if (!length)
+    {
+      break;
+    }
+
+    _send_frame(CRASH_DUMP_RSP_DATA, pubBuffer, length);
+
+    // keep the WiFi and the watchdog alive
+    yield();
+  }
+
+  theFile.close();
+
+  return true;
+}
+
+/**
+ * @brief      Send a frame.
+ *
+ * @param[in]  ubType      The response type
+ * @param[in]  pubPayload  The payload
+ * @param[in]  uwLength    The payload length
+ */
+void EspSaveCrashDump::_send_frame(uint8_t ubType, const uint8_t* pubPayload, uint16_t uwLength)
+{
+  uint8_t pubHeader[CRASH_DUMP_HEADER_SIZE] = {CRASH_DUMP_SOF, ubType, _ubSequence, (uint8_t)(uwLength & 0xFF), (uint8_t)(uwLength >> 8)};
+  uint8_t pubCrc[CRASH_DUMP_CRC_SIZE];
+
+  uint32_t ulCrc = crashCrc32(0, pubHeader + 1, CRASH_DUMP_HEADER_SIZE - 1);
+  ulCrc = crashCrc32(ulCrc, pubPayload, uwLength);
+  _set_value(pubCrc, ulCrc);
+
+  _stream.write(pubHeader, sizeof(pubHeader));
+  _stream.write(pubPayload, uwLength);
+  _stream.write(pubCrc, sizeof(pubCrc));
+}
+
+/**
+ * @brief      Send a frame with one or two values.
+ *
+ * @param[in]  ubType    The response type
+ * @param[in]  ulFirst   The first value
+ * @param[in]  ulSecond  The second value
+ * @param[in]  ubValues  The number of values, 1 or 2
+ */
+void EspSaveCrashDump::_send_values(uint8_t ubType, uint32_t ulFirst, uint32_t ulSecond, uint8_t ubValues)
+{
+  uint8_t pubPayload[8];
+
+  _set_value(pubPayload, ulFirst);
+  _set_value(pubPayload + 4, ulSecond);
+
+  _send_frame(ubType, pubPayload, 4 * ubValues);
+}
+
+/**
+ * @brief      Send an error frame.
+ *
+ * @param[in]  ubError  The error code
+ */
+void EspSaveCrashDump::_send_error(uint8_t ubError)
+{
+  _send_frame(CRASH_DUMP_RSP_ERROR, &ubError, 1);
+}
@@ -0,0 +1,113 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashDump.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHDUMP_H_
+#define _ESPSAVECRASHDUMP_H_
+
+#include "EspSaveCrashSpiffs.h"
+
+// start of each frame
+#define CRASH_DUMP_SOF              0xA5
+
+// requests of the host
+#define CRASH_DUMP_CMD_LIST         0x01
+#define CRASH_DUMP_CMD_FETCH        0x02
+#define CRASH_DUMP_CMD_FETCH_RANGE  0x03
+#define CRASH_DUMP_CMD_DELETE       0x04
+
+// responses of the device
+#define CRASH_DUMP_RSP_ENTRY        0x81
+#define CRASH_DUMP_RSP_FILE         0x82
+#define CRASH_DUMP_RSP_DATA         0x83
+#define CRASH_DUMP_RSP_END          0x84
+#define CRASH_DUMP_RSP_ERROR        0x8F
+
+// error codes of CRASH_DUMP_RSP_ERROR
+#define CRASH_DUMP_ERR_CRC          0x01
+#define CRASH_DUMP_ERR_COMMAND      0x02
+#define CRASH_DUMP_ERR_LENGTH       0x03
+#define CRASH_DUMP_ERR_NOT_FOUND    0x04
+
+// start, command, sequence number and payload length
+#define CRASH_DUMP_HEADER_SIZE      5
+// CRC32 of the frame
+#define CRASH_DUMP_CRC_SIZE         4
+// maximum payload of a request, all requests carry at most two indexes
+#define CRASH_DUMP_REQUEST_SIZE     8
+
+// a partial request is dropped after this time in ms
+#ifndef CRASH_DUMP_TIMEOUT_MS
+#define CRASH_DUMP_TIMEOUT_MS 100
+#endif
+
+/**
+ * Framed binary transfer of the crash logs over any Stream
+ *
+ * Each frame is
+ *    0xA5 | command | sequence | length (2, LE) | payload | CRC32 (4, LE)
+ * with the CRC32 (same as zlib) over command, sequence, length and
+ * payload. The responses carry the sequence number of the request.
+ *
+ * Requests of the host:
+ *    LIST                           ENTRY (index, size)... END (count)
+ *    FETCH (index)                  FILE (index, size) DATA... END (count)
+ *    FETCH_RANGE (first, last)      [FILE DATA...]... END (count)
+ *    DELETE (first, last)           END (count)
+ * All values are 32 bit little endian, any request may be answered with
+ * ERROR (code). The file content is sent as raw bytes in DATA frames of
+ * up to CRASH_NAME_BUFFER_SIZE byte. DELETE removes only rotated crash
+ * logs, the current one with index 1 is kept.
+ *
+ * Bytes before the start of a frame are skipped, so debug output on the
+ * same serial interface does not break the transfer. See the host client
+ * in extras/CrashDump.
+ */
+class EspSaveCrashDump
+{
+  public:
+    EspSaveCrashDump(EspSaveCrashSpiffs& crashStore, Stream& stream);
+
+    bool handle();
+  private:
+    void _process_request();
+    void _list_files();
+    void _fetch_files(uint32_t ulFirstIndex, uint32_t ulLastIndex);
+    bool _send_file(uint32_t ulFileIndex, const char* filePath, uint8_t* pubBuffer);
+    void _send_frame(uint8_t ubType, const uint8_t* pubPayload, uint16_t uwLength);
+    void _send_values(uint8_t ubType, uint32_t ulFirst, uint32_t ulSecond, uint8_t ubValues);
+    void _send_error(uint8_t ubError);
+
+    EspSaveCrashSpiffs& _crashStore;
+    Stream& _stream;
+    uint8_t _pubRequest[CRASH_DUMP_HEADER_SIZE + CRASH_DUMP_REQUEST_SIZE + CRASH_DUMP_CRC_SIZE];
+    uint16_t _uwRequestLength;
+    uint8_t _ubSequence;
+    uint32_t _ulLastByte;
+};
+
+#endif
@@ -0,0 +1,391 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashLogger.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "EspSaveCrashLogger.h"
+
+// the logger which is flushed in case of a crash
+EspSaveCrashLogger* pCrashLogger;
+
+// single char of each log level
+static const char pcLogLevels[] = "DIWE";
+
+#if CRASH_HEAP_FREE
+// static staging buffer, shared by all loggers
+static char pcLoggerBuffer[CRASHLOGGER_BUFFER_SIZE];
+#endif
+
+/**
+ * @brief      Constructs a new instance.
+ *
+ * Nothing is allocated or opened here, call begin() in setup().
+ *
+ * @param      crashStore    The crash store used for the rotation
+ * @param[in]  filePattern   The file pattern, e.g. 'eventLog'
+ * @param[in]  uwBufferSize  The size of the staging buffer in byte, at
+ *                           least CRASHLOGGER_MIN_BUFFER_SIZE
+ */
+EspSaveCrashLogger::EspSaveCrashLogger(EspSaveCrashSpiffs& crashStore, const char* filePattern, uint16_t uwBufferSize) :
+  _crashStore(crashStore)
+{
+  _pcFilePattern = filePattern;
+  _pcBuffer = NULL;
+  _uwBufferSize = (uwBufferSize < CRASHLOGGER_MIN_BUFFER_SIZE) ? CRASHLOGGER_MIN_BUFFER_SIZE : uwBufferSize;
+  _uwBufferLength = 0;
+  _level = CRASH_LOG_INFO;
+  _ulFlushInterval = CRASHLOGGER_FLUSH_INTERVAL;
+  _ulMaxFileSize = CRASHLOGGER_MAX_FILE_SIZE;
+  _ulLastFlush = 0;
+  _ulDroppedLines = 0;
+  _bFlushing = false;
+  _pcFilePath[0] = '\0';
+}
+
+/**
+ * @brief      Allocate the staging buffer and register the crash flush.
+ *
+ * With CRASH_HEAP_FREE a static buffer of CRASHLOGGER_BUFFER_SIZE is used.
+ *
+ * The log file is kept in the directory of the crash store, e.g.
+ * '/crash/eventLog-1.log'
+ *
+ * @retval     True   Success
+ * @retval     False  Failed to allocate the staging buffer
+ */
+bool EspSaveCrashLogger::begin()
+{
+  if (!_pcBuffer)
+  {
+#if CRASH_HEAP_FREE
+    // only the static buffer is available, use one logger at a time
+    _pcBuffer = pcLoggerBuffer;
+    if (_uwBufferSize > sizeof(pcLoggerBuffer))
+    {
+      _uwBufferSize = sizeof(pcLoggerBuffer);
+    }
+#else
+    _pcBuffer = (char*)calloc(_uwBufferSize, sizeof(char));
+#endif
+  }
+
+  if (!_pcBuffer)
+  {
+    return false;
+  }
+
+  // create the filepath (must always start with '/')
+  snprintf(_pcFilePath, sizeof(_pcFilePath), "%s%s-1.%s", _crashStore.getDirectoryName(), _pcFilePattern, _crashStore.getFileExtension());
+
+  _ulLastFlush = millis();
+
+  // save the pending lines in case of a crash
+  pCrashLogger = this;
+  setCrashFlushCallback(_emergency_flush);
+
+  return true;
+}
+
+/**
+ * @brief      Flush the staging buffer if the flush interval elapsed.
+ *
+ * Call this in the loop()
+ */
+void EspSaveCrashLogger::handle()
+{
+  if (_uwBufferLength && ((millis() - _ulLastFlush) >= _ulFlushInterval))
+  {
+    flush();
+  }
+}
+
+/**
+ * @brief      Add a line to the log.
+ *
+ * The line is dropped if the level is below the configured level. If the
+ * line does not fit into the remaining space, the staging buffer is flushed
+ * first. Only lines longer than the staging buffer are truncated.
+ *
+ * @param[in]  level      The log level
+ * @param[in]  format     The printf like format
+ *
+ * @retval     True   Line has been added
+ * @retval     False  Line has been dropped
+ *
+ * Example usage:
+ * @code
+ *    EventLogger.log(CRASH_LOG_ERROR, "WiFi connection lost after %d ms", ulUptime);
+ * @endcode
+ */
+bool EspSaveCrashLogger::log(crashLogLevel_t level, const char* format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  bool bResult = vlog(level, format, args);
+  va_end(args);
+
+  return bResult;
+}
+
+/**
+ * @brief      Add a line to the log.
+ *
+ * @param[in]  level   The log level
+ * @param[in]  format  The printf like format
+ * @param[in]  args    The arguments
+ *
+ * @retval     True   Line has been added
+ * @retval     False  Line has been dropped
+ */
+bool EspSaveCrashLogger::vlog(crashLogLevel_t level, const char* format, va_list args)
+{
+  if ((level < _level) || (level >= CRASH_LOG_NONE))
+  {
+    return false;
+  }
+
+  if (!_pcBuffer || _bFlushing)
+  {
+    _ulDroppedLines++;
+    return false;
+  }
+
+  va_list argsRetry;
+  va_copy(argsRetry, args);
+
+  int iLength = _format_line(level, format, args);
+
+  // the line does not fit into the remaining space, flush and format it
+  // again into the empty buffer
+  if (_uwBufferLength && (iLength > (_uwBufferSize - _uwBufferLength - 2)))
+  {
+    flush();
+    iLength = _format_line(level, format, argsRetry);
+  }
+  va_end(argsRetry);
+
+  uint16_t uwFree = _uwBufferSize - _uwBufferLength;
+  char *pcLine = _pcBuffer + _uwBufferLength;
+
+  // only a line longer than the whole buffer is truncated, keep space for
+  // the '\n'
+  if (iLength > (uwFree - 2))
+  {
+    iLength = uwFree - 2;
+  }
+
+  // terminate each line, but only once
+  if ((iLength == 0) || (pcLine[iLength - 1] != '\n'))
+  {
+    pcLine[iLength++] = '\n';
+  }
+  pcLine[iLength] = '\0';
+
+  // the length is updated after the line is complete, so a crash during
+  // this function does not flush a partial line
+  _uwBufferLength += iLength;
+
+  return true;
+}
+
+/**
+ * @brief      Write the staging buffer to the log file.
+ *
+ * The log file is rotated if it gets larger than the maximum file size.
+ *
+ * @retval     True   Success
+ * @retval     False  Failed, pending lines are dropped
+ */
+bool EspSaveCrashLogger::flush()
+{
+  bool bResult = true;
+
+  _ulLastFlush = millis();
+
+  if (!_uwBufferLength)
+  {
+    return true;
+  }
+
+  _bFlushing = true;
+
+  if (!_write_buffer())
+  {
+    _ulDroppedLines++;
+    bResult = false;
+  }
+
+  // rotate the log file if it gets too large
+  File theFile = _crashStore.getFileSystem().open(_pcFilePath, "r");
+  if (theFile)
+  {
+    size_t fileSize = theFile.size();
+    theFile.close();
+
+    if (fileSize >= _ulMaxFileSize)
+    {
+      _crashStore.rotateFile(_pcFilePath, NULL, _crashStore.getDirectoryName(), _pcFilePattern, _crashStore.getFileExtension());
+    }
+  }
+
+  _uwBufferLength = 0;
+  _bFlushing = false;
+
+  return bResult;
+}
+
+/**
+ * @brief      Sets the minimum log level.
+ *
+ * @param[in]  level  The level
+ */
+void EspSaveCrashLogger::setLevel(crashLogLevel_t level)
+{
+  _level = level;
+}
+
+/**
+ * @brief      Sets the flush interval.
+ *
+ * @param[in]  ulFlushInterval  The flush interval in ms
+ */
+void EspSaveCrashLogger::setFlushInterval(uint32_t ulFlushInterval)
+{
+  _ulFlushInterval = ulFlushInterval;
+}
+
+/**
+ * @brief      Sets the maximum file size.
+ *
+ * @param[in]  ulMaxFileSize  The maximum file size in byte
+ */
+void EspSaveCrashLogger::setMaxFileSize(uint32_t ulMaxFileSize)
+{
+  _ulMaxFileSize = ulMaxFileSize;
+}
+
+/**
+ * @brief      Gets the current log file name.
+ *
+ * @return     The log file name.
+ */
+const char* EspSaveCrashLogger::getLogFileName()
+{
+  return _pcFilePath;
+}
+
+/**
+ * @brief      Gets the number of dropped lines or failed flushes.
+ *
+ * @return     The dropped lines.
+ */
+uint32_t EspSaveCrashLogger::getDroppedLines()
+{
+  return _ulDroppedLines;
+}
+
+/**
+ * @brief      Format a line into the remaining space of the staging buffer.
+ *
+ * The pending lines are not changed, the line is only added by vlog().
+ *
+ * @param[in]  level   The log level
+ * @param[in]  format  The printf like format
+ * @param[in]  args    The arguments
+ *
+ * @return     The length of the complete line, larger than the remaining
+ *             space if it has been truncated
+ */
+int EspSaveCrashLogger::_format_line(crashLogLevel_t level, const char* format, va_list args)
+{
+  uint16_t uwFree = _uwBufferSize - _uwBufferLength;
+  char *pcLine = _pcBuffer + _uwBufferLength;
+
+  // max. 13 chars of time and level, e.g. '4294967295 E '
+  int iLength = snprintf(pcLine, uwFree, "%u %c ", (uint32_t)millis(), pcLogLevels[level]);
+  if (iLength >= uwFree)
+  {
+    // not even the time fits, the message does not matter
+    return iLength;
+  }
+
+  // vsnprintf returns the length it would have been
+  int iMessageLength = vsnprintf(pcLine + iLength, uwFree - iLength, format, args);
+
+  return (iMessageLength > 0) ? (iLength + iMessageLength) : iLength;
+}
+
+/**
+ * @brief      Write the staging buffer to the log file.
+ *
+ * @retval     True   Success
+ * @retval     False  Failed
+ */
+bool EspSaveCrashLogger::_write_buffer()
+{
+  // if the remaining space is less than the content to save
+  if (!_crashStore.getSpace().checkFreeSpace(_uwBufferLength))
+  {
+    return false;
+  }
+
+  // open the file in appending mode
+  File theFile = _crashStore.getFileSystem().open(_pcFilePath, "a");
+
+  // if the file does not yet exist
+  if (!theFile)
+  {
+    // open the file in write mode
+    theFile = _crashStore.getFileSystem().open(_pcFilePath, "w");
+  }
+
+  if (!theFile)
+  {
+    return false;
+  }
+
+  size_t written = theFile.write((const uint8_t*)_pcBuffer, _uwBufferLength);
+  theFile.close();
+
+  _crashStore.getSpace().onWrite(written);
+
+  return (written == _uwBufferLength);
+}
+
+/**
+ * @brief      Save the pending lines in case of a crash.
+ *
+ * Called by the crash callback. Nothing is saved if the crash happened
+ * during a flush, as the filesystem might be in an inconsistent state.
+ */
+void EspSaveCrashLogger::_emergency_flush()
+{
+  if (pCrashLogger && pCrashLogger->_uwBufferLength && !pCrashLogger->_bFlushing)
+  {
+    pCrashLogger->_write_buffer();
+  }
+}
@@ -0,0 +1,116 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashLogger.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHLOGGER_H_
+#define _ESPSAVECRASHLOGGER_H_
+
+#include "EspSaveCrashSpiffs.h"
+
+#include <stdarg.h>
+
+// size of the RAM staging buffer in byte
+#ifndef CRASHLOGGER_BUFFER_SIZE
+#define CRASHLOGGER_BUFFER_SIZE 512
+#endif
+
+// minimum size of the staging buffer in byte, a smaller size is increased
+#define CRASHLOGGER_MIN_BUFFER_SIZE 64
+
+static_assert(CRASHLOGGER_BUFFER_SIZE >= CRASHLOGGER_MIN_BUFFER_SIZE, "CRASHLOGGER_BUFFER_SIZE must be at least CRASHLOGGER_MIN_BUFFER_SIZE");
+
+// maximum time in ms a line is kept in the staging buffer
+#ifndef CRASHLOGGER_FLUSH_INTERVAL
+#define CRASHLOGGER_FLUSH_INTERVAL 5000
+#endif
+
+// log file size in byte after which the log file is rotated
+#ifndef CRASHLOGGER_MAX_FILE_SIZE
+#define CRASHLOGGER_MAX_FILE_SIZE 4096
+#endif
+
+// the log file MUST end with '-1.' + CRASHFILEEXTENSION to rotate correctly
+#define CRASHLOGGER_FILEPATTERN  "eventLog"
+
+enum crashLogLevel_t
+{
+  CRASH_LOG_DEBUG = 0,
+  CRASH_LOG_INFO,
+  CRASH_LOG_WARNING,
+  CRASH_LOG_ERROR,
+  CRASH_LOG_NONE
+};
+
+/**
+ * Buffered persistent event log
+ *
+ * Lines are collected in a RAM staging buffer and written to the log file
+ * if the buffer is full or the flush interval elapsed. The log file is
+ * rotated like the crash log files, '/eventLog-1.log' is renamed to the next
+ * free '/eventLog-N.log'. Pending lines are saved in case of a crash.
+ *
+ * The log file is kept in the directory and filesystem of the given store,
+ * use a separate EspSaveCrashSpiffs instance to keep it apart.
+ *
+ * Each line has the format '<millis> <level> <message>', e.g.
+ * '33535 E WiFi connection lost'
+ */
+class EspSaveCrashLogger
+{
+  public:
+    EspSaveCrashLogger(EspSaveCrashSpiffs& crashStore, const char* filePattern=CRASHLOGGER_FILEPATTERN, uint16_t uwBufferSize=CRASHLOGGER_BUFFER_SIZE);
+
+    bool begin();
+    void handle();
+    bool flush();
+    bool log(crashLogLevel_t level, const char* format, ...);
+    bool vlog(crashLogLevel_t level, const char* format, va_list args);
+    void setLevel(crashLogLevel_t level);
+    void setFlushInterval(uint32_t ulFlushInterval);
+    void setMaxFileSize(uint32_t ulMaxFileSize);
+    const char* getLogFileName();
+    uint32_t getDroppedLines();
+  private:
+    static void _emergency_flush();
+    int _format_line(crashLogLevel_t level, const char* format, va_list args);
+    bool _write_buffer();
+
+    EspSaveCrashSpiffs& _crashStore;
+    const char* _pcFilePattern;
+    char _pcFilePath[CRASHFILEPATH_SIZE];
+    char* _pcBuffer;
+    uint16_t _uwBufferSize;
+    uint16_t _uwBufferLength;
+    crashLogLevel_t _level;
+    uint32_t _ulFlushInterval;
+    uint32_t _ulMaxFileSize;
+    uint32_t _ulLastFlush;
+    uint32_t _ulDroppedLines;
+    volatile bool _bFlushing;
+};
+
+#endif
@@ -0,0 +1,176 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashLoop.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHLOOP_H_
+#define _ESPSAVECRASHLOOP_H_
+
+#include <stdint.h>
+
+// number of crashes within CRASHLOOP_WINDOW_MS to detect a crash loop
+#ifndef CRASHLOOP_THRESHOLD
+#define CRASHLOOP_THRESHOLD 3
+#endif
+
+// accumulated uptime in ms the crashes have to happen in
+#ifndef CRASHLOOP_WINDOW_MS
+#define CRASHLOOP_WINDOW_MS 30000
+#endif
+
+#define CRASHLOOP_MAGIC 0x43524C50  // 'CRLP'
+
+/**
+ * State of the crash loop detection
+ *
+ * This structure is kept in the RTC user memory to survive a reset.
+ * The size has to be a multiple of 4 byte.
+ */
+struct crash_loop_state_t
+{
+  uint32_t ulMagic;
+  uint32_t ulCrashCount;
+  uint32_t ulWindowTime;
+  uint32_t ulCheck;
+};
+
+/**
+ * Crash loop detection
+ *
+ * A crash loop is detected if CRASHLOOP_THRESHOLD crashes happened within
+ * CRASHLOOP_WINDOW_MS of accumulated uptime. As there is no real time clock
+ * the uptime of each crashed boot (the crash time) is summed up.
+ *
+ * This class does not depend on the Arduino core. Loading and storing the
+ * state is done by the caller, so the logic can be run on any host.
+ */
+class EspSaveCrashLoop
+{
+  public:
+    EspSaveCrashLoop(uint32_t ulThreshold=CRASHLOOP_THRESHOLD, uint32_t ulWindowTime=CRASHLOOP_WINDOW_MS)
+    {
+      _ulThreshold = ulThreshold;
+      _ulWindowTime = ulWindowTime;
+      reset();
+    }
+
+    /**
+     * @brief      Reset the state to "no crash happened"
+     */
+    void reset()
+    {
+      state.ulMagic = CRASHLOOP_MAGIC;
+      state.ulCrashCount = 0;
+      state.ulWindowTime = 0;
+      state.ulCheck = _checksum();
+    }
+
+    /**
+     * @brief      Check the state loaded from e.g. RTC memory
+     *
+     * @retval     True   State is valid
+     * @retval     False  State is garbage (e.g. after power on)
+     */
+    bool isValid() const
+    {
+      return (state.ulMagic == CRASHLOOP_MAGIC) && (state.ulCheck == _checksum());
+    }
+
+    /**
+     * @brief      Update the state on boot.
+     *
+     * Any restart which is not caused by a crash ends a crash loop.
+     *
+     * @param[in]  bootAfterCrash  Flag whether the last reset was a crash
+     */
+    void onBoot(bool bootAfterCrash)
+    {
+      if (!isValid() || !bootAfterCrash)
+      {
+        reset();
+      }
+    }
+
+    /**
+     * @brief      Update the state on a crash.
+     *
+     * @param[in]  ulCrashTime  Uptime in ms at the moment of the crash
+     */
+    void onCrash(uint32_t ulCrashTime)
+    {
+      if (!isValid())
+      {
+        reset();
+      }
+
+      // start a new window if this crash does not fit into the current one
+      if ((state.ulCrashCount == 0) || ((state.ulWindowTime + ulCrashTime) > _ulWindowTime) || (state.ulWindowTime + ulCrashTime < state.ulWindowTime))
+      {
+        state.ulCrashCount = 1;
+        state.ulWindowTime = ulCrashTime;
+      }
+      else
+      {
+        state.ulCrashCount++;
+        state.ulWindowTime += ulCrashTime;
+      }
+
+      state.ulCheck = _checksum();
+    }
+
+    /**
+     * @brief      Check if the device is in a crash loop
+     *
+     * @retval     True   Crash loop detected
+     * @retval     False  No crash loop
+     */
+    bool isDetected() const
+    {
+      return isValid() && (state.ulCrashCount >= _ulThreshold);
+    }
+
+    /**
+     * @brief      Gets the number of crashes within the current window.
+     *
+     * @return     The crash count.
+     */
+    uint32_t getCrashCount() const
+    {
+      return isValid() ? state.ulCrashCount : 0;
+    }
+
+    crash_loop_state_t state;
+  private:
+    uint32_t _checksum() const
+    {
+      return ~(state.ulMagic ^ state.ulCrashCount ^ state.ulWindowTime);
+    }
+
+    uint32_t _ulThreshold;
+    uint32_t _ulWindowTime;
+};
+
+#endif
@@ -0,0 +1,289 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashPolicy.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHPOLICY_H_
+#define _ESPSAVECRASHPOLICY_H_
+
+#include <stdint.h>
+
+#include "EspSaveCrashConfig.h"
+
+// number of crashes saved with a full dump, before repeats are sampled
+#ifndef CRASH_POLICY_FULL_DUMPS
+#define CRASH_POLICY_FULL_DUMPS 3
+#endif
+
+// flash bytes per hour of uptime the crash logs may use
+#ifndef CRASH_POLICY_BYTES_PER_HOUR
+#define CRASH_POLICY_BYTES_PER_HOUR 8192
+#endif
+
+// maximum flash bytes available for a burst of crashes
+#ifndef CRASH_POLICY_BURST_BYTES
+#define CRASH_POLICY_BURST_BYTES 16384
+#endif
+
+#define CRASH_POLICY_MAGIC 0x43525043  // 'CRPC'
+
+enum crashPolicyDecision_t
+{
+  CRASH_POLICY_FULL = 0,
+  CRASH_POLICY_HEADER,
+  CRASH_POLICY_DROP
+};
+
+/**
+ * State of the crash report policy
+ *
+ * This structure is kept in the RTC user memory to survive a reset.
+ * The size has to be a multiple of 4 byte.
+ */
+struct crash_policy_state_t
+{
+  uint32_t ulMagic;
+  uint32_t ulCrashCount;
+  uint32_t ulTokens;
+  uint32_t ulDropped;
+  uint32_t ulSignatureHead;
+  uint32_t pulSignatures[CRASH_POLICY_SIGNATURES];
+  uint32_t ulCheck;
+};
+
+static_assert(sizeof(crash_policy_state_t) == (CRASH_POLICY_RTC_BLOCKS * 4), "crash_policy_state_t must match CRASH_POLICY_RTC_BLOCKS");
+
+/**
+ * @brief      Calculate the signature of a crash.
+ *
+ * Crashes with the same restart reason, exception cause and epc1 are
+ * considered to be repeats of the same crash.
+ *
+ * @param[in]  ulReason     The restart reason
+ * @param[in]  ulException  The exception cause
+ * @param[in]  ulEpc1       The epc1
+ *
+ * @return     The signature, FNV-1a hash of the values
+ */
+static inline uint32_t crashPolicySignature(uint32_t ulReason, uint32_t ulException, uint32_t ulEpc1)
+{
+  const uint32_t pulValues[3] = {ulReason, ulException, ulEpc1};
+  uint32_t ulHash = 2166136261UL;
+
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    for (uint8_t j = 0; j < 32; j += 8)
+    {
+      ulHash = (ulHash ^ ((pulValues[i] >> j) & 0xFF)) * 16777619UL;
+    }
+  }
+
+  return ulHash;
+}
+
+/**
+ * Crash report sampling and rate limiting
+ *
+ * The first CRASH_POLICY_FULL_DUMPS crashes and any crash with a new
+ * signature are saved with a full dump, repeats only with the header.
+ * All crash logs take their size from a token bucket, which is refilled
+ * with CRASH_POLICY_BYTES_PER_HOUR of uptime up to CRASH_POLICY_BURST_BYTES.
+ * Crashes are dropped if the bucket does not even hold a header. As there
+ * is no real time clock the uptime of each crashed boot is used. A quiet
+ * period refilling the bucket completely starts with full dumps again.
+ *
+ * This class does not depend on the Arduino core. Loading and storing the
+ * state is done by the caller, so the logic can be run on any host.
+ */
+class EspSaveCrashPolicy
+{
+  public:
+    EspSaveCrashPolicy(uint32_t ulFullDumps=CRASH_POLICY_FULL_DUMPS, uint32_t ulBytesPerHour=CRASH_POLICY_BYTES_PER_HOUR, uint32_t ulBurstBytes=CRASH_POLICY_BURST_BYTES)
+    {
+      _ulFullDumps = ulFullDumps;
+      _ulBytesPerHour = ulBytesPerHour;
+      _ulBurstBytes = ulBurstBytes;
+      reset();
+    }
+
+    /**
+     * @brief      Reset the state to "no crash happened" and a full bucket
+     */
+    void reset()
+    {
+      state.ulMagic = CRASH_POLICY_MAGIC;
+      state.ulCrashCount = 0;
+      state.ulTokens = _ulBurstBytes;
+      state.ulDropped = 0;
+      state.ulSignatureHead = 0;
+      for (uint8_t i = 0; i < CRASH_POLICY_SIGNATURES; i++)
+      {
+        state.pulSignatures[i] = 0;
+      }
+      state.ulCheck = _checksum();
+    }
+
+    /**
+     * @brief      Check the state loaded from e.g. RTC memory
+     *
+     * @retval     True   State is valid
+     * @retval     False  State is garbage (e.g. after power on)
+     */
+    bool isValid() const
+    {
+      return (state.ulMagic == CRASH_POLICY_MAGIC) && (state.ulCheck == _checksum());
+    }
+
+    /**
+     * @brief      Update the state on boot.
+     *
+     * The state is kept over all kind of resets, only garbage is reset.
+     */
+    void onBoot()
+    {
+      if (!isValid())
+      {
+        reset();
+      }
+    }
+
+    /**
+     * @brief      Decide how to save a crash.
+     *
+     * @param[in]  ulCrashTime    Uptime in ms at the moment of the crash
+     * @param[in]  ulSignature    The signature of the crash
+     * @param[in]  ulFullSize     The estimated size of a full crash log
+     * @param[in]  ulHeaderSize   The estimated size of the header only
+     *
+     * @return     Save a full dump, the header only or drop the crash
+     */
+    crashPolicyDecision_t onCrash(uint32_t ulCrashTime, uint32_t ulSignature, uint32_t ulFullSize, uint32_t ulHeaderSize)
+    {
+      crashPolicyDecision_t decision = CRASH_POLICY_DROP;
+      bool bNewSignature = true;
+
+      if (!isValid())
+      {
+        reset();
+      }
+
+      // refill the bucket by the uptime of this boot, avoiding an overflow
+      uint64_t ullTokens = state.ulTokens + (((uint64_t)ulCrashTime * _ulBytesPerHour) / 3600000UL);
+      if (ullTokens >= _ulBurstBytes)
+      {
+        // a quiet period ends the crash storm
+        ullTokens = _ulBurstBytes;
+        state.ulCrashCount = 0;
+      }
+      state.ulTokens = (uint32_t)ullTokens;
+
+      for (uint8_t i = 0; i < CRASH_POLICY_SIGNATURES; i++)
+      {
+        if ((state.pulSignatures[i] == ulSignature) && (i < state.ulSignatureHead))
+        {
+          bNewSignature = false;
+        }
+      }
+
+      if (bNewSignature)
+      {
+        // the oldest signature is replaced once all are in use
+        state.pulSignatures[state.ulSignatureHead % CRASH_POLICY_SIGNATURES] = ulSignature;
+        state.ulSignatureHead++;
+        if (state.ulSignatureHead >= (2 * CRASH_POLICY_SIGNATURES))
+        {
+          state.ulSignatureHead -= CRASH_POLICY_SIGNATURES;
+        }
+      }
+
+      if (((state.ulCrashCount < _ulFullDumps) || bNewSignature) && (state.ulTokens >= ulFullSize))
+      {
+        decision = CRASH_POLICY_FULL;
+      }
+      else if (state.ulTokens >= ulHeaderSize)
+      {
+        decision = CRASH_POLICY_HEADER;
+      }
+      else
+      {
+        state.ulDropped++;
+      }
+
+      if (state.ulCrashCount < UINT32_MAX)
+      {
+        state.ulCrashCount++;
+      }
+
+      state.ulCheck = _checksum();
+
+      return decision;
+    }
+
+    /**
+     * @brief      Take the written size of a crash log from the bucket.
+     *
+     * The dropped crashes are reported with the written crash log.
+     *
+     * @param[in]  ulBytes  The written bytes
+     */
+    void onWrite(uint32_t ulBytes)
+    {
+      state.ulTokens = (state.ulTokens > ulBytes) ? (state.ulTokens - ulBytes) : 0;
+      state.ulDropped = 0;
+      state.ulCheck = _checksum();
+    }
+
+    /**
+     * @brief      Gets the number of dropped crashes since the last log.
+     *
+     * @return     The dropped crashes.
+     */
+    uint32_t getDropped() const
+    {
+      return isValid() ? state.ulDropped : 0;
+    }
+
+    crash_policy_state_t state;
+  private:
+    uint32_t _checksum() const
+    {
+      const uint32_t* pulWords = (const uint32_t*)&state;
+      uint32_t ulCheck = 0;
+
+      for (uint8_t i = 0; i < ((sizeof(state) / 4) - 1); i++)
+      {
+        ulCheck ^= pulWords[i] + i;
+      }
+
+      return ~ulCheck;
+    }
+
+    uint32_t _ulFullDumps;
+    uint32_t _ulBytesPerHour;
+    uint32_t _ulBurstBytes;
+};
+
+#endif
@@ -0,0 +1,399 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashRecord.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "EspSaveCrashRecord.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// names of the Xtensa exception causes, see EXCCAUSE
+static const char* const pcExceptionNames[] = {
+  "IllegalInstruction",
+  "Syscall",
+  "InstructionFetchError",
+  "LoadStoreError",
+  "Level1Interrupt",
+  "Alloca",
+  "IntegerDivideByZero",
+  "Reserved",
+  "Privileged",
+  "LoadStoreAlignment",
+  "Reserved",
+  "Reserved",
+  "InstrPIFDataError",
+  "LoadStorePIFDataError",
+  "InstrPIFAddrError",
+  "LoadStorePIFAddrError",
+  "InstTLBMiss",
+  "InstTLBMultiHit",
+  "InstFetchPrivilege",
+  "Reserved",
+  "InstFetchProhibited",
+  "Reserved",
+  "Reserved",
+  "Reserved",
+  "LoadStoreTLBMiss",
+  "LoadStoreTLBMultiHit",
+  "LoadStorePrivilege",
+  "Reserved",
+  "LoadProhibited",
+  "StoreProhibited"
+};
+
+/**
+ * @brief      Check if a value is a code address of the ESP8266.
+ *
+ * Covers the ROM, the IRAM and the memory mapped flash.
+ *
+ * @param[in]  ulAddress  The address
+ *
+ * @retval     True   Address is within a code region
+ * @retval     False  Address is no code address
+ */
+bool crashRecordIsCodeAddress(uint32_t ulAddress)
+{
+  return (ulAddress >= 0x40000000) && (ulAddress < 0x40300000);
+}
+
+/**
+ * @brief      Get the name of an exception cause.
+ *
+ * @param[in]  ulException  The exception cause
+ *
+ * @return     The name, "Unknown" for invalid causes
+ */
+const char* crashRecordExceptionName(uint32_t ulException)
+{
+  if (ulException < (sizeof(pcExceptionNames) / sizeof(pcExceptionNames[0])))
+  {
+    return pcExceptionNames[ulException];
+  }
+
+  return "Unknown";
+}
+
+/**
+ * @brief      Check if a line starts with a prefix.
+ *
+ * @param[in]  pcLine    The line
+ * @param[in]  pcPrefix  The prefix
+ *
+ * @return     Pointer behind the prefix, NULL if the prefix does not match
+ */
+static const char* _skip_prefix(const char* pcLine, const char* pcPrefix)
+{
+  size_t prefixLength = strlen(pcPrefix);
+
+  if (strncmp(pcLine, pcPrefix, prefixLength) == 0)
+  {
+    return pcLine + prefixLength;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief      Constructs a new instance.
+ */
+EspSaveCrashRecordParser::EspSaveCrashRecordParser()
+{
+  _ulRecordCount = 0;
+  memset(&_result, 0, sizeof(_result));
+  reset();
+}
+
+/**
+ * @brief      Drop a partially parsed record.
+ *
+ * Call this before parsing another file.
+ */
+void EspSaveCrashRecordParser::reset()
+{
+  _clear();
+  _verifier.reset();
+  _bLineStart = true;
+}
+
+/**
+ * @brief      Parse a line of a crash log.
+ *
+ * A trailing '\n' or '\r\n' is ignored. A record is completed by the end
+ * of the stack or, as truncated record, by the start of the next record.
+ * Pass the lines including the '\n', the CRC of a record is calculated over
+ * its lines. A line without '\n' is continued by the next call, the rest of
+ * a line is only part of the CRC.
+ *
+ * @param[in]  pcLine  The line or a part of it
+ *
+ * @retval     True   A record has been completed, see getRecord()
+ * @retval     False  No record completed
+ */
+bool EspSaveCrashRecordParser::parseLine(const char* pcLine)
+{
+  const char* pcValue;
+  bool bResult = false;
+  bool bLineStart = _bLineStart;
+
+  // the verifier keeps its own state of the record
+  crashIntegrity_t integrity = _verifier.parseLine(pcLine);
+
+  // the next call continues this line, unless it is complete
+  _bLineStart = (strchr(pcLine, '\n') != NULL);
+  if (!bLineStart)
+  {
+    return false;
+  }
+
+  if ((pcValue = _skip_prefix(pcLine, "Crashed at ")))
+  {
+    // a new record starts, the previous one has been truncated
+    if (_bInRecord)
+    {
+      bResult = _complete_record(false);
+    }
+
+    _clear();
+    _bInRecord = true;
+    _record.ulCrashTime = strtoul(pcValue, NULL, 10);
+
+    return bResult;
+  }
+
+  if (!_bInRecord)
+  {
+    return false;
+  }
+
+  if ((integrity == CRASH_INTEGRITY_VALID) || (integrity == CRASH_INTEGRITY_INVALID))
+  {
+    // the CRC line, right before the end of the stack
+    _record.integrity = integrity;
+  }
+  else if (_bInStack)
+  {
+    if (_skip_prefix(pcLine, "<<<stack<<<"))
+    {
+      return _complete_record(true);
+    }
+
+    _parse_stack_line(pcLine);
+  }
+  else if ((pcValue = _skip_prefix(pcLine, "Restart reason: ")))
+  {
+    _record.ulReason = strtoul(pcValue, NULL, 10);
+  }
+  else if ((pcValue = _skip_prefix(pcLine, "Exception cause: ")))
+  {
+    _record.ulException = strtoul(pcValue, NULL, 10);
+  }
+  else if ((pcValue = _skip_prefix(pcLine, "Heap: ")))
+  {
+    _record.bHeapInfo = (sscanf(pcValue, "free=%u frag=%u%% max=%u", &_record.ulFreeHeap, &_record.ulHeapFragmentation, &_record.ulMaxFreeBlock) == 3);
+  }
+  else if ((pcValue = _skip_prefix(pcLine, "Crash loop: ")))
+  {
+    _record.ulCrashLoopCount = strtoul(pcValue, NULL, 10);
+  }
+  else if (_skip_prefix(pcLine, "Sampled: "))
+  {
+    _record.bSampled = true;
+  }
+  else if ((pcValue = _skip_prefix(pcLine, "Dropped: ")))
+  {
+    _record.ulDropped = strtoul(pcValue, NULL, 10);
+  }
+  else if ((pcValue = _skip_prefix(pcLine, "Build: ")))
+  {
+    // copy the build id without the line ending
+    size_t length = strcspn(pcValue, "\r\n");
+    if (length >= sizeof(_record.pcBuildId))
+    {
+      length = sizeof(_record.pcBuildId) - 1;
+    }
+    memcpy(_record.pcBuildId, pcValue, length);
+    _record.pcBuildId[length] = '\0';
+  }
+  else if (_skip_prefix(pcLine, "epc1="))
+  {
+    sscanf(pcLine, "epc1=0x%x epc2=0x%x epc3=0x%x excvaddr=0x%x depc=0x%x", &_record.ulEpc1, &_record.ulEpc2, &_record.ulEpc3, &_record.ulExcvaddr, &_record.ulDepc);
+  }
+  else if ((pcValue = _skip_prefix(pcLine, "Breadcrumbs:")))
+  {
+    // entries of ' code:value', oldest first
+    unsigned int uiCode;
+    unsigned int uiValue;
+    int iConsumed;
+
+    while ((_record.uwBreadcrumbs < CRASH_BREADCRUMBS_SIZE) && (sscanf(pcValue, " %x:%x%n", &uiCode, &uiValue, &iConsumed) == 2))
+    {
+      _record.pulBreadcrumbs[_record.uwBreadcrumbs++] = ((uiCode & 0xFFFF) << 16) | (uiValue & 0xFFFF);
+      pcValue += iConsumed;
+    }
+  }
+  else if (_skip_prefix(pcLine, ">>>stack>>>"))
+  {
+    _bInStack = true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief      Complete the record at the end of the input.
+ *
+ * A record without the end of the stack is returned as truncated record.
+ *
+ * @retval     True   A record has been completed, see getRecord()
+ * @retval     False  No record pending
+ */
+bool EspSaveCrashRecordParser::finish()
+{
+  bool bResult = false;
+
+  if (_bInRecord)
+  {
+    bResult = _complete_record(false);
+  }
+
+  _verifier.finish();
+  reset();
+
+  return bResult;
+}
+
+/**
+ * @brief      Gets the latest completed record.
+ *
+ * @return     The record.
+ */
+const crash_record_t& EspSaveCrashRecordParser::getRecord() const
+{
+  return _result;
+}
+
+/**
+ * @brief      Gets the number of completed records.
+ *
+ * @return     The record count.
+ */
+uint32_t EspSaveCrashRecordParser::getRecordCount() const
+{
+  return _ulRecordCount;
+}
+
+/**
+ * @brief      Check if the parser is within a record.
+ *
+ * @retval     True   The last line started or continued a record
+ * @retval     False  The last line was outside of any record
+ */
+bool EspSaveCrashRecordParser::isInRecord() const
+{
+  return _bInRecord;
+}
+
+/**
+ * @brief      Gets the verifier with the number of valid and invalid records.
+ *
+ * @return     The verifier.
+ */
+const EspSaveCrashVerifier& EspSaveCrashRecordParser::getVerifier() const
+{
+  return _verifier;
+}
+
+/**
+ * @brief      Clear the current record.
+ */
+void EspSaveCrashRecordParser::_clear()
+{
+  memset(&_record, 0, sizeof(_record));
+  _bInRecord = false;
+  _bInStack = false;
+}
+
+/**
+ * @brief      Move the current record to the result.
+ *
+ * @param[in]  bComplete  Flag whether the record has been complete
+ *
+ * @retval     True   Always
+ */
+bool EspSaveCrashRecordParser::_complete_record(bool bComplete)
+{
+  _record.bComplete = bComplete;
+  memcpy(&_result, &_record, sizeof(_result));
+  _ulRecordCount++;
+
+  _clear();
+
+  return true;
+}
+
+/**
+ * @brief      Parse a stack line, e.g. "3fffffb0: feefeffe 3ffe8508 40100459"
+ *
+ * @param[in]  pcLine  The line
+ */
+void EspSaveCrashRecordParser::_parse_stack_line(const char* pcLine)
+{
+  char* pcEnd;
+  uint32_t ulAddress = strtoul(pcLine, &pcEnd, 16);
+
+  // skip anything else than '<address>:'
+  if ((pcEnd == pcLine) || (*pcEnd != ':'))
+  {
+    return;
+  }
+
+  if (_record.ulStackWords == 0)
+  {
+    _record.ulStackStart = ulAddress;
+  }
+
+  pcLine = pcEnd + 1;
+
+  while (true)
+  {
+    uint32_t ulWord = strtoul(pcLine, &pcEnd, 16);
+
+    if (pcEnd == pcLine)
+    {
+      break;
+    }
+    pcLine = pcEnd;
+
+    _record.ulStackWords++;
+
+    if (crashRecordIsCodeAddress(ulWord) && (_record.uwBacktrace < CRASH_RECORD_BACKTRACE_SIZE))
+    {
+      _record.pulBacktrace[_record.uwBacktrace++] = ulWord;
+    }
+  }
+}
@@ -0,0 +1,139 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashRecord.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHRECORD_H_
+#define _ESPSAVECRASHRECORD_H_
+
+#include <stdint.h>
+
+#include "EspSaveCrashConfig.h"
+#include "EspSaveCrashBreadcrumbs.h"
+#include "EspSaveCrashCrc.h"
+
+// number of code addresses of the stack kept as backtrace
+#ifndef CRASH_RECORD_BACKTRACE_SIZE
+#define CRASH_RECORD_BACKTRACE_SIZE 8
+#endif
+
+/**
+ * Parsed crash record
+ *
+ * Only the values needed to analyse a crash are kept, the stack is reduced
+ * to the code addresses found in it (the backtrace candidates).
+ */
+struct crash_record_t
+{
+  uint32_t ulCrashTime;
+  uint32_t ulReason;
+  uint32_t ulException;
+  bool bHeapInfo;
+  uint32_t ulFreeHeap;
+  uint32_t ulHeapFragmentation;
+  uint32_t ulMaxFreeBlock;
+  uint32_t ulCrashLoopCount;
+  // saved with the header only by the crash report policy
+  bool bSampled;
+  // crashes dropped by the crash report policy before this one
+  uint32_t ulDropped;
+  uint32_t ulEpc1;
+  uint32_t ulEpc2;
+  uint32_t ulEpc3;
+  uint32_t ulExcvaddr;
+  uint32_t ulDepc;
+  uint16_t uwBreadcrumbs;
+  uint32_t pulBreadcrumbs[CRASH_BREADCRUMBS_SIZE];
+  uint32_t ulStackStart;
+  uint32_t ulStackWords;
+  uint16_t uwBacktrace;
+  uint32_t pulBacktrace[CRASH_RECORD_BACKTRACE_SIZE];
+  char pcBuildId[CRASH_RECORD_BUILD_ID_SIZE];
+  // false if the record ended before the end of the stack
+  bool bComplete;
+  // result of the CRC check, CRASH_INTEGRITY_NONE without CRC
+  crashIntegrity_t integrity;
+};
+
+/**
+ * Line based parser of the crash log records
+ *
+ * Feed the lines of a crash log one by one, each completed record is
+ * available with getRecord() until the next line is parsed. A crash log
+ * file may contain several records. Unknown lines are ignored. The CRC of
+ * each record is checked while parsing, see EspSaveCrashVerifier. Lines
+ * longer than the line buffer may be passed in several parts.
+ *
+ * This class does not depend on the Arduino core and does not allocate
+ * memory, so it is used on the device and by the host tools in extras.
+ *
+ * Example usage:
+ * @code
+ *    EspSaveCrashRecordParser parser;
+ *
+ *    while (fgets(pcLine, sizeof(pcLine), pFile))
+ *    {
+ *      if (parser.parseLine(pcLine))
+ *      {
+ *        analyse(parser.getRecord());
+ *      }
+ *    }
+ *    if (parser.finish())
+ *    {
+ *      analyse(parser.getRecord());
+ *    }
+ * @endcode
+ */
+class EspSaveCrashRecordParser
+{
+  public:
+    EspSaveCrashRecordParser();
+
+    void reset();
+    bool parseLine(const char* pcLine);
+    bool finish();
+    const crash_record_t& getRecord() const;
+    uint32_t getRecordCount() const;
+    bool isInRecord() const;
+    const EspSaveCrashVerifier& getVerifier() const;
+  private:
+    void _clear();
+    bool _complete_record(bool bComplete);
+    void _parse_stack_line(const char* pcLine);
+
+    crash_record_t _record;
+    crash_record_t _result;
+    EspSaveCrashVerifier _verifier;
+    bool _bInRecord;
+    bool _bInStack;
+    bool _bLineStart;
+    uint32_t _ulRecordCount;
+};
+
+bool crashRecordIsCodeAddress(uint32_t ulAddress);
+const char* crashRecordExceptionName(uint32_t ulException);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashSnapshot.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHSNAPSHOT_H_
+#define _ESPSAVECRASHSNAPSHOT_H_
+
+#include <stdint.h>
+
+#include "EspSaveCrashConfig.h"
+
+#define CRASH_SNAPSHOT_MAGIC 0x43534E50  // 'CSNP'
+
+// start of the RTC user memory, block 64 of the RTC memory
+#define CRASH_RTC_USER_MEMORY 0x60001100
+
+/**
+ * Crash snapshot of the IRAM crash handler
+ *
+ * This structure is kept in the RTC user memory to survive the reset and
+ * saved as crash log on the next boot. The size is 12 + stack words blocks.
+ */
+struct crash_snapshot_t
+{
+  uint32_t ulMagic;
+  uint32_t ulCrashTime;
+  uint32_t ulReason;
+  uint32_t ulExccause;
+  uint32_t ulEpc1;
+  uint32_t ulEpc2;
+  uint32_t ulEpc3;
+  uint32_t ulExcvaddr;
+  uint32_t ulDepc;
+  uint32_t ulStack;
+  uint32_t ulStackWords;
+  uint32_t ulCheck;
+  uint32_t pulStack[CRASH_SNAPSHOT_STACK_WORDS];
+};
+
+static_assert(sizeof(crash_snapshot_t) == (12 + CRASH_SNAPSHOT_STACK_WORDS) * 4, "crash_snapshot_t must not be padded");
+
+/**
+ * @brief      Calculate the check value of a snapshot.
+ *
+ * @param[in]  snapshot  The snapshot
+ *
+ * @return     Sum of all words except the check value itself
+ */
+static inline uint32_t crashSnapshotCheck(const crash_snapshot_t* snapshot)
+{
+  const uint32_t* pulWords = (const uint32_t*)snapshot;
+  uint32_t ulCheck = 0;
+
+  for (uint32_t i = 0; i < (sizeof(crash_snapshot_t) / 4); i++)
+  {
+    if (&pulWords[i] != &snapshot->ulCheck)
+    {
+      ulCheck += pulWords[i];
+    }
+  }
+
+  return ~ulCheck;
+}
+
+#endif
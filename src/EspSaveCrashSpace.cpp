@@ -0,0 +1,150 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashSpace.cpp
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "EspSaveCrashSpace.h"
+
+/**
+ * @brief      Query the filesystem info.
+ */
+void EspSaveCrashSpace::sync()
+{
+  // struct FSInfo {
+  //   size_t totalBytes;
+  //   size_t usedBytes;
+  //   size_t blockSize;
+  //   size_t pageSize;
+  //   size_t maxOpenFiles;
+  //   size_t maxPathLength;
+  // };
+  FSInfo fs_info;
+
+  // fill FSInfo struct with informations about the filesystem
+  _bValid = _fs->info(fs_info);
+
+  _ulTotalBytes = fs_info.totalBytes;
+  _ulUsedBytes = fs_info.usedBytes;
+  _ulLastSync = millis();
+}
+
+/**
+ * @brief      Query the filesystem info again on the next request.
+ *
+ * Call this after changes not reported by onWrite or onRemove.
+ */
+void EspSaveCrashSpace::invalidate()
+{
+  _bValid = false;
+}
+
+/**
+ * @brief      Get remaining space of filesystem
+ *
+ * A reserve of the used space is kept free, as the filesystem needs some
+ * space for its metadata.
+ *
+ * @return     Free space in byte
+ */
+uint32_t EspSaveCrashSpace::getFreeSpace()
+{
+  if (_is_stale())
+  {
+    sync();
+  }
+
+  if (!_bValid)
+  {
+    return 0;
+  }
+
+  uint32_t ulReservedBytes = _ulUsedBytes + (_ulUsedBytes / CRASHSPACE_RESERVE_DIVIDER);
+
+  return (_ulTotalBytes > ulReservedBytes) ? (_ulTotalBytes - ulReservedBytes) : 0;
+}
+
+/**
+ * @brief      Check if this amout of space is free on the filesystem
+ *
+ * The filesystem info is queried again if the estimate is too low, to not
+ * refuse a write due to an outdated estimate. On a nearly full filesystem
+ * this is done at most every CRASHSPACE_RECHECK_INTERVAL ms.
+ *
+ * @param[in]  ulSize  The size of the thing to store
+ *
+ * @retval     True   Requested size will fit to the filesystem
+ * @retval     False  Requested size won't fit
+ */
+bool EspSaveCrashSpace::checkFreeSpace(const uint32_t ulSize)
+{
+  // getFreeSpace queries the info anyway if it is outdated
+  bool bSynced = _is_stale();
+
+  if (getFreeSpace() > ulSize)
+  {
+    return true;
+  }
+
+  if (!bSynced && ((millis() - _ulLastSync) >= CRASHSPACE_RECHECK_INTERVAL))
+  {
+    sync();
+
+    return (getFreeSpace() > ulSize) ? true : false;
+  }
+
+  return false;
+}
+
+/**
+ * @brief      Report data written to the filesystem.
+ *
+ * @param[in]  ulSize  The number of byte written
+ */
+void EspSaveCrashSpace::onWrite(const uint32_t ulSize)
+{
+  _ulUsedBytes += ulSize;
+}
+
+/**
+ * @brief      Report a removed file.
+ *
+ * @param[in]  ulSize  The size of the removed file
+ */
+void EspSaveCrashSpace::onRemove(const uint32_t ulSize)
+{
+  _ulUsedBytes = (_ulUsedBytes > ulSize) ? (_ulUsedBytes - ulSize) : 0;
+}
+
+/**
+ * @brief      Check if the filesystem info has to be queried again.
+ *
+ * @retval     True   Info is outdated or was never queried
+ * @retval     False  Info is up to date
+ */
+bool EspSaveCrashSpace::_is_stale()
+{
+  return (!_bValid || ((millis() - _ulLastSync) >= CRASHSPACE_RESYNC_INTERVAL));
+}
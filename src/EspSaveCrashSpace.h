@@ -0,0 +1,81 @@
+/*
+  This in an Arduino library to save exception details
+  and stack trace to flash in case of ESP8266 crash.
+  Please check repository below for details
+
+  Repository: https://github.com/brainelectronics/EspSaveCrashSpiffs
+  File: EspSaveCrashSpace.h
+  Revision: 0.1.0
+  Date: 04-Jan-2020
+  Author: brainelectronics
+
+  Copyright (c) 2020 brainelectronics. All rights reserved.
+
+  This application is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This application is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef _ESPSAVECRASHSPACE_H_
+#define _ESPSAVECRASHSPACE_H_
+
+#include "Arduino.h"
+#include "FS.h"
+
+// time in ms after which the filesystem info is queried again
+#ifndef CRASHSPACE_RESYNC_INTERVAL
+#define CRASHSPACE_RESYNC_INTERVAL 60000
+#endif
+
+// minimum time in ms between two queries of a too low estimate
+#ifndef CRASHSPACE_RECHECK_INTERVAL
+#define CRASHSPACE_RECHECK_INTERVAL 5000
+#endif
+
+// reserve 1/CRASHSPACE_RESERVE_DIVIDER of the used space, 20 equals 5%
+#ifndef CRASHSPACE_RESERVE_DIVIDER
+#define CRASHSPACE_RESERVE_DIVIDER 20
+#endif
+
+/**
+ * Free space accountant of a filesystem
+ *
+ * The filesystem info is queried once and the used space is estimated by
+ * the writes and removals reported to this class. The info is queried
+ * again after CRASHSPACE_RESYNC_INTERVAL, or if the estimate is too low for
+ * a requested size at most every CRASHSPACE_RECHECK_INTERVAL.
+ */
+class EspSaveCrashSpace
+{
+  public:
+    // constexpr to be ready before any constructor of a global object
+    constexpr EspSaveCrashSpace(FS* fileSystem=&SPIFFS) :
+      _fs(fileSystem), _ulTotalBytes(0), _ulUsedBytes(0), _ulLastSync(0), _bValid(false) {}
+
+    void sync();
+    void invalidate();
+    uint32_t getFreeSpace();
+    bool checkFreeSpace(const uint32_t ulSize);
+    void onWrite(const uint32_t ulSize);
+    void onRemove(const uint32_t ulSize);
+  private:
+    bool _is_stale();
+
+    FS* _fs;
+    uint32_t _ulTotalBytes;
+    uint32_t _ulUsedBytes;
+    uint32_t _ulLastSync;
+    bool _bValid;
+};
+
+#endif
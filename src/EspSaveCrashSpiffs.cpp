@@ -38,7 +38,41 @@
 
 #include "EspSaveCrashSpiffs.h"
 
-char* pcCrashFilePath;
+#if CRASH_ENABLE_HMAC
+#include <bearssl/bearssl_hmac.h>
+#endif
+
+// highest crash log index accepted by _get_file_index()
+#define CRASH_MAX_FILE_INDEX ((((UINT32_MAX - 9) / 10) * 10) + 9)
+
+// the instance saving the crashes, used by the crash callback
+EspSaveCrashSpiffs* pCrashStore;
+
+// crash loop detection of the active instance, used by the crash callback
+EspSaveCrashLoop* pCrashLoop;
+
+// crash report policy of the active instance, used by the crash callback
+EspSaveCrashPolicy* pCrashPolicy;
+
+// ring buffer of breadcrumbs, filled by crashBreadcrumb()
+#if CRASH_ENABLE_BREADCRUMBS
+crash_breadcrumbs_t crashBreadcrumbs;
+#endif
+
+// called after the crash has been saved, e.g. to flush pending log lines
+crashFlushCallback_t pfnCrashFlush;
+
+#if CRASH_ENABLE_CRC
+// running CRC32 of the crash record being written
+static uint32_t ulRecordCrc;
+#endif
+
+#if CRASH_ENABLE_HMAC
+// key set by setCrashHmacKey() and running HMAC of the crash record
+static br_hmac_key_context crashHmacKey;
+static br_hmac_context crashRecordHmac;
+static bool bCrashHmacKey;
+#endif
 
 /**
  * @brief      Saves to log to the SPIFFS.
@@ -48,951 +82,2724 @@ char* pcCrashFilePath;
 void saveToSpiffsLog(char *content)
 {
   // if there is a filename given to store the logs to
-  if(pcCrashFilePath)
+  if(pCrashStore)
   {
-    saveToSpiffsFile(content, pcCrashFilePath);
+    saveToSpiffsFile(content, pCrashStore->getLogFileName());
   }
 }
 
 /**
  * @brief      Saves to log to the SPIFFS.
  *
+ * The file is saved to the filesystem of the crash store, if there is none
+ * to the SPIFFS.
+ *
  * @param      content   The content
  * @param[in]  fileName  The file name
  */
 void saveToSpiffsFile(char *content, const char *fileName)
 {
-  // struct FSInfo {
-  //   size_t totalBytes;
-  //   size_t usedBytes;
-  //   size_t blockSize;
-  //   size_t pageSize;
-  //   size_t maxOpenFiles;
-  //   size_t maxPathLength;
-  // };
-  FSInfo fs_info;
+  // without any instance there is no free space accountant
+  if (!pCrashStore)
+  {
+    return;
+  }
 
-  // fill FSInfo struct with informations about the SPIFFS
-  SPIFFS.info(fs_info);
+  FS& fileSystem = pCrashStore->getFileSystem();
+  size_t contentLength = strlen(content);
 
   // if the remaining space is less than the length of the content to save
-  if ((fs_info.totalBytes - (fs_info.usedBytes * 1.05)) < strlen(content))
+  if (!pCrashStore->getSpace().checkFreeSpace(contentLength))
   {
     // exit this function
     return;
   }
 
   // open the file in appending mode
-  File fileCrashFile = SPIFFS.open(fileName, "a");
+  File fileCrashFile = fileSystem.open(fileName, "a");
 
   // if the file does not yet exist
   if(!fileCrashFile)
   {
     // open the file in write mode
-    fileCrashFile = SPIFFS.open(fileName, "w");
+    fileCrashFile = fileSystem.open(fileName, "w");
   }
 
   // if the file is a valid file
   if(fileCrashFile)
   {
     // size_t File::write(const uint8_t *buf, size_t size);
-    fileCrashFile.write(content, strlen(content));
+    pCrashStore->getSpace().onWrite(fileCrashFile.write(content, contentLength));
 
     fileCrashFile.close();
   }
 }
 
 /**
- * This function is called automatically if ESP8266 suffers an exception
- * It should be kept quick / consise to be able to execute before hardware wdt may kick in
+ * @brief      Sets the crash flush callback.
  *
- * Without writing to SPIFFS this function take 2-3ms
- * Writing to flash only takes 10-11ms.
- * This complete function should be finised in 15-20ms
+ * The callback is called by the crash callback after the crash log has been
+ * saved, e.g. to save the pending lines of an EspSaveCrashLogger.
+ *
+ * @param[in]  callback  The callback
  */
-extern "C" void custom_crash_callback(struct rst_info * rst_info, uint32_t stack, uint32_t stack_end)
+void setCrashFlushCallback(crashFlushCallback_t callback)
 {
-  uint32_t crashTime = millis();
-
-  // create loop iterators
-  int16_t i;
-  uint8_t j;
-
-  char* _thisCrashFilePath = (char*)calloc(100, sizeof(char));
-  if (pcCrashFilePath)
-  {
-    // use the new created/set name
-    _thisCrashFilePath = pcCrashFilePath;
-    Serial.printf("No NULL pointer, using '%s'", _thisCrashFilePath);
-  }
-  else
-  {
-    // use the default crash file naming
-    sprintf(_thisCrashFilePath, "%s%s", CRASHFILEPATH, CRASHFILENAME);
-    Serial.printf("NULL pointer, created default filepath: '%s'", _thisCrashFilePath);
-  }
-
-  // flag to break the loop in case the buffer is full
-  // uint8_t breakFlag = 0;
-
-  // open the file in appending mode
-  File fileCrashFile = SPIFFS.open(_thisCrashFilePath, "a");
-
-  // if the file does not yet exist
-  if(!fileCrashFile)
-  {
-    // open the file in write mode
-    fileCrashFile = SPIFFS.open(_thisCrashFilePath, "w");
-  }
-  free(_thisCrashFilePath);
-
-  // if the file is (now) a valid file
-  if(fileCrashFile)
-  {
-    // // one complete log has 170 chars + 45 * n
-    // // n >= 2 e [2, 4, 6, ...]
-    // // 4220 + safety will last for 90 stack traces including header (170)
-    // // uint16_t maximumFileContent = 4250;
-
-    // maximum tmpBuffer size needed is 83, so 100 should be enough
-    char *tmpBuffer = (char*)calloc(100, sizeof(char));
-    // char *fileContent = (char*)calloc(maximumFileContent, sizeof(char));
-
-    // max. 65 chars of Crash time, reason, exception
-    sprintf(tmpBuffer, "Crashed at %d ms\nRestart reason: %d\nException cause: %d\n", crashTime, rst_info->reason, rst_info->exccause);
-    // strcat(fileContent, tmpBuffer);
-    fileCrashFile.write(tmpBuffer, strlen(tmpBuffer));
-
-    // 83 chars of epc1, epc2, epc3, excvaddr, depc info + 13 chars of >stack>
-    sprintf(tmpBuffer, "epc1=0x%08x epc2=0x%08x epc3=0x%08x excvaddr=0x%08x depc=0x%08x\n>>>stack>>>\n", rst_info->epc1, rst_info->epc2, rst_info->epc3, rst_info->excvaddr, rst_info->depc);
-    // strcat(fileContent, tmpBuffer);
-    fileCrashFile.write(tmpBuffer, strlen(tmpBuffer));
-
-    int16_t stackLength = stack_end - stack;
-    uint32_t stackTrace;
-
-    // strcat(fileContent, ">>>stack>>>\n");
-    // fileCrashFile.write(">>>stack>>>\n", strlen(">>>stack>>>\n"));
-
-    // collect stack trace
-    // one loop contains 45 chars of stack address and its content
-    // e.g. "3fffffb0: feefeffe feefeffe 3ffe8508 40100459"
-    for (i = 0; i < stackLength; i += 0x10)
-    {
-      // // if the breakFlag is set
-      // // OR this loop content (45 char) and <<<stack<<<\n\n (15 char)
-      // // won't fit anymore into the fileContent buffer
-      // if ((breakFlag == 1) || ((strlen(fileContent) + 45 + 15) >= maximumFileContent))
-      // {
-      //   break;
-      // }
-
-      sprintf(tmpBuffer, "%08x: ", stack + i);
-      // strcat(fileContent, tmpBuffer);
-      fileCrashFile.write(tmpBuffer, strlen(tmpBuffer));
-
-      for (j = 0; j < 4; j++)
-      {
-        uint32_t* byteptr = (uint32_t*) (stack + i+j*4);
-        stackTrace = *byteptr;
-
-        sprintf(tmpBuffer, "%08x ", stackTrace);
-        fileCrashFile.write(tmpBuffer, strlen(tmpBuffer));
-
-        // // check if this tmpBuffer iteration and the <<<stack<<< (15 char aprox)
-        // // will fit finally into the fileContent buffer
-        // if ((15 + strlen(fileContent) + strlen(tmpBuffer)) < maximumFileContent)
-        // {
-        //   strcat(fileContent, tmpBuffer);
-        // }
-        // else
-        // {
-        //   // set the breakFlag
-        //   breakFlag = 1;
-
-        //   // break from this loop
-        //   break;
-        // }
-      }
-      // strcat(fileContent, "\n");
-      fileCrashFile.write("\n", strlen("\n"));
-    }
-    // as we checked +15 char, this will always fit
-    // strcat(fileContent, "<<<stack<<<\n\n");
-    fileCrashFile.write("<<<stack<<<\n\n", strlen("<<<stack<<<\n\n"));
-
-    // free the tmpBuffer before saving to SPIFFS gives another 100 byte of RAM
-    free(tmpBuffer);
-
-    // save to pcCrashFilePath
-    // saveToSpiffsLog(fileContent);
-    //
-    // save to custom file
-    // saveToSpiffsFile(fileContent, aCustomFileName);
-
-    // free the fileContent, this will happen anyway due to reset of the device
-    // free(fileContent);
-
-    fileCrashFile.close();
-  }
+  pfnCrashFlush = callback;
 }
 
+#if CRASH_ENABLE_HMAC
 /**
- * @brief      Constructs a new instance.
+ * @brief      Sets the device key of the crash record HMAC.
  *
- * check whether the crash file is not empty.
- * if the file has content
- *  - check weather enough space is available
- *  - find the next filename (based on the crash file name and extension)
- *  - rename the file to the next free filename
- * if the file is empty, continue without any action
+ * Each following crash record gets a HMAC-SHA256 line, e.g. to prove the
+ * record has not been modified after it has been pulled from the device.
  *
- * @param      alternativeFilePath  The alternative crash log file path
+ * @param[in]  key        The key
+ * @param[in]  keyLength  The key length in byte
  */
-EspSaveCrashSpiffs::EspSaveCrashSpiffs(char *alternativeFilePath)
+void setCrashHmacKey(const uint8_t* key, size_t keyLength)
 {
-  // just for debug
-  Serial.begin(115200);
-
-  // update the statifn only if a new filename is given
-  if (alternativeFilePath)
-  {
-    pcCrashFilePath = alternativeFilePath;
-    // Serial.printf("Alternative filepath given: '%s'\n", pcCrashFilePath);
-  }
-  else
-  {
-    // set the default crash file
-    pcCrashFilePath = (char*)calloc(100, sizeof(char));
-    sprintf(pcCrashFilePath, "%s%s", CRASHFILEPATH, CRASHFILENAME);
-    // Serial.printf("Created filepath based on .h file definitions: '%s'\n", pcCrashFilePath);
-  }
-
-  SPIFFS.begin();
-
-  // open the file in reading mode
-  File fileCrashFile = SPIFFS.open(pcCrashFilePath, "r");
-
-  // if the file is a valid file (it exists)
-  if(fileCrashFile)
-  {
-    // allocate some space for the filename and filepath
-    char *nextFileName = (char*)calloc(255, sizeof(char));
-    char *nextFilePath = (char*)calloc(255, sizeof(char));
-
-    // find the new/next filename
-    _find_file_name(1, nextFileName, CRASHFILEPATH, CRASHFILEPATTERN, CRASHFILEEXTENSION);
-    // Serial.printf("Found next filename: '%s'\n", nextFileName);
-
-    // rename only if the next filename is valid
-    if (strlen(nextFileName))
-    {
-      // create the filepath (must always start with '/')
-      sprintf(nextFilePath, "%s%s", CRASHFILEPATH, nextFileName);
-
-      // rename the old file to the new generated filename
-      Serial.printf("Renaming file '%s' to '%s'\n", getLogFileName(), nextFilePath);
-      // SPIFFS.rename(pathFrom, pathTo)
-      SPIFFS.rename(pcCrashFilePath, nextFilePath);
-
-      // write filename to file
-      File lastFileNameFile = SPIFFS.open(LASTCRASHFILEPATH, "w+");
-      // size_t File::write(const uint8_t *buf, size_t size);
-      lastFileNameFile.write(nextFilePath, strlen(nextFilePath));
-      lastFileNameFile.close();
-    }
-
-    // free the allocated space
-    free(nextFileName);
-    free(nextFilePath);
-  }
+  br_hmac_key_init(&crashHmacKey, &br_sha256_vtable, key, keyLength);
+  bCrashHmacKey = true;
 }
+#endif
 
 /**
- * @brief      Gets the string after the found pattern.
+ * @brief      Write a part of the crash record and update its checksums.
  *
- * If nothing is found, it will return Null.
- * Given 'asdf-12.xyz' as theString and '-' as thePattern, this function
- * will return '-12'
- *
- * @param[in]  theString   The string
- * @param[in]  thePattern  The pattern
- *
- * @return     The position in the string.
+ * @param      fileCrashFile  The opened crash log file
+ * @param[in]  pcData         The data
+ * @param[in]  length         The length of the data
  */
-const char* EspSaveCrashSpiffs::_get_from_string(const char *theString, const char thePattern)
+static void _write_record(File& fileCrashFile, const char* pcData, size_t length)
 {
-  char *pos = strrchr(theString, thePattern);
+  fileCrashFile.write(pcData, length);
 
-  return pos;
+#if CRASH_ENABLE_CRC
+  ulRecordCrc = crashCrc32(ulRecordCrc, pcData, length);
+#endif
+#if CRASH_ENABLE_HMAC
+  if (bCrashHmacKey)
+  {
+    br_hmac_update(&crashRecordHmac, pcData, length);
+  }
+#endif
 }
 
+#if CRASH_ENABLE_MEMORY_WINDOW
 /**
- * @brief      Gets the file extension.
+ * @brief      Check if a memory range can be read without a further crash.
  *
- * Given 'asdf-12.xyz' as filename, this function will return 'xyz'
+ * The range has to be within a single region of the data RAM, the ROM, the
+ * IRAM or the memory mapped flash.
  *
- * @param[in]  fileName  The filename
+ * @param[in]  ulStart   The start address, 4 byte aligned
+ * @param[in]  ulLength  The length in byte
  *
- * @return     The file extension.
+ * @retval     True   Range is readable with 32 bit access
+ * @retval     False  Range is not readable
  */
-const char* EspSaveCrashSpiffs::_get_file_extension(const char *fileName)
+static bool _is_readable_range(uint32_t ulStart, uint32_t ulLength)
 {
-  // add +1 to not use or return the '.' itself
-  return _get_from_string(fileName, '.')+1;
-}
+  // start and end of the readable regions
+  static const uint32_t pulRegions[][2] = {
+    {0x3FFE8000, 0x40000000},  // data RAM
+    {0x40000000, 0x40010000},  // ROM
+    {0x40100000, 0x40108000},  // IRAM
+    {0x40200000, 0x40300000}   // memory mapped flash
+  };
+
+  for (uint8_t i = 0; i < (sizeof(pulRegions) / sizeof(pulRegions[0])); i++)
+  {
+    if ((ulStart >= pulRegions[i][0]) && (ulStart < pulRegions[i][1]) && (ulLength <= (pulRegions[i][1] - ulStart)))
+    {
+      return true;
+    }
+  }
 
-/**
- * @brief      Extract the filename from the file string
- *
- * Given 'asdf-12.xyz' as filename, this function will return 'asdf-12'
- *
- * @param[in]  name      The name
- * @param      fileName  The filename
- */
-void EspSaveCrashSpiffs::_extract_file_name(const char *name, char *fileName)
-{
-  memcpy(fileName, name, _get_from_string(name, '.')-name);
+  return false;
 }
 
 /**
- * @brief      Check if some string starts with some other
+ * @brief      Write a hexdump of the memory around an address.
  *
- * @param[in]  a     The string to check
- * @param[in]  b     The start string
+ * The window of CRASH_MEMORY_WINDOW_BYTES is centered on the address and
+ * written as 32 bit words, e.g.
+ * "Memory excvaddr 3ffef3f0: 3ffef400 00000000 40202cfd 00000001"
+ * Nothing is written if the window is not readable.
  *
- * @retval     True   Success
- * @retval     False  Failed
+ * @param      fileCrashFile  The opened crash log file
+ * @param      tmpBuffer      The line buffer
+ * @param[in]  pcName         The name of the address
+ * @param[in]  ulAddress      The address
  */
-uint8_t EspSaveCrashSpiffs::_starts_with(const char *a, const char *b)
+static void _save_memory_window(File& fileCrashFile, char* tmpBuffer, const char* pcName, uint32_t ulAddress)
 {
-  if(strncmp(a, b, strlen(b)) == 0) return 1;
-  return 0;
+  uint32_t ulStart = (ulAddress & ~0x3) - (CRASH_MEMORY_WINDOW_BYTES / 2);
+
+  // the window would wrap around or the address is no memory at all
+  if ((ulAddress < (CRASH_MEMORY_WINDOW_BYTES / 2)) || !_is_readable_range(ulStart, CRASH_MEMORY_WINDOW_BYTES))
+  {
+    return;
+  }
+
+  // max. 26 chars of name and start address
+  sprintf(tmpBuffer, "Memory %s %08x:", pcName, ulStart);
+  _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+
+  // only aligned 32 bit reads are possible in IRAM and flash
+  for (uint32_t i = 0; i < CRASH_MEMORY_WINDOW_BYTES; i += 4)
+  {
+    sprintf(tmpBuffer, " %08x", *(volatile uint32_t*)(ulStart + i));
+    _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+  }
+  _write_record(fileCrashFile, "\n", strlen("\n"));
 }
+#endif
 
+#if CRASH_ENABLE_POLICY
 /**
- * @brief      Check if some string ends with some other
+ * @brief      Estimate the size of a crash log.
  *
- * @param[in]  a     The string to check
- * @param[in]  b     The end string
+ * @param[in]  stackLength  The number of stack bytes, zero for the header
  *
- * @retval     True   Success
- * @retval     False  Failed
+ * @return     The estimated size in byte
  */
-uint8_t EspSaveCrashSpiffs::_ends_with(const char *a, const char *b)
+static uint32_t _get_crash_record_size(int16_t stackLength)
 {
-  if(strncmp(a+strlen(a)-strlen(b), b, strlen(b)) == 0) return 1;
-  return 0;
+  // max. 400 chars of header, info lines and breadcrumbs plus the build id
+  uint32_t ulSize = 400 + 8 + CRASH_RECORD_BUILD_ID_SIZE;
+
+#if CRASH_ENABLE_CRC
+  ulSize += 14;
+#endif
+#if CRASH_ENABLE_HMAC
+  ulSize += 71;
+#endif
+
+  if (stackLength > CRASH_STACK_MAX_BYTES)
+  {
+    stackLength = CRASH_STACK_MAX_BYTES;
+  }
+
+  // 46 chars per 16 stack bytes
+  ulSize += (stackLength / 16) * 46;
+
+#if CRASH_ENABLE_MEMORY_WINDOW
+  // 4 memory windows of 26 chars and 9 chars per word
+  ulSize += 4 * (26 + ((CRASH_MEMORY_WINDOW_BYTES / 4) * 9));
+#endif
+
+  return ulSize;
 }
+#endif
 
 /**
- * @brief      Find the next or most recent file name.
- *
- * Crawl the directory for files matching the pattern and the extension.
- *
- * @param[in]  nextOrLatest    Copy next (1) most recent (0) to nextFileName
- * @param      nextFileName    The next file name
- * @param[in]  filePattern     The file pattern
- * @param[in]  fileExtension   The file extension
- *
- * Example usage to find the most recent file:
- * @code
- *    // allocate some space for the file name
- *    char* fileName = (char*)calloc(100, sizeof(char));
- *
- *    // find the most recent file starting with 'crashLog'
- *    // and ending with 'log' in the root directory '/'
- *    // fileName will be e.g. 'crashLog-123.log'
- *    // if the most recent one was called 'crashLog-123.log'
- *    _find_file_name(0, fileName, "/", "crashLog", "log");
- * @endcode
+ * @brief      Write a crash record to the crash log file.
  *
- * Example usage to find the next file:
- * @code
- *    // allocate some space for the file name
- *    char* fileName = (char*)calloc(100, sizeof(char));
+ * Used by the crash callback and to save the IRAM crash snapshot on the
+ * next boot. The stack words are read from pulStack, their addresses are
+ * printed starting at ulStackAddress.
  *
- *    // find the next filename based on starting with 'crashLog'
- *    // and ending with 'log' in the root directory '/'
- *    // fileName will be e.g. 'crashLog-124.log'
- *    // if the most recent one was called 'crashLog-123.log'
- *    _find_file_name(1, fileName, "/", "crashLog", "log");
- * @endcode
+ * @param      fileCrashFile   The opened crash log file
+ * @param[in]  rst_info        The reset info of the crash
+ * @param[in]  crashTime       The crash time
+ * @param[in]  ulStackAddress  The address of the first stack word
+ * @param[in]  pulStack        The stack words
+ * @param[in]  stackLength     The number of stack bytes
+ * @param[in]  bLiveCapture    Flag to save heap info, breadcrumbs and memory
+ *                             windows, only valid within the crash callback
  */
-void EspSaveCrashSpiffs::_find_file_name(uint8_t nextOrLatest, char* nextFileName, const char* directoryName, const char* filePattern, const char* fileExtension)
+static void _save_crash_record(File& fileCrashFile, const struct rst_info* rst_info, uint32_t crashTime, uint32_t ulStackAddress, const uint32_t* pulStack, int16_t stackLength, bool bLiveCapture)
 {
-  uint32_t ulNextCrashLogFileIndex = 0;
+  // create loop iterators
+  int16_t i;
+  uint8_t j;
 
-  // allocate some space for the filepath
-  char *thisRawFilePath = (char*)calloc(255, sizeof(char));
+  // flag to skip the stack trace in case of a crash loop
+  bool bSkipStack = false;
 
-  // if no directory name is given
-  if (!directoryName)
+  // flag to save only the header of a sampled crash
+  bool bHeaderOnly = false;
+
+  // size before this record, to account the written bytes
+  size_t fileSize = fileCrashFile.size();
+
+#if CRASH_ENABLE_CRASHLOOP
+  if (pCrashLoop)
   {
-    // take the default root directory
-    directoryName = (char*)"/";
-    // Serial.println("No directory given, using default root");
+    bSkipStack = pCrashLoop->isDetected();
   }
-  Dir thisDirectory = SPIFFS.openDir(directoryName);
-  // or Dir thisDirectory = LittleFS.openDir("/data");
+#endif
 
-  // Serial.printf("Crawling directory: '%s'\n", directoryName);
+#if CRASH_ENABLE_POLICY
+  // sample repeated crashes and limit the flash bytes of the crash logs
+  crashPolicyDecision_t decision = CRASH_POLICY_FULL;
+  uint32_t ulSignature = crashPolicySignature(rst_info->reason, rst_info->exccause, rst_info->epc1);
+  uint32_t ulDropped = 0;
 
-  // iterate through all files in this directory
-  while (thisDirectory.next())
+  if (pCrashPolicy)
   {
-    // collect filename of this loop iteration
-    sprintf(thisRawFilePath, "%s", thisDirectory.fileName().c_str());
+    uint32_t ulFullSize = _get_crash_record_size(bSkipStack ? 0 : stackLength);
 
-    // get only the filename without any directory
-    // '/path/to/logs/crashLog-1.log' becomes 'crashLog-1.log'
-    const char* thisFile = _get_from_string(thisRawFilePath, '/');
+    ulDropped = pCrashPolicy->getDropped();
+    decision = pCrashPolicy->onCrash(crashTime, ulSignature, ulFullSize, _get_crash_record_size(0));
 
-    // if the file has some path before it's actual filename
-    if (thisFile)
+    // keep at least the header on a nearly full filesystem
+    if ((decision == CRASH_POLICY_FULL) && pCrashStore && !pCrashStore->getSpace().checkFreeSpace(ulFullSize))
     {
-      // take everything after the last occurance of a backslash
-      thisFile = thisFile + 1;
+      decision = CRASH_POLICY_HEADER;
     }
+  }
 
-    // Serial.printf("The filename only: '%s'\n", thisFile);
+  if (decision == CRASH_POLICY_DROP)
+  {
+    return;
+  }
+  if (decision == CRASH_POLICY_HEADER)
+  {
+    bHeaderOnly = true;
+  }
+#endif
+
+  // // one complete log has 170 chars + 45 * n
+  // // n >= 2 e [2, 4, 6, ...]
+  // // 4220 + safety will last for 90 stack traces including header (170)
+  // // uint16_t maximumFileContent = 4250;
+
+  // maximum tmpBuffer size needed is 83, statically sized on the stack
+  char tmpBuffer[CRASH_LINE_BUFFER_SIZE];
+
+  // start the checksums of this record
+#if CRASH_ENABLE_CRC
+  ulRecordCrc = 0;
+#endif
+#if CRASH_ENABLE_HMAC
+  if (bCrashHmacKey)
+  {
+    br_hmac_init(&crashRecordHmac, &crashHmacKey, 0);
+  }
+#endif
 
-    // allocate some space for the filename
-    char *thisFileName = (char*)calloc(255, sizeof(char));
+  // max. 65 chars of Crash time, reason, exception
+  sprintf(tmpBuffer, "Crashed at %d ms\nRestart reason: %d\nException cause: %d\n", crashTime, rst_info->reason, rst_info->exccause);
+  _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
 
+  if (pCrashStore)
+  {
+    // build id of the running firmware, limited to the parser buffer
+    const char* pcBuildId = pCrashStore->getBuildId();
+    size_t buildIdLength = strnlen(pcBuildId, CRASH_RECORD_BUILD_ID_SIZE - 1);
 
-    // gets 'asdf-12' out of 'asdf-12.xyz'
-    _extract_file_name(thisFile, thisFileName);
-    // Serial.printf("\t File name: '%s'\n", thisFileName);
+    _write_record(fileCrashFile, "Build: ", strlen("Build: "));
+    _write_record(fileCrashFile, pcBuildId, buildIdLength);
+    _write_record(fileCrashFile, "\n", strlen("\n"));
+  }
 
+#if CRASH_ENABLE_HEAP_INFO
+  if (bLiveCapture)
+  {
+    // heap statistics, fragmentation is a hint for the crash reason
+    uint32_t ulFreeHeap;
+    uint16_t uwMaxFreeBlock;
+    uint8_t ubHeapFragmentation;
+    ESP.getHeapStats(&ulFreeHeap, &uwMaxFreeBlock, &ubHeapFragmentation);
+
+    // max. 45 chars of heap info
+    sprintf(tmpBuffer, "Heap: free=%u frag=%u%% max=%u\n", ulFreeHeap, ubHeapFragmentation, uwMaxFreeBlock);
+    _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+  }
+#endif
 
-    // gets 'xyz' out of 'asdf-12.xyz'
-    char *thisFileExtension = (char*) _get_file_extension(thisFile);
-    // Serial.printf("\t Extension: '%s'\n", thisFileExtension);
+#if CRASH_ENABLE_CRASHLOOP
+  if (pCrashLoop && pCrashLoop->isDetected())
+  {
+    // max. 35 chars of crash loop info
+    sprintf(tmpBuffer, "Crash loop: %d crashes\n", pCrashLoop->getCrashCount());
+    _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+  }
+#endif
 
+#if CRASH_ENABLE_POLICY
+  if (decision == CRASH_POLICY_HEADER)
+  {
+    // max. 28 chars of sampling info
+    sprintf(tmpBuffer, "Sampled: signature %08x\n", ulSignature);
+    _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+  }
+  if (ulDropped)
+  {
+    // max. 30 chars of dropped crashes
+    sprintf(tmpBuffer, "Dropped: %u crashes\n", ulDropped);
+    _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+  }
+#endif
 
-    // gets the string after the given delimiter. E.g. '-12'
-    const char *delimiterPosition = _get_from_string(thisFileName, '-');
+  // 83 chars of epc1, epc2, epc3, excvaddr, depc info
+  sprintf(tmpBuffer, "epc1=0x%08x epc2=0x%08x epc3=0x%08x excvaddr=0x%08x depc=0x%08x\n", rst_info->epc1, rst_info->epc2, rst_info->epc3, rst_info->excvaddr, rst_info->depc);
+  _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
 
-    // if a valid content has been found
-    if (delimiterPosition)
+#if CRASH_ENABLE_BREADCRUMBS
+  if (bLiveCapture)
+  {
+    // breadcrumbs as 'code:value' of 10 chars each, oldest first
+    // e.g. "Breadcrumbs: 0010:0003 0011:0000"
+    _write_record(fileCrashFile, "Breadcrumbs:", strlen("Breadcrumbs:"));
+    uint32_t ulBreadcrumbHead = crashBreadcrumbs.ulHead;
+    uint32_t ulBreadcrumb = (ulBreadcrumbHead > CRASH_BREADCRUMBS_SIZE) ? (ulBreadcrumbHead - CRASH_BREADCRUMBS_SIZE) : 0;
+    for (; ulBreadcrumb < ulBreadcrumbHead; ulBreadcrumb++)
     {
-      // Serial.printf("\t File name '%s' contains delimiter '-'\n", thisFileName);
-
+      uint32_t ulEntry = crashBreadcrumbs.pulEntries[ulBreadcrumb & (CRASH_BREADCRUMBS_SIZE - 1)];
 
-      // gets '12' out of 'asdf-12'
-      char *thisFileIndex = (char*)delimiterPosition+1;
-      // Serial.printf("\t Splitted file index (str): '%s'\n", thisFileIndex);
+      sprintf(tmpBuffer, " %04x:%04x", ulEntry >> 16, ulEntry & 0xFFFF);
+      _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+    }
+    _write_record(fileCrashFile, "\n", strlen("\n"));
+  }
+#endif
 
+#if CRASH_ENABLE_MEMORY_WINDOW
+  // memory around the faulting data address and the exception PCs,
+  // skipped like the stack trace in a crash loop or of a sampled crash
+  if (bLiveCapture && !bSkipStack && !bHeaderOnly)
+  {
+    _save_memory_window(fileCrashFile, tmpBuffer, "excvaddr", rst_info->excvaddr);
+    _save_memory_window(fileCrashFile, tmpBuffer, "epc1", rst_info->epc1);
+    _save_memory_window(fileCrashFile, tmpBuffer, "epc2", rst_info->epc2);
+    _save_memory_window(fileCrashFile, tmpBuffer, "epc3", rst_info->epc3);
+  }
+#endif
+  _write_record(fileCrashFile, ">>>stack>>>\n", strlen(">>>stack>>>\n"));
 
-      // convert the thisFileIndex to an integer. E.g. make 12 out of '12'
-      uint32_t ulThisFileIndex = atoi(thisFileIndex);
+  // throttle the stack trace capture in a crash loop, skip it of a sampled
+  // crash and limit it to the most recent CRASH_STACK_MAX_BYTES
+  if (bSkipStack || bHeaderOnly)
+  {
+    stackLength = 0;
+  }
+  if (stackLength > CRASH_STACK_MAX_BYTES)
+  {
+    stackLength = CRASH_STACK_MAX_BYTES;
+  }
 
-      // if atoi was successful (larger zero)
-      if (ulThisFileIndex > 0)
-      {
-        // get 12 (based on the example)
-        // Serial.printf("\t Final evaluated file index (int): %d\n", ulThisFileIndex);
+  // collect stack trace
+  // one loop contains 45 chars of stack address and its content
+  // e.g. "3fffffb0: feefeffe feefeffe 3ffe8508 40100459"
+  for (i = 0; i < stackLength; i += 0x10)
+  {
+    sprintf(tmpBuffer, "%08x: ", ulStackAddress + i);
+    _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
 
+    for (j = 0; j < 4; j++)
+    {
+      sprintf(tmpBuffer, "%08x ", pulStack[(i / 4) + j]);
+      _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+    }
+    _write_record(fileCrashFile, "\n", strlen("\n"));
+  }
+#if CRASH_ENABLE_HMAC
+  if (bCrashHmacKey)
+  {
+    uint8_t pubHmac[32];
+    br_hmac_out(&crashRecordHmac, pubHmac);
 
-        // same as get_file_name but with delimiter '-' instead of '.'
-        // gets 'asdf' out of 'asdf-12'
-        // allocate some space for the filename without it's index
-        char *thisFileNameWithoutIndex = (char *)calloc(strlen(thisFileName)+1, sizeof(char));
-        memcpy(thisFileNameWithoutIndex, thisFileName, delimiterPosition-thisFileName);
-        // Serial.printf("\t File name without index and delimiter: '%s'\n", thisFileNameWithoutIndex);
+    // 71 chars of HMAC-SHA256, covers the record up to here
+    sprintf(tmpBuffer, "HMAC: ");
+    for (j = 0; j < sizeof(pubHmac); j++)
+    {
+      sprintf(tmpBuffer + strlen("HMAC: ") + (2 * j), "%02x", pubHmac[j]);
+    }
+    strcat(tmpBuffer, "\n");
+    _write_record(fileCrashFile, tmpBuffer, strlen(tmpBuffer));
+  }
+#endif
 
+#if CRASH_ENABLE_CRC
+  // 14 chars of CRC32, covers the record up to here
+  sprintf(tmpBuffer, "CRC: %08x\n", ulRecordCrc);
+  fileCrashFile.write(tmpBuffer, strlen(tmpBuffer));
+#endif
 
-        // if the file pattern and the extension are matching (result is 0)
-        if ((strcmp(thisFileNameWithoutIndex, filePattern) == 0) && (strcmp(thisFileExtension, fileExtension) == 0))
-        {
-          // Serial.printf("\t Matches pattern '%s' and extension '%s'\n", filePattern, fileExtension);
+  fileCrashFile.write("<<<stack<<<\n\n", strlen("<<<stack<<<\n\n"));
 
-          // if the current file index is larger than the previous found
-          if ((ulThisFileIndex + 1) > ulNextCrashLogFileIndex)
-          {
-            ulNextCrashLogFileIndex = ulThisFileIndex + 1;
-
-            // check for null pointer
-            if (nextFileName)
-            {
-              if (nextOrLatest == 0)
-              {
-                // create new file name with non incremented aka. highest index
-                // or just simply keep this filename
-                // as it is the most recent filename
-                sprintf(nextFileName, "%s", thisFile);
-
-                // Serial.printf("\t Most recent '%s'\n", nextFileName);
-              }
-              else
-              {
-                // create new file name with incremented index
-                sprintf(nextFileName, "%s-%d.%s", thisFileNameWithoutIndex, ulNextCrashLogFileIndex, thisFileExtension);
-                // Serial.printf("\t Next will be '%s'\n", nextFileName);
-              }
-            }
-          }
-        }
-        // else
-        // {
-        //   Serial.printf("\t pattern '%s' NOT MATCHING '%s' AND extension '%s' NOT MATCHING '%s'\n", filePattern, thisFileNameWithoutIndex, fileExtension, thisFileExtension);
-        // }
+  size_t recordSize = fileCrashFile.size() - fileSize;
 
-        // free the allocated space
-        free(thisFileNameWithoutIndex);
-      }
-    }
-    // free the allocated space
-    free(thisFileName);
+  // keep the free space estimate up to date
+  if (pCrashStore)
+  {
+    pCrashStore->getSpace().onWrite(recordSize);
   }
 
-  // free the allocated space
-  free(thisRawFilePath);
+#if CRASH_ENABLE_POLICY
+  if (pCrashPolicy)
+  {
+    pCrashPolicy->onWrite(recordSize);
+  }
+#endif
 }
 
 /**
- * @brief      Removes a file.
- *
- * If the given number is zero, the current log file will be removed.
- * Otherwise the file at that index.
- *
- * @param[in]  fileNumber  The file number
+ * @brief      Open the crash log file of the crash store for appending.
  *
- * @retval     True   Success
- * @retval     False  Failed
+ * @return     The opened file, invalid if there is no crash store
  */
-bool EspSaveCrashSpiffs::removeFile(uint32_t ulFileNumber)
+static File _open_crash_file()
 {
-  // if there is a filenumber given, remove this
-  if (ulFileNumber > 0)
+  // without any instance the crash can not be saved
+  if (!pCrashStore)
   {
-    uint32_t ulThisFileNumber = 0;
-    Dir thisDirectory = SPIFFS.openDir("/");
-
-    while (thisDirectory.next())
-    {
-      ulThisFileNumber++;
-
-      // if the given and the current file index are matching
-      if (ulThisFileNumber == ulFileNumber)
-      {
-        // Serial.printf("Reached file #%d named '%s'\n", ulFileNumber, thisDirectory.fileName().c_str());
+    return File();
+  }
 
-        // allocate some space for latestFileName
-        char *latestFileName = (char*)calloc(255, sizeof(char));
-        char *latestFilePath = (char*)calloc(255, sizeof(char));
+  FS& fileSystem = pCrashStore->getFileSystem();
+  const char* _thisCrashFilePath = pCrashStore->getLogFileName();
 
-        // re-create the filepath (must always start with '/')
-        sprintf(latestFilePath, "%s%s", CRASHFILEPATH, CRASHFILEPATTERN);
+  // open the file in appending mode
+  File fileCrashFile = fileSystem.open(_thisCrashFilePath, "a");
 
-        // if this file is a crash log file
-        if (_starts_with(thisDirectory.fileName().c_str(), latestFilePath) && _ends_with(thisDirectory.fileName().c_str(), CRASHFILEEXTENSION))
-        {
-          // Serial.printf("File starts with '%s' and ends with '%s'\n", latestFilePath, CRASHFILEEXTENSION);
+  // if the file does not yet exist
+  if(!fileCrashFile)
+  {
+    // open the file in write mode
+    fileCrashFile = fileSystem.open(_thisCrashFilePath, "w");
+  }
 
-          // find the most recent filename, do not rely on LASTCRASHFILEPATH
-          _find_file_name(0, latestFileName, CRASHFILEPATH, CRASHFILEPATTERN, CRASHFILEEXTENSION);
+  return fileCrashFile;
+}
 
-          // re-create the filepath (must always start with '/')
-          sprintf(latestFilePath, "%s%s", CRASHFILEPATH, latestFileName);
+/**
+ * @brief      Close the crash log file.
+ *
+ * A file left empty, e.g. by a crash dropped by the crash report policy, is
+ * removed to not rotate empty crash logs.
+ *
+ * @param      fileCrashFile  The opened crash log file
+ */
+static void _close_crash_file(File& fileCrashFile)
+{
+  bool bEmpty = (fileCrashFile.size() == 0);
 
-          // if this filename matches the latest crash log file (result is 0)
-          if (strcmp(thisDirectory.fileName().c_str(), latestFilePath) == 0)
-          {
-            // Serial.printf("The file '%s' is the most recent crash log file\n", latestFilePath);
+  fileCrashFile.close();
 
-            // remove this current file, it exists for sure as we iterate
-            SPIFFS.remove(thisDirectory.fileName().c_str());
+  if (bEmpty && pCrashStore)
+  {
+    pCrashStore->getFileSystem().remove(pCrashStore->getLogFileName());
+  }
+}
 
-            // reset the content
-            memset(latestFileName, 0, sizeof(char));
+#if CRASH_IRAM_CAPTURE
+#ifndef IRAM_ATTR
+#define IRAM_ATTR ICACHE_RAM_ATTR
+#endif
 
-            // find the NOW most recent filename
-            _find_file_name(0, latestFileName, CRASHFILEPATH, CRASHFILEPATTERN, CRASHFILEEXTENSION);
+/**
+ * This function is called automatically if ESP8266 suffers an exception
+ *
+ * IRAM variant, enabled by CRASH_IRAM_CAPTURE. It does not depend on the
+ * flash cache, so it can capture crashes during flash operations. Only
+ * registers and stack words are copied to the RTC user memory, without any
+ * string, sprintf or filesystem access. Only millis() is called, which is
+ * kept in IRAM by the core. The crash log is saved on the next
+ * boot by the crash store, see _save_snapshot.
+ *
+ * This function takes some microseconds, independent of the filesystem.
+ */
+extern "C" void IRAM_ATTR custom_crash_callback(struct rst_info * rst_info, uint32_t stack, uint32_t stack_end)
+{
+  volatile uint32_t* pulSnapshot = (volatile uint32_t*)(CRASH_RTC_USER_MEMORY + (CRASH_SNAPSHOT_RTC_OFFSET * 4));
+  uint32_t ulStackWords = (stack_end - stack) / 4;
+  uint32_t ulCheck = 0;
+  uint32_t i;
 
-            // re-create the filepath (must always start with '/')
-            sprintf(latestFilePath, "%s%s", CRASHFILEPATH, latestFileName);
+  if (ulStackWords > CRASH_SNAPSHOT_STACK_WORDS)
+  {
+    ulStackWords = CRASH_SNAPSHOT_STACK_WORDS;
+  }
 
-            // Serial.printf("After deleting '%s' the most recent crashlog file is now '%s'\n", thisDirectory.fileName().c_str(), latestFilePath);
+  // invalidate a previous snapshot until this one is complete
+  pulSnapshot[0] = 0;
+
+  // the order MUST match crash_snapshot_t, millis() is kept in IRAM
+  pulSnapshot[1] = millis();
+  pulSnapshot[2] = rst_info->reason;
+  pulSnapshot[3] = rst_info->exccause;
+  pulSnapshot[4] = rst_info->epc1;
+  pulSnapshot[5] = rst_info->epc2;
+  pulSnapshot[6] = rst_info->epc3;
+  pulSnapshot[7] = rst_info->excvaddr;
+  pulSnapshot[8] = rst_info->depc;
+  pulSnapshot[9] = stack;
+  pulSnapshot[10] = ulStackWords;
+
+  for (i = 0; i < CRASH_SNAPSHOT_STACK_WORDS; i++)
+  {
+    pulSnapshot[12 + i] = (i < ulStackWords) ? ((volatile uint32_t*)stack)[i] : 0;
+  }
 
-            // overwrite with the now most recent log file name
-            File lastFileNameFile = SPIFFS.open(LASTCRASHFILEPATH, "w+");
-            // size_t File::write(const uint8_t *buf, size_t size);
-            lastFileNameFile.write(latestFilePath, strlen(latestFilePath));
-            lastFileNameFile.close();
-          }
-          else
-          {
-            // remove this current file, it exists for sure as we iterate
-            SPIFFS.remove(thisDirectory.fileName().c_str());
-          }
-        }
-        else
-        {
-          // Serial.printf("Some other file, no '%s'*.'%s'\n", CRASHFILEPATTERN, CRASHFILEEXTENSION);
+  // same check value as crashSnapshotCheck(), the magic is written last
+  for (i = 1; i < (12 + CRASH_SNAPSHOT_STACK_WORDS); i++)
+  {
+    if (i != 11)
+    {
+      ulCheck += pulSnapshot[i];
+    }
+  }
+  pulSnapshot[11] = ~(ulCheck + CRASH_SNAPSHOT_MAGIC);
+  pulSnapshot[0] = CRASH_SNAPSHOT_MAGIC;
+}
+#else
+/**
+ * This function is called automatically if ESP8266 suffers an exception
+ * It should be kept quick / consise to be able to execute before hardware wdt may kick in
+ *
+ * Without writing to SPIFFS this function take 2-3ms
+ * Writing to flash only takes 10-11ms.
+ * This complete function should be finised in 15-20ms
+ */
+extern "C" void custom_crash_callback(struct rst_info * rst_info, uint32_t stack, uint32_t stack_end)
+{
+  uint32_t crashTime = millis();
 
-          // remove this current file, it exists for sure as we iterate
-          SPIFFS.remove(thisDirectory.fileName().c_str());
-        }
+#if CRASH_ENABLE_CRASHLOOP
+  // update the crash loop detection and keep it in the RTC memory
+  if (pCrashLoop)
+  {
+    pCrashLoop->onCrash(crashTime);
+    ESP.rtcUserMemoryWrite(CRASHLOOP_RTC_OFFSET, (uint32_t*)&pCrashLoop->state, sizeof(pCrashLoop->state));
+  }
+#endif
 
-        // free the allocated space
-        free(latestFileName);
-        free(latestFilePath);
+  File fileCrashFile = _open_crash_file();
 
-        return true;
-      }
+  // if the file is (now) a valid file
+  if(fileCrashFile)
+  {
+    _save_crash_record(fileCrashFile, rst_info, crashTime, stack, (const uint32_t*)stack, stack_end - stack, true);
+
+    _close_crash_file(fileCrashFile);
+  }
+
+#if CRASH_ENABLE_POLICY
+  // keep the crash report policy in the RTC memory
+  if (pCrashPolicy)
+  {
+    ESP.rtcUserMemoryWrite(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&pCrashPolicy->state, sizeof(pCrashPolicy->state));
+  }
+#endif
+
+  // save pending data of other modules, after the more important crash log
+  if (pfnCrashFlush)
+  {
+    pfnCrashFlush();
+  }
+}
+#endif
+
+/**
+ * @brief      Constructs a new instance.
+ *
+ * The crash logs are saved to the root directory of the SPIFFS, or LittleFS
+ * if CRASH_USE_LITTLEFS is defined. Nothing is started here, call begin()
+ * in setup().
+ *
+ * @param      alternativeFilePath  The alternative crash log file path
+ */
+EspSaveCrashSpiffs::EspSaveCrashSpiffs(char *alternativeFilePath) :
+  _space(&CRASH_DEFAULT_FS)
+{
+  _fs = &CRASH_DEFAULT_FS;
+  _pcDirectoryName = CRASHFILEPATH;
+  _pcFilePattern = CRASHFILEPATTERN;
+  _pcFileExtension = CRASHFILEEXTENSION;
+
+  // update the filename only if a new filename is given
+  _init(alternativeFilePath ? alternativeFilePath : CRASHFILEPATH CRASHFILENAME);
+}
+
+/**
+ * @brief      Constructs a new instance.
+ *
+ * The crash logs are saved to their own directory. This keeps them apart
+ * from the application files, so only crash logs have to be crawled.
+ * Nothing is started here, call begin() in setup().
+ *
+ * @param      fileSystem     The filesystem, e.g. SPIFFS or LittleFS
+ * @param[in]  directoryName  The directory name, MUST end with '/'
+ * @param[in]  filePattern    The file pattern
+ * @param[in]  fileExtension  The file extension
+ *
+ * Example usage to save crash logs to '/crash/crashLog-N.log':
+ * @code
+ *    EspSaveCrashSpiffs SaveCrashSpiffs(LittleFS, "/crash/");
+ * @endcode
+ */
+EspSaveCrashSpiffs::EspSaveCrashSpiffs(FS& fileSystem, const char* directoryName, const char* filePattern, const char* fileExtension) :
+  _space(&fileSystem)
+{
+  _fs = &fileSystem;
+  _pcDirectoryName = directoryName;
+  _pcFilePattern = filePattern;
+  _pcFileExtension = fileExtension;
+
+  // create the crash log filepath, e.g. '/crash/crashLog-1.log'
+  char pcCrashFilePath[CRASHFILEPATH_SIZE];
+  snprintf(pcCrashFilePath, sizeof(pcCrashFilePath), "%s%s-1.%s", _pcDirectoryName, _pcFilePattern, _pcFileExtension);
+
+  _init(pcCrashFilePath);
+}
+
+/**
+ * @brief      Set the file paths, without any access to the filesystem.
+ *
+ * @param[in]  crashFilePath  The crash log file path
+ */
+void EspSaveCrashSpiffs::_init(const char* crashFilePath)
+{
+  setLogFileName((char*)crashFilePath);
+
+  // the latest file name is kept in the crash log directory
+  snprintf(_pcLastFilePath, sizeof(_pcLastFilePath), "%s%s", _pcDirectoryName, LASTCRASHFILENAME);
+
+  _pcBuildId = CRASH_BUILD_ID;
+  _pfnCrashLoop = NULL;
+  _rotateState = ROTATE_IDLE;
+  _ulRotateIndex = 0;
+  _bRotateFailed = false;
+  _ulBeginDuration = 0;
+}
+
+/**
+ * @brief      Start the filesystem and rotate the crash log.
+ *
+ * check whether the crash file is not empty.
+ * if the file has content
+ *  - check weather enough space is available
+ *  - find the next filename (based on the crash file name and extension)
+ *  - rename the file to the next free filename
+ * if the file is empty, continue without any action
+ *
+ * The first started instance saves the crashes, see setCrashStore. Crashes
+ * before begin() are not saved. The serial interface is not touched, start
+ * it in setup() to get the debug output.
+ *
+ * With CRASH_BEGIN_ASYNC_ROTATE only the crash log is checked here, the
+ * rotation is done by rotateAsync(). A crash before the rotation is
+ * appended to the previous crash log, see EspSaveCrashCompactor to split it.
+ *
+ * @param[in]  ubOptions  The options, e.g. CRASH_BEGIN_NO_MOUNT
+ *
+ * @retval     True   Success
+ * @retval     False  Failed to mount the filesystem
+ *
+ * Example usage:
+ * @code
+ *    void setup()
+ *    {
+ *      Serial.begin(115200);
+ *
+ *      // the application mounts the filesystem, rotate in the loop()
+ *      LittleFS.begin();
+ *      SaveCrashSpiffs.begin(CRASH_BEGIN_NO_MOUNT | CRASH_BEGIN_ASYNC_ROTATE);
+ *    }
+ *
+ *    void loop()
+ *    {
+ *      SaveCrashSpiffs.rotateAsync();
+ *    }
+ * @endcode
+ */
+bool EspSaveCrashSpiffs::begin(uint8_t ubOptions)
+{
+  uint32_t ulStartTime = micros();
+
+  if (!(ubOptions & CRASH_BEGIN_NO_MOUNT))
+  {
+    if (!_fs->begin())
+    {
+      return false;
     }
   }
-  else
+
+  // LittleFS has real directories, SPIFFS ignores this
+  if (strcmp(_pcDirectoryName, "/") != 0)
   {
-    // if the given filenumber is zero, remove the current logfile
-    if (SPIFFS.exists(pcCrashFilePath))
+    _fs->mkdir(_pcDirectoryName);
+  }
+
+  // the first instance saves the crashes
+  if (!pCrashStore)
+  {
+    setCrashStore();
+  }
+
+  // check only for a crash log, the rotation is done in the loop()
+  _rotateState = ROTATE_CHECK;
+  _bRotateFailed = false;
+  rotateAsync();
+
+  // do the complete rotation now
+  if (!(ubOptions & CRASH_BEGIN_ASYNC_ROTATE))
+  {
+    while (rotateAsync());
+  }
+
+  _ulBeginDuration = micros() - ulStartTime;
+
+  return true;
+}
+
+/**
+ * @brief      Do the next step of the crash log rotation.
+ *
+ * Each call crawls at most CRASH_ROTATE_STEP_ENTRIES directory entries, so
+ * the rotation is spread over several loop() iterations.
+ *
+ * @retval     True   The rotation is pending
+ * @retval     False  Nothing (more) to do
+ */
+bool EspSaveCrashSpiffs::rotateAsync()
+{
+  switch (_rotateState)
+  {
+    case ROTATE_CHECK:
+      // nothing to rotate without a crash log
+      if (!_fs->exists(_pcFilePath))
+      {
+        _rotateState = ROTATE_IDLE;
+        return false;
+      }
+
+      _rotateDir = _fs->openDir(_pcDirectoryName);
+      _ulRotateIndex = 0;
+      _rotateState = ROTATE_CRAWL;
+      break;
+    case ROTATE_CRAWL:
+      for (uint8_t ubEntry = 0; ubEntry < CRASH_ROTATE_STEP_ENTRIES; ubEntry++)
+      {
+        if (!_rotateDir.next())
+        {
+          _rotateState = ROTATE_RENAME;
+          break;
+        }
+
+        uint32_t ulThisFileIndex;
+
+        // keep the String, c_str() is only valid as long as it exists
+        String thisRawFilePath = _rotateDir.fileName();
+
+        // get only the filename without any directory
+        const char* thisFile = _get_file_name(thisRawFilePath.c_str(), _pcDirectoryName);
+
+        if (thisFile && _get_file_index(thisFile, _pcFilePattern, _pcFileExtension, &ulThisFileIndex) && (ulThisFileIndex > _ulRotateIndex))
+        {
+          _ulRotateIndex = ulThisFileIndex;
+        }
+      }
+      break;
+    case ROTATE_RENAME:
     {
-      // remove this file
-      SPIFFS.remove(pcCrashFilePath);
+      // release the directory before the rename
+      _rotateDir = Dir();
+      _rotateState = ROTATE_IDLE;
+
+      // rename only if the next filename is valid
+      if (!_ulRotateIndex || (_ulRotateIndex >= CRASH_MAX_FILE_INDEX))
+      {
+        return false;
+      }
 
-      // allocate some space for latestFileName
-      char *latestFileName = (char*)calloc(255, sizeof(char));
-      char *latestFilePath = (char*)calloc(255, sizeof(char));
+      // allocate some space for the filepath
+      char *nextFilePath = crashBufferAlloc();
+      if (!nextFilePath)
+      {
+        return false;
+      }
 
-      // find the now most recent filename
-      _find_file_name(0, latestFileName, CRASHFILEPATH, CRASHFILEPATTERN, CRASHFILEEXTENSION);
+      // the next filename, e.g. '/crashLog-6.log' after '/crashLog-5.log'
+      snprintf(nextFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s-%u.%s", _pcDirectoryName, _pcFilePattern, _ulRotateIndex + 1, _pcFileExtension);
 
-      // re-create the filepath (must always start with '/')
-      sprintf(latestFilePath, "%s%s", CRASHFILEPATH, latestFileName);
+      // the compactor, the logger or rotateFile() may have taken the next
+      // filename since the crawl, LittleFS would overwrite it on rename
+      if (_fs->exists(nextFilePath))
+      {
+        CRASH_DEBUG_PRINTF("File '%s' created meanwhile, crawling again\n", nextFilePath);
+        crashBufferFree(nextFilePath);
 
-      // overwrite with the now most recent log file name
-      File lastFileNameFile = SPIFFS.open(LASTCRASHFILEPATH, "w+");
-      // size_t File::write(const uint8_t *buf, size_t size);
-      lastFileNameFile.write(latestFilePath, strlen(latestFilePath));
-      lastFileNameFile.close();
+        _rotateDir = _fs->openDir(_pcDirectoryName);
+        _ulRotateIndex = 0;
+        _rotateState = ROTATE_CRAWL;
+        return true;
+      }
+
+      // rename the crash file to the new/next filename
+      CRASH_DEBUG_PRINTF("Renaming file '%s' to '%s'\n", _pcFilePath, nextFilePath);
+      if (_fs->rename(_pcFilePath, nextFilePath))
+      {
+        _save_last_file_name(nextFilePath);
+        _index_file(nextFilePath);
+      }
+      else
+      {
+        // the crash log stays in place, the next crash is appended to it
+        CRASH_DEBUG_PRINTF("Renaming file '%s' failed\n", _pcFilePath);
+        _bRotateFailed = true;
+      }
 
       // free the allocated space
-      free(latestFileName);
-      free(latestFilePath);
+      crashBufferFree(nextFilePath);
 
-      return true;
+      return false;
     }
+    default:
+      return false;
   }
 
-  return false;
+  return true;
 }
 
 /**
- * @brief      Check file operations.
+ * @brief      Gets the time spent in begin().
  *
- * This function checks if:
- *  - the file system can be accessed
- *  - the file exists
- *  - the file can be written or read
- * @param[in]  theFileName  The file name
- * @param[in]  openMode     The open mode "r", "w", "a"...
+ * @return     The duration in us.
+ */
+uint32_t EspSaveCrashSpiffs::getBeginDuration()
+{
+  return _ulBeginDuration;
+}
+
+/**
+ * @brief      Check if the latest rotation failed.
  *
- * @retval     True   Success
- * @retval     False  Failed
+ * The crash log could not be renamed, it is kept as current crash log and
+ * the next crash is appended to it.
+ *
+ * @retval     True   Renaming the crash log failed
+ * @retval     False  Rotated or nothing to rotate
  */
-bool EspSaveCrashSpiffs::checkFile(const char* theFileName, const char* openMode)
+bool EspSaveCrashSpiffs::isRotateFailed()
 {
-  // if starting the SPIFFS failed
-  if (!SPIFFS.begin())
+  return _bRotateFailed;
+}
+
+/**
+ * @brief      Save crashes with this instance.
+ *
+ * The crash loop state is loaded from the RTC memory and reset if the last
+ * restart was not caused by a crash. The crash report policy state is
+ * loaded from the RTC memory and reset only after power on. The crash loop
+ * callback is called afterwards if a crash loop has been detected.
+ */
+void EspSaveCrashSpiffs::setCrashStore()
+{
+#if CRASH_ENABLE_CRASHLOOP
+  // load the crash loop state of the previous boot
+  ESP.rtcUserMemoryRead(CRASHLOOP_RTC_OFFSET, (uint32_t*)&_crashLoop.state, sizeof(_crashLoop.state));
+
+  // only exceptions and software WDT resets are crashes logged by this lib
+  uint32_t ulResetReason = ESP.getResetInfoPtr()->reason;
+  _crashLoop.onBoot((ulResetReason == REASON_EXCEPTION_RST) || (ulResetReason == REASON_SOFT_WDT_RST));
+  _save_crash_loop_state();
+
+  pCrashLoop = &_crashLoop;
+#endif
+
+#if CRASH_ENABLE_POLICY
+  // load the crash report policy state, kept over all kind of resets
+  ESP.rtcUserMemoryRead(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&_crashPolicy.state, sizeof(_crashPolicy.state));
+  _crashPolicy.onBoot();
+  _save_policy_state();
+
+  pCrashPolicy = &_crashPolicy;
+#endif
+
+  pCrashStore = this;
+
+#if CRASH_IRAM_CAPTURE
+  // save the crash captured by the IRAM handler before the rotation, it
+  // counts for the crash loop detection
+  _save_snapshot();
+#endif
+
+#if CRASH_ENABLE_CRASHLOOP
+  if (_pfnCrashLoop && _crashLoop.isDetected())
   {
-    return false;
+    _pfnCrashLoop(_crashLoop.getCrashCount());
   }
+#endif
+}
 
-  // if the file does not exist
-  if (!SPIFFS.exists(theFileName))
+/**
+ * @brief      Rename a file to the next free filename.
+ *
+ * The next filename is based on the pattern and the extension, e.g.
+ * '/crashLog-1.log' is renamed to '/crashLog-6.log' if '/crashLog-5.log' is
+ * the most recent file.
+ *
+ * @param[in]  filePath       The path of the file to rename
+ * @param      nextFilePath   Optional buffer to store the new filepath to
+ * @param[in]  directoryName  The directory name
+ * @param[in]  filePattern    The file pattern
+ * @param[in]  fileExtension  The file extension
+ *
+ * @retval     True   Success
+ * @retval     False  Failed
+ */
+bool EspSaveCrashSpiffs::rotateFile(const char* filePath, char* nextFilePath, const char* directoryName, const char* filePattern, const char* fileExtension)
+{
+  bool bResult = false;
+
+  // allocate some space for the filename and filepath
+  char *nextFileName = crashBufferAlloc();
+  char *thisNextFilePath = crashBufferAlloc();
+
+  // find the new/next filename
+  if (nextFileName && thisNextFilePath)
   {
-    return false;
+    _find_file_name(1, nextFileName, directoryName, filePattern, fileExtension);
   }
+  // Serial.printf("Found next filename: '%s'\n", nextFileName);
 
-  // if reading or writing operations should also be checked
-  if (openMode)
+  // rename only if the next filename is valid
+  if (nextFileName && thisNextFilePath && strlen(nextFileName))
   {
-    File theFile = SPIFFS.open(theFileName, openMode);
+    // create the filepath (must always start with '/')
+    snprintf(thisNextFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", directoryName, nextFileName);
 
-    // if opening the file failed
-    if (!theFile)
+    // rename the old file to the new generated filename
+    CRASH_DEBUG_PRINTF("Renaming file '%s' to '%s'\n", filePath, thisNextFilePath);
+    // SPIFFS.rename(pathFrom, pathTo)
+    bResult = _fs->rename(filePath, thisNextFilePath);
+
+    if (nextFilePath)
     {
-      return false;
+      strcpy(nextFilePath, thisNextFilePath);
     }
-
-    theFile.close();
   }
 
-  return true;
+  // free the allocated space
+  crashBufferFree(nextFileName);
+  crashBufferFree(thisNextFilePath);
+
+  return bResult;
 }
 
 /**
- * @brief      Reads a file to buffer.
+ * @brief      Gets the string after the found pattern.
  *
- * @param[in]  fileName    The file name
- * @param      size        The size
- * @param      userBuffer  The user buffer to store the content of the file
+ * If nothing is found, it will return Null.
+ * Given 'asdf-12.xyz' as theString and '-' as thePattern, this function
+ * will return '-12'
+ *
+ * @param[in]  theString   The string
+ * @param[in]  thePattern  The pattern
+ *
+ * @return     The position in the string.
+ */
+const char* EspSaveCrashSpiffs::_get_from_string(const char *theString, const char thePattern)
+{
+  const char *pos = strrchr(theString, thePattern);
+
+  return pos;
+}
+
+/**
+ * @brief      Check if some string starts with some other
+ *
+ * @param[in]  a     The string to check
+ * @param[in]  b     The start string
+ *
+ * @retval     True   Success
+ * @retval     False  Failed
+ */
+uint8_t EspSaveCrashSpiffs::_starts_with(const char *a, const char *b)
+{
+  if(strncmp(a, b, strlen(b)) == 0) return 1;
+  return 0;
+}
+
+/**
+ * @brief      Check if some string ends with some other
+ *
+ * @param[in]  a     The string to check
+ * @param[in]  b     The end string
+ *
+ * @retval     True   Success
+ * @retval     False  Failed
+ */
+uint8_t EspSaveCrashSpiffs::_ends_with(const char *a, const char *b)
+{
+  size_t aLength = strlen(a);
+  size_t bLength = strlen(b);
+
+  // a shorter string can not end with a longer one
+  if (aLength < bLength) return 0;
+
+  if(strncmp(a+aLength-bLength, b, bLength) == 0) return 1;
+  return 0;
+}
+
+/**
+ * @brief      Find the next or most recent file name.
+ *
+ * Crawl the directory for files matching the pattern and the extension.
+ *
+ * @param[in]  nextOrLatest    Copy next (1) most recent (0) to nextFileName
+ * @param      nextFileName    The next file name
+ * @param[in]  filePattern     The file pattern
+ * @param[in]  fileExtension   The file extension
+ *
+ * Example usage to find the most recent file:
+ * @code
+ *    // allocate some space for the file name
+ *    char* fileName = (char*)calloc(100, sizeof(char));
+ *
+ *    // find the most recent file starting with 'crashLog'
+ *    // and ending with 'log' in the root directory '/'
+ *    // fileName will be e.g. 'crashLog-123.log'
+ *    // if the most recent one was called 'crashLog-123.log'
+ *    _find_file_name(0, fileName, "/", "crashLog", "log");
+ * @endcode
+ *
+ * Example usage to find the next file:
+ * @code
+ *    // allocate some space for the file name
+ *    char* fileName = (char*)calloc(100, sizeof(char));
+ *
+ *    // find the next filename based on starting with 'crashLog'
+ *    // and ending with 'log' in the root directory '/'
+ *    // fileName will be e.g. 'crashLog-124.log'
+ *    // if the most recent one was called 'crashLog-123.log'
+ *    _find_file_name(1, fileName, "/", "crashLog", "log");
+ * @endcode
+ */
+void EspSaveCrashSpiffs::_find_file_name(uint8_t nextOrLatest, char* nextFileName, const char* directoryName, const char* filePattern, const char* fileExtension)
+{
+  uint32_t ulNextCrashLogFileIndex = 0;
+
+  // if no directory name is given
+  if (!directoryName)
+  {
+    // take the default root directory
+    directoryName = (char*)"/";
+    // Serial.println("No directory given, using default root");
+  }
+  Dir thisDirectory = _fs->openDir(directoryName);
+  // or Dir thisDirectory = LittleFS.openDir("/data");
+
+  // Serial.printf("Crawling directory: '%s'\n", directoryName);
+
+  // iterate through all files in this directory
+  while (thisDirectory.next())
+  {
+    uint32_t ulThisFileIndex;
+
+    // keep the String, c_str() is only valid as long as it exists
+    String thisRawFilePath = thisDirectory.fileName();
+
+    // get only the filename without any directory
+    // '/path/to/logs/crashLog-1.log' becomes 'crashLog-1.log'
+    const char* thisFile = _get_file_name(thisRawFilePath.c_str(), directoryName);
+
+    // Serial.printf("The filename only: '%s'\n", thisFile);
+
+    // if the file pattern and the extension are matching, gets 12 out of
+    // 'asdf-12.xyz'
+    if (!thisFile || !_get_file_index(thisFile, filePattern, fileExtension, &ulThisFileIndex))
+    {
+      continue;
+    }
+
+    // if the current file index is larger than the previous found
+    if ((ulThisFileIndex + 1) > ulNextCrashLogFileIndex)
+    {
+      ulNextCrashLogFileIndex = ulThisFileIndex + 1;
+
+      // check for null pointer
+      if (nextFileName)
+      {
+        if (nextOrLatest == 0)
+        {
+          // create new file name with non incremented aka. highest index
+          // or just simply keep this filename
+          // as it is the most recent filename
+          snprintf(nextFileName, CRASH_NAME_BUFFER_SIZE, "%s", thisFile);
+
+          // Serial.printf("\t Most recent '%s'\n", nextFileName);
+        }
+        else
+        {
+          // create new file name with incremented index
+          snprintf(nextFileName, CRASH_NAME_BUFFER_SIZE, "%s-%u.%s", filePattern, ulNextCrashLogFileIndex, fileExtension);
+          // Serial.printf("\t Next will be '%s'\n", nextFileName);
+        }
+      }
+    }
+  }
+
+  // there is no next file name after the highest index
+  if (nextFileName && nextOrLatest && (ulNextCrashLogFileIndex > CRASH_MAX_FILE_INDEX))
+  {
+    nextFileName[0] = '\0';
+  }
+}
+
+/**
+ * @brief      Gets the index of a crash log file.
+ *
+ * Given 'asdf-12.xyz' as fileName, 'asdf' as filePattern and 'xyz' as
+ * fileExtension, this function will return 12. Files not matching the
+ * pattern and extension, with an index of zero or above CRASH_MAX_FILE_INDEX
+ * or with a name too long for the name buffers are rejected.
+ *
+ * @param[in]  fileName       The file name without any directory
+ * @param[in]  filePattern    The file pattern
+ * @param[in]  fileExtension  The file extension
+ * @param      pulFileIndex   The file index
+ *
+ * @retval     True   The file is a crash log file
+ * @retval     False  Some other file
+ */
+bool EspSaveCrashSpiffs::_get_file_index(const char* fileName, const char* filePattern, const char* fileExtension, uint32_t* pulFileIndex)
+{
+  size_t patternLength = strlen(filePattern);
+
+  // the name and a directory of up to CRASHFILEPATH_SIZE chars have to fit
+  // into the name buffers
+  if (strlen(fileName) >= (CRASH_NAME_BUFFER_SIZE - CRASHFILEPATH_SIZE))
+  {
+    return false;
+  }
+
+  // 'asdf' followed by '-'
+  if ((strncmp(fileName, filePattern, patternLength) != 0) || (fileName[patternLength] != '-'))
+  {
+    return false;
+  }
+
+  const char* thisFileIndex = fileName + patternLength + 1;
+  const char* thisFileExtension = thisFileIndex;
+  uint32_t ulThisFileIndex = 0;
+
+  // only digits are allowed, stop before the index would overflow
+  while ((*thisFileExtension >= '0') && (*thisFileExtension <= '9'))
+  {
+    if (ulThisFileIndex > ((UINT32_MAX - 9) / 10))
+    {
+      return false;
+    }
+
+    ulThisFileIndex = (ulThisFileIndex * 10) + (*thisFileExtension - '0');
+    thisFileExtension++;
+  }
+
+  // '12' followed by '.xyz' and nothing else
+  if ((ulThisFileIndex == 0) || (*thisFileExtension != '.') || (strcmp(thisFileExtension + 1, fileExtension) != 0))
+  {
+    return false;
+  }
+
+  *pulFileIndex = ulThisFileIndex;
+
+  return true;
+}
+
+/**
+ * @brief      Removes a file.
+ *
+ * If the given number is zero, the current log file will be removed.
+ * Otherwise the file at that index of the crash log directory.
+ *
+ * @param[in]  fileNumber  The file number
+ *
+ * @retval     True   Success
+ * @retval     False  Failed
+ */
+bool EspSaveCrashSpiffs::removeFile(uint32_t ulFileNumber)
+{
+  // if there is a filenumber given, remove this
+  if (ulFileNumber > 0)
+  {
+    uint32_t ulThisFileNumber = 0;
+    Dir thisDirectory = _fs->openDir(_pcDirectoryName);
+
+    while (thisDirectory.next())
+    {
+      ulThisFileNumber++;
+
+      // if the given and the current file index are matching
+      if (ulThisFileNumber == ulFileNumber)
+      {
+        // Serial.printf("Reached file #%d named '%s'\n", ulFileNumber, thisDirectory.fileName().c_str());
+
+        // allocate some space for latestFileName
+        char *latestFileName = crashBufferAlloc();
+        char *latestFilePath = crashBufferAlloc();
+        char *thisFilePath = crashBufferAlloc();
+
+        // LittleFS returns only the name, SPIFFS the whole path
+        if (!latestFileName || !latestFilePath || !thisFilePath || !_get_file_path(thisDirectory.fileName().c_str(), thisFilePath))
+        {
+          // no buffer left, the file is in a sub directory or its path does
+          // not fit
+          crashBufferFree(latestFileName);
+          crashBufferFree(latestFilePath);
+          crashBufferFree(thisFilePath);
+
+          return false;
+        }
+
+        // re-create the filepath (must always start with '/')
+        snprintf(latestFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, _pcFilePattern);
+
+        // if this file is a crash log file
+        bool bCrashLog = _starts_with(thisFilePath, latestFilePath) && _ends_with(thisFilePath, _pcFileExtension);
+        if (bCrashLog)
+        {
+          // Serial.printf("File starts with '%s' and ends with '%s'\n", latestFilePath, _pcFileExtension);
+
+          // find the most recent filename, do not rely on the last file name
+          _find_file_name(0, latestFileName, _pcDirectoryName, _pcFilePattern, _pcFileExtension);
+
+          // re-create the filepath (must always start with '/')
+          snprintf(latestFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, latestFileName);
+
+          // remove this current file, it exists for sure as we iterate
+          _space.onRemove(thisDirectory.fileSize());
+          _fs->remove(thisFilePath);
+
+          // if this filename matches the latest crash log file (result is 0)
+          if (strcmp(thisFilePath, latestFilePath) == 0)
+          {
+            // Serial.printf("The file '%s' was the most recent crash log file\n", latestFilePath);
+
+            // overwrite with the now most recent log file name
+            _update_last_file_name();
+          }
+        }
+        else
+        {
+          // Serial.printf("Some other file, no '%s'*.'%s'\n", _pcFilePattern, _pcFileExtension);
+
+          // remove this current file, it exists for sure as we iterate
+          _space.onRemove(thisDirectory.fileSize());
+          _fs->remove(thisFilePath);
+        }
+
+        // free the allocated space
+        crashBufferFree(latestFileName);
+        crashBufferFree(latestFilePath);
+        crashBufferFree(thisFilePath);
+
+        // drop the removed crash log from the index
+        if (bCrashLog)
+        {
+          _prune_index();
+        }
+
+        return true;
+      }
+    }
+  }
+  else
+  {
+    // if the given filenumber is zero, remove the current logfile
+    if (_fs->exists(_pcFilePath))
+    {
+      // remove this file
+      File theFile = _fs->open(_pcFilePath, "r");
+      _space.onRemove(theFile.size());
+      theFile.close();
+      _fs->remove(_pcFilePath);
+
+      // overwrite with the now most recent log file name
+      _update_last_file_name();
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Index range of crash logs to remove, used by removeRange
+ */
+struct crash_remove_range_t
+{
+  uint32_t ulFirstIndex;
+  uint32_t ulLastIndex;
+};
+
+/**
+ * @brief      Filter crash logs within an index range.
+ *
+ * @param[in]  ulFileIndex  The crash log index
+ * @param[in]  filePath     The file path
+ * @param      context      The crash_remove_range_t
+ *
+ * @retval     True   Remove this crash log
+ * @retval     False  Keep this crash log
+ */
+static bool _filter_range(uint32_t ulFileIndex, const char* filePath, void* context)
+{
+  crash_remove_range_t* range = (crash_remove_range_t*)context;
+
+  return (ulFileIndex >= range->ulFirstIndex) && (ulFileIndex <= range->ulLastIndex);
+}
+
+/**
+ * @brief      Removes all crash logs within an index range.
+ *
+ * The current '-1' crash log is not rotated yet and is never removed, use
+ * removeFile(0) to remove it.
+ *
+ * @param[in]  ulFirstIndex  The first crash log index to remove
+ * @param[in]  ulLastIndex   The last crash log index to remove
+ *
+ * @return     Number of removed crash logs
+ *
+ * Example usage to remove '/crashLog-2.log' to '/crashLog-10.log':
+ * @code
+ *    SaveCrashSpiffs.removeRange(2, 10);
+ * @endcode
+ */
+uint32_t EspSaveCrashSpiffs::removeRange(uint32_t ulFirstIndex, uint32_t ulLastIndex)
+{
+  crash_remove_range_t range = {ulFirstIndex, ulLastIndex};
+
+  return removeMatching(_filter_range, &range);
+}
+
+/**
+ * @brief      Removes all rotated crash logs older than the given one.
+ *
+ * The current '-1' crash log is the newest one, it is never removed.
+ *
+ * @param[in]  ulFileIndex  The index of the oldest crash log to keep
+ *
+ * @return     Number of removed crash logs
+ */
+uint32_t EspSaveCrashSpiffs::removeOlderThan(uint32_t ulFileIndex)
+{
+  // the oldest rotated crash log has the index 2
+  if (ulFileIndex < 3)
+  {
+    return 0;
+  }
+
+  return removeRange(2, ulFileIndex - 1);
+}
+
+/**
+ * @brief      Removes all crash logs accepted by the filter.
+ *
+ * The crash log directory is crawled once and the name of the latest crash
+ * log is updated once at the end. Only rotated crash logs are given to the
+ * filter, the current '-1' crash log is kept.
+ *
+ * @param[in]  filter   The filter, return true to remove the crash log
+ * @param      context  The context given to the filter
+ *
+ * @return     Number of removed crash logs
+ *
+ * Example usage to remove all crash logs with an odd index:
+ * @code
+ *    bool isOdd(uint32_t ulFileIndex, const char* filePath, void* context)
+ *    {
+ *      return (ulFileIndex % 2);
+ *    }
+ *
+ *    SaveCrashSpiffs.removeMatching(isOdd);
+ * @endcode
+ */
+uint32_t EspSaveCrashSpiffs::removeMatching(crashRemoveFilter_t filter, void* context)
+{
+  uint32_t ulRemoved = 0;
+  uint32_t ulLatestIndex = 0;
+
+  if (!filter)
+  {
+    return 0;
+  }
+
+  // allocate some space for the filepaths
+  char *thisFilePath = crashBufferAlloc();
+  char *latestFilePath = crashBufferAlloc();
+
+  if (!thisFilePath || !latestFilePath)
+  {
+    crashBufferFree(thisFilePath);
+    crashBufferFree(latestFilePath);
+
+    return 0;
+  }
+
+  // directory name only, in case no crash log is left
+  sprintf(latestFilePath, "%s", _pcDirectoryName);
+
+  Dir thisDirectory = _fs->openDir(_pcDirectoryName);
+
+  while (thisDirectory.next())
+  {
+    uint32_t ulThisFileIndex;
+
+    // LittleFS returns only the name, SPIFFS the whole path, skip all files
+    // which are no crash logs
+    if (!_get_file_path(thisDirectory.fileName().c_str(), thisFilePath) || !_get_file_index(thisFilePath + strlen(_pcDirectoryName), _pcFilePattern, _pcFileExtension, &ulThisFileIndex))
+    {
+      continue;
+    }
+
+    // the current crash log may still be written or rotated
+    if ((ulThisFileIndex >= 2) && filter(ulThisFileIndex, thisFilePath, context))
+    {
+      // remove this current file, it exists for sure as we iterate
+      _space.onRemove(thisDirectory.fileSize());
+      _fs->remove(thisFilePath);
+
+      ulRemoved++;
+    }
+    else if (ulThisFileIndex > ulLatestIndex)
+    {
+      // keep track of the most recent remaining crash log
+      ulLatestIndex = ulThisFileIndex;
+      strcpy(latestFilePath, thisFilePath);
+    }
+  }
+
+  // overwrite once with the now most recent log file name
+  if (ulRemoved)
+  {
+    _save_last_file_name(latestFilePath);
+  }
+
+  // free the allocated space
+  crashBufferFree(thisFilePath);
+  crashBufferFree(latestFilePath);
+
+  // drop the removed crash logs from the index
+  if (ulRemoved)
+  {
+    _prune_index();
+  }
+
+  return ulRemoved;
+}
+
+/**
+ * @brief      Save the most recent crash log file name.
+ *
+ * The directory is crawled for the most recent crash log file.
+ */
+void EspSaveCrashSpiffs::_update_last_file_name()
+{
+  // allocate some space for latestFileName
+  char *latestFileName = crashBufferAlloc();
+  char *latestFilePath = crashBufferAlloc();
+
+  if (latestFileName && latestFilePath)
+  {
+    // find the now most recent filename
+    _find_file_name(0, latestFileName, _pcDirectoryName, _pcFilePattern, _pcFileExtension);
+
+    // re-create the filepath (must always start with '/')
+    snprintf(latestFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, latestFileName);
+
+    _save_last_file_name(latestFilePath);
+  }
+
+  // free the allocated space
+  crashBufferFree(latestFileName);
+  crashBufferFree(latestFilePath);
+}
+
+/**
+ * @brief      Save the most recent crash log file name.
+ *
+ * @param[in]  filePath  The file path
+ */
+void EspSaveCrashSpiffs::_save_last_file_name(const char* filePath)
+{
+  File lastFileNameFile = _fs->open(_pcLastFilePath, "w+");
+  // size_t File::write(const uint8_t *buf, size_t size);
+  lastFileNameFile.write(filePath, strlen(filePath));
+  lastFileNameFile.close();
+}
+
+/**
+ * @brief      Gets the name of a file in a directory.
+ *
+ * LittleFS returns only the name, SPIFFS the whole path. SPIFFS has no real
+ * directories, so it also lists files like '/crash/old/crashLog-2.log' in
+ * the directory '/crash/'. These are in a sub directory, like the
+ * directories listed by LittleFS, and are skipped.
+ *
+ * @param[in]  fileName       The file name as returned by Dir::fileName()
+ * @param[in]  directoryName  The directory name
+ *
+ * @return     The name without the directory, NULL for a sub directory
+ */
+const char* EspSaveCrashSpiffs::_get_file_name(const char* fileName, const char* directoryName)
+{
+  // SPIFFS returns the whole path, starting with the directory name
+  if (fileName[0] == '/')
+  {
+    size_t directoryLength = strlen(directoryName);
+
+    if (strncmp(fileName, directoryName, directoryLength) != 0)
+    {
+      return NULL;
+    }
+    fileName += directoryLength;
+  }
+
+  if (!fileName[0] || strchr(fileName, '/'))
+  {
+    return NULL;
+  }
+
+  return fileName;
+}
+
+/**
+ * @brief      Gets the full file path of a file in the crash log directory.
+ *
+ * Given 'crashLog-12.log' or '/crash/crashLog-12.log' as fileName and
+ * '/crash/' as the crash log directory, this function will return
+ * '/crash/crashLog-12.log'
+ *
+ * @param[in]  fileName  The file name as returned by Dir::fileName()
+ * @param      filePath  The file path
+ *
+ * @retval     True   Success
+ * @retval     False  The file is in a sub directory or the path is too long
+ */
+bool EspSaveCrashSpiffs::_get_file_path(const char* fileName, char* filePath)
+{
+  const char* thisFile = _get_file_name(fileName, _pcDirectoryName);
+
+  if (!thisFile)
+  {
+    return false;
+  }
+
+  int length = snprintf(filePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, thisFile);
+
+  return (length > 0) && (length < CRASH_NAME_BUFFER_SIZE);
+}
+
+/**
+ * @brief      Check file operations.
+ *
+ * This function checks if:
+ *  - the file system can be accessed
+ *  - the file exists
+ *  - the file can be written or read
+ * @param[in]  theFileName  The file name
+ * @param[in]  openMode     The open mode "r", "w", "a"...
+ *
+ * @retval     True   Success
+ * @retval     False  Failed
+ */
+bool EspSaveCrashSpiffs::checkFile(const char* theFileName, const char* openMode)
+{
+  // if starting the filesystem failed
+  if (!_fs->begin())
+  {
+    return false;
+  }
+
+  // if the file does not exist
+  if (!_fs->exists(theFileName))
+  {
+    return false;
+  }
+
+  // if reading or writing operations should also be checked
+  if (openMode)
+  {
+    File theFile = _fs->open(theFileName, openMode);
+
+    // if opening the file failed
+    if (!theFile)
+    {
+      return false;
+    }
+
+    theFile.close();
+  }
+
+  return true;
+}
+
+/**
+ * @brief      Reads a file to buffer.
+ *
+ * @param[in]  fileName    The file name
+ * @param      size        The size
+ * @param      userBuffer  The user buffer to store the content of the file
+ *
+ * @return     Sucess or error accessing the file
+ */
+bool EspSaveCrashSpiffs::readFileToBuffer(const char* fileName, char* userBuffer)
+{
+  // check if SPIFFS is working and file exists.
+  // NULL parameter as checking reading or writing is not neccessary here
+  if (!checkFile(fileName, "r"))
+  {
+    // exit on file error
+    return false;
+  }
+
+  File theFile = _fs->open(fileName, "r");
+
+  theFile.readBytes(userBuffer, theFile.size());
+
+  theFile.close();
+
+  return true;
+}
+
+/**
+ * @brief      Print the file content to outputDev
+ *
+ * The file is printed line by line. The CRC of each crash record is
+ * checked while streaming, a corrupted record is followed by a
+ * '!!! CRC mismatch ...' line.
+ *
+ * @param[in]  fileName   The file name
+ * @param      outputDev  The output dev
+ *
+ * @return     Sucess or error accessing the file
+ */
+bool EspSaveCrashSpiffs::print(const char* fileName, Print& outputDev)
+{
+  // check if SPIFFS is working and file exists.
+  // NULL parameter as checking reading or writing is not neccessary here
+  if (!checkFile(fileName, "r"))
+  {
+    // exit on file error
+    return false;
+  }
+
+  File theFile = _fs->open(fileName, "r");
+  EspSaveCrashVerifier verifier;
+  size_t lineLength = 0;
+
+  // allocate some space for a line
+  char *pcLine = crashBufferAlloc();
+  if (!pcLine)
+  {
+    theFile.close();
+
+    return false;
+  }
+
+  while (true)
+  {
+    int iChar = theFile.read();
+
+    if (iChar >= 0)
+    {
+      pcLine[lineLength++] = (char)iChar;
+    }
+
+    // print complete lines, a full line buffer or the rest of the file, the
+    // verifier continues a line printed in several parts
+    if (lineLength && ((iChar < 0) || (iChar == '\n') || (lineLength == (CRASH_NAME_BUFFER_SIZE - 1))))
+    {
+      pcLine[lineLength] = '\0';
+
+      // flag the record while streaming, it has already been printed
+      crashIntegrity_t integrity = verifier.parseLine(pcLine);
+      if (integrity == CRASH_INTEGRITY_TRUNCATED)
+      {
+        outputDev.print("!!! CRC missing, the record above is truncated !!!\n");
+      }
+
+      outputDev.write((const uint8_t*)pcLine, lineLength);
+
+      if (integrity == CRASH_INTEGRITY_INVALID)
+      {
+        outputDev.print("!!! CRC mismatch, the record above is corrupted !!!\n");
+      }
+
+      lineLength = 0;
+    }
+
+    if (iChar < 0)
+    {
+      break;
+    }
+  }
+
+  // a record cut by the end of the file
+  if (verifier.finish() == CRASH_INTEGRITY_TRUNCATED)
+  {
+    outputDev.print("!!! CRC missing, the record above is truncated !!!\n");
+  }
+
+  // free the allocated space
+  crashBufferFree(pcLine);
+
+  theFile.close();
+
+  return true;
+}
+
+/**
+ * @brief      Print the crash log content added since the cursor.
+ *
+ * The crash logs are read in the order of their index, starting at the
+ * cursor. The cursor is moved behind the printed content, so the next call
+ * continues there. At most maxBytes are printed, cut at the end of a line.
+ * Only a single line longer than maxBytes is cut within the line.
+ *
+ * Only rotated crash logs are read, the current '-1' log file is read after
+ * it has been rotated on the next boot. A cursor behind the latest crash
+ * log, e.g. after the crash logs have been removed, restarts at the oldest
+ * crash log.
+ *
+ * @param      cursor     The cursor
+ * @param      outputDev  The output dev
+ * @param[in]  maxBytes   The maximum number of bytes to print
+ *
+ * @return     Number of printed bytes, zero if nothing new is available
+ *
+ * Example usage:
+ * @code
+ *    crash_cursor_t cursor = {0, 0};
+ *
+ *    // print the next 1024 byte of new crash logs, call it again until it
+ *    // returns zero
+ *    SaveCrashSpiffs.readSince(&cursor, Serial, 1024);
+ * @endcode
+ */
+size_t EspSaveCrashSpiffs::readSince(crash_cursor_t* cursor, Print& outputDev, size_t maxBytes)
+{
+  size_t totalBytes = 0;
+  uint32_t ulNextIndex;
+  uint32_t ulLatestIndex;
+
+  // continue within the file of the cursor
+  bool bFound = _find_file_after(cursor->ulFileIndex ? (cursor->ulFileIndex - 1) : 0, &ulNextIndex, &ulLatestIndex);
+
+  // the crash logs have been removed or restarted with a lower index
+  if (cursor->ulFileIndex > ulLatestIndex)
+  {
+    cursor->ulFileIndex = 0;
+    cursor->ulOffset = 0;
+    bFound = _find_file_after(0, &ulNextIndex, &ulLatestIndex);
+  }
+
+  // allocate some space for the filepath and the file content
+  char *thisFilePath = crashBufferAlloc();
+  char *thisContent = crashBufferAlloc();
+
+  while (thisFilePath && thisContent && bFound && (totalBytes < maxBytes))
+  {
+    if (ulNextIndex != cursor->ulFileIndex)
+    {
+      cursor->ulFileIndex = ulNextIndex;
+      cursor->ulOffset = 0;
+    }
+
+    snprintf(thisFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s-%u.%s", _pcDirectoryName, _pcFilePattern, cursor->ulFileIndex, _pcFileExtension);
+
+    File theFile = _fs->open(thisFilePath, "r");
+    if (theFile)
+    {
+      size_t fileSize = theFile.size();
+
+      // the file has been replaced by a smaller one
+      if (cursor->ulOffset > fileSize)
+      {
+        cursor->ulOffset = 0;
+      }
+      theFile.seek(cursor->ulOffset, SeekSet);
+
+      while ((cursor->ulOffset < fileSize) && (totalBytes < maxBytes))
+      {
+        size_t length = theFile.read((uint8_t*)thisContent, CRASH_NAME_BUFFER_SIZE);
+        if (!length)
+        {
+          break;
+        }
+
+        // cut at the last line end, if the content does not fit anymore
+        if ((totalBytes + length) > maxBytes)
+        {
+          size_t lineLength = maxBytes - totalBytes;
+          while ((lineLength > 0) && (thisContent[lineLength - 1] != '\n'))
+          {
+            lineLength--;
+          }
+
+          // cut a line longer than maxBytes at maxBytes, to make progress
+          // at all
+          if (!lineLength && !totalBytes)
+          {
+            lineLength = maxBytes;
+          }
+          length = lineLength;
+
+          // stop after this content
+          maxBytes = totalBytes + length;
+        }
+
+        outputDev.write((const uint8_t*)thisContent, length);
+        cursor->ulOffset += length;
+        totalBytes += length;
+      }
+
+      theFile.close();
+    }
+
+    // continue with the next file, only if this one has been completed
+    if (totalBytes >= maxBytes)
+    {
+      break;
+    }
+    bFound = _find_file_after(cursor->ulFileIndex, &ulNextIndex, &ulLatestIndex);
+  }
+
+  // free the allocated space
+  crashBufferFree(thisFilePath);
+  crashBufferFree(thisContent);
+
+  return totalBytes;
+}
+
+/**
+ * @brief      Parse a cursor given as 'fileIndex:offset', e.g. '12:340'
+ *
+ * @param[in]  pcCursor  The cursor string
+ * @param      cursor    The cursor
+ *
+ * @retval     True   Success
+ * @retval     False  Invalid cursor string, cursor is reset to the start
+ */
+bool crashCursorFromString(const char* pcCursor, crash_cursor_t* cursor)
+{
+  char* pcEnd;
+
+  cursor->ulFileIndex = 0;
+  cursor->ulOffset = 0;
+
+  if (!pcCursor || !*pcCursor)
+  {
+    return false;
+  }
+
+  uint32_t ulFileIndex = strtoul(pcCursor, &pcEnd, 10);
+  if ((pcEnd == pcCursor) || (*pcEnd != ':'))
+  {
+    return false;
+  }
+
+  pcCursor = pcEnd + 1;
+  uint32_t ulOffset = strtoul(pcCursor, &pcEnd, 10);
+  if ((pcEnd == pcCursor) || (*pcEnd != '\0'))
+  {
+    return false;
+  }
+
+  cursor->ulFileIndex = ulFileIndex;
+  cursor->ulOffset = ulOffset;
+
+  return true;
+}
+
+/**
+ * @brief      Format a cursor as 'fileIndex:offset', e.g. '12:340'
+ *
+ * @param[in]  cursor      The cursor
+ * @param      pcCursor    The cursor string, 22 chars are sufficient
+ * @param[in]  cursorSize  The size of the cursor string
+ */
+void crashCursorToString(const crash_cursor_t* cursor, char* pcCursor, size_t cursorSize)
+{
+  snprintf(pcCursor, cursorSize, "%u:%u", cursor->ulFileIndex, cursor->ulOffset);
+}
+
+/**
+ * @brief      Find the rotated crash log following a file index.
+ *
+ * The current '-1' crash log is skipped.
+ *
+ * @param[in]  ulFileIndex     The file index
+ * @param      pulNextIndex    The lowest file index larger than ulFileIndex
+ * @param      pulLatestIndex  The highest file index, zero if there is none
+ *
+ * @retval     True   A following crash log has been found
+ * @retval     False  No following crash log
+ */
+bool EspSaveCrashSpiffs::_find_file_after(uint32_t ulFileIndex, uint32_t* pulNextIndex, uint32_t* pulLatestIndex)
+{
+  bool bFound = false;
+  Dir thisDirectory = _fs->openDir(_pcDirectoryName);
+
+  *pulNextIndex = 0;
+  *pulLatestIndex = 0;
+
+  while (thisDirectory.next())
+  {
+    uint32_t ulThisFileIndex;
+
+    // keep the String, c_str() is only valid as long as it exists
+    String thisRawFilePath = thisDirectory.fileName();
+
+    // get only the filename without any directory
+    const char* thisFile = _get_file_name(thisRawFilePath.c_str(), _pcDirectoryName);
+
+    if (!thisFile || !_get_file_index(thisFile, _pcFilePattern, _pcFileExtension, &ulThisFileIndex) || (ulThisFileIndex < 2))
+    {
+      continue;
+    }
+
+    if (ulThisFileIndex > *pulLatestIndex)
+    {
+      *pulLatestIndex = ulThisFileIndex;
+    }
+
+    if ((ulThisFileIndex > ulFileIndex) && (!bFound || (ulThisFileIndex < *pulNextIndex)))
+    {
+      *pulNextIndex = ulThisFileIndex;
+      bFound = true;
+    }
+  }
+
+  return bFound;
+}
+
+/**
+ * @brief      Count files matching the pattern
+ *
+ * @param      dirName  The directory name
+ * @param      pattern  The pattern to search for
+ *
+ * @return     Number of files matching the pattern
+ */
+uint32_t EspSaveCrashSpiffs::count(char* dirName, char* pattern)
+{
+  // if no directory name is given
+  if (!dirName)
+  {
+    // take the crash log directory
+    dirName = (char*)_pcDirectoryName;
+  }
+
+  // if no pattern is given
+  if (!pattern)
+  {
+    return 0;
+  }
+
+  // search for files in the log directory
+  Dir thisDirectory = _fs->openDir(dirName);
+
+  uint32_t ulCrashCounter = 0;
+  while (thisDirectory.next())
+  {
+    // if (thisDirectory.fileName().startsWith(CRASHFILEPATTERN))
+    // if (thisDirectory.fileName().endsWith(CRASHFILEEXTENSION))
+    if (thisDirectory.fileName().endsWith(pattern))
+    {
+      ulCrashCounter++;
+    }
+  }
+
+  return ulCrashCounter;
+}
+
+/**
+ * @brief      Gets the total number of files in this directory.
+ *
+ * @param      dirName  The directory name
+ *
+ * @return     The number of files.
+ */
+uint32_t EspSaveCrashSpiffs::getNumberOfFiles(char* dirName)
+{
+  // if no directory name is given
+  if (!dirName)
+  {
+    // take the crash log directory
+    dirName = (char*)_pcDirectoryName;
+  }
+
+  // search for files in the log directory
+  Dir thisDirectory = _fs->openDir(dirName);
+
+  uint32_t ulFileCounter = 0;
+
+  while (thisDirectory.next())
+  {
+    ulFileCounter++;
+  }
+
+  return ulFileCounter;
+}
+
+/**
+ * @brief      Gets the longest file name.
+ *
+ * @param      dirName  The directory name
+ *
+ * @return     The longest file name as integer.
+ */
+uint32_t EspSaveCrashSpiffs::getLongestFileName(char* dirName)
+{
+  // if no directory name is given
+  if (!dirName)
+  {
+    // take the crash log directory
+    dirName = (char*)_pcDirectoryName;
+  }
+
+  // search for files in the log directory
+  Dir thisDirectory = _fs->openDir(dirName);
+
+  uint8_t ubLongestFilename = 0;
+
+  while (thisDirectory.next())
+  {
+    uint8_t _thisFilenameLength = strlen(thisDirectory.fileName().c_str());
+
+    if (_thisFilenameLength > ubLongestFilename)
+    {
+      ubLongestFilename = _thisFilenameLength;
+    }
+  }
+
+  return ubLongestFilename;
+}
+
+/**
+ * @brief      Create a list of files.
+ *
+ * Each entry of the array has to hold getLongestFileName() + 1 chars.
+ *
+ * @param      dirName          The directory name
+ * @param      ppcGivenArray    Array to store the filenames to
+ * @param[in]  ubNumberOfFiles  The number of files
+ */
+void EspSaveCrashSpiffs::getFileList(char* dirName, char** ppcGivenArray, uint8_t ubNumberOfFiles)
+{
+  // if no directory name is given
+  if (!dirName)
+  {
+    // take the crash log directory
+    dirName = (char*)_pcDirectoryName;
+  }
+
+  // search for files in the log directory
+  Dir thisDirectory = _fs->openDir(dirName);
+
+  uint8_t i = 0;
+
+  // stop if more files are available than space in array, e.g. a file has
+  // been added after the array has been allocated
+  while ((i < ubNumberOfFiles) && thisDirectory.next())
+  {
+    sprintf(ppcGivenArray[i], "%s", thisDirectory.fileName().c_str());
+
+    i++;
+  }
+}
+
+/**
+ * @brief      Get remaining space of filesystem
+ *
+ * @return     Free space in byte
+ */
+uint32_t EspSaveCrashSpiffs::getFreeSpace()
+{
+  // estimated by the writes and removals of this library
+  return _space.getFreeSpace();
+}
+
+/**
+ * @brief      Check if this amout of space is free on the SPIFFS
+ *
+ * @param[in]  ulFileSize  The size of the thing to store
+ *
+ * @retval     True   Requested size will fit to the SPIFFS
+ * @retval     False  Requested size won't fit
+ */
+bool EspSaveCrashSpiffs::checkFreeSpace(const uint32_t ulFileSize)
+{
+  return _space.checkFreeSpace(ulFileSize);
+}
+
+/**
+ * @brief      Gets the current log file name.
+ *
+ * @return     The log file name.
+ */
+const char* EspSaveCrashSpiffs::getLogFileName()
+{
+  return _pcFilePath;
+}
+
+/**
+ * @brief      Gets the last (n-1) log file name.
+ *
+ * @param      fileContent  Pointer to store the file content
+ *
+ * @return     The log file name.
+ */
+void EspSaveCrashSpiffs::getLastLogFileName(char* fileContent)
+{
+  File theFile = _fs->open(_pcLastFilePath, "r");
+
+  theFile.readBytes(fileContent, theFile.size());
+
+  theFile.close();
+}
+
+/**
+ * @brief      Sets the log file name.
+ *
+ * @param      fileName  The file name
+ */
+void EspSaveCrashSpiffs::setLogFileName(char *fileName)
+{
+  snprintf(_pcFilePath, sizeof(_pcFilePath), "%s", fileName);
+}
+
+/**
+ * @brief      Check if the device is in a crash loop.
+ *
+ * @retval     True   Crash loop detected
+ * @retval     False  No crash loop
+ */
+bool EspSaveCrashSpiffs::isCrashLoop()
+{
+  return _crashLoop.isDetected();
+}
+
+/**
+ * @brief      Gets the number of crashes within the crash loop window.
+ *
+ * @return     The crash count.
+ */
+uint32_t EspSaveCrashSpiffs::getCrashLoopCount()
+{
+  return _crashLoop.getCrashCount();
+}
+
+/**
+ * @brief      Clear the crash loop state.
+ *
+ * Call this once the application is considered to be stable again.
+ */
+void EspSaveCrashSpiffs::clearCrashLoop()
+{
+  _crashLoop.reset();
+  _save_crash_loop_state();
+}
+
+/**
+ * @brief      Sets the crash loop callback.
+ *
+ * The callback is called by begin() if a crash loop has been detected on
+ * this boot, e.g. to enter a safe mode. Set it before begin(), if this
+ * instance already saves the crashes it is called immediately.
+ *
+ * @param[in]  callback  The callback
  *
- * @return     Sucess or error accessing the file
+ * Example usage:
+ * @code
+ *    void enterSafeMode(uint32_t ulCrashCount)
+ *    {
+ *      // skip starting the crashing parts of the application
+ *    }
+ *
+ *    SaveCrashSpiffs.setCrashLoopCallback(enterSafeMode);
+ *    SaveCrashSpiffs.begin();
+ * @endcode
  */
-bool EspSaveCrashSpiffs::readFileToBuffer(const char* fileName, char* userBuffer)
+void EspSaveCrashSpiffs::setCrashLoopCallback(crashLoopCallback_t callback)
 {
-  // check if SPIFFS is working and file exists.
-  // NULL parameter as checking reading or writing is not neccessary here
-  if (!checkFile(fileName, "r"))
+  _pfnCrashLoop = callback;
+
+  // the crash loop state has already been loaded
+  if (_pfnCrashLoop && (pCrashStore == this) && _crashLoop.isDetected())
   {
-    // exit on file error
-    return false;
+    _pfnCrashLoop(_crashLoop.getCrashCount());
   }
+}
 
-  File theFile = SPIFFS.open(fileName, "r");
-
-  theFile.readBytes(userBuffer, theFile.size());
+/**
+ * @brief      Save the crash loop state to the RTC memory.
+ */
+void EspSaveCrashSpiffs::_save_crash_loop_state()
+{
+#if CRASH_ENABLE_CRASHLOOP
+  ESP.rtcUserMemoryWrite(CRASHLOOP_RTC_OFFSET, (uint32_t*)&_crashLoop.state, sizeof(_crashLoop.state));
+#endif
+}
 
-  theFile.close();
+/**
+ * @brief      Save the crash report policy state to the RTC memory.
+ */
+void EspSaveCrashSpiffs::_save_policy_state()
+{
+#if CRASH_ENABLE_POLICY
+  ESP.rtcUserMemoryWrite(CRASH_POLICY_RTC_OFFSET, (uint32_t*)&_crashPolicy.state, sizeof(_crashPolicy.state));
+#endif
+}
 
-  return true;
+/**
+ * @brief      Gets the filesystem of the crash logs.
+ *
+ * @return     The filesystem.
+ */
+FS& EspSaveCrashSpiffs::getFileSystem()
+{
+  return *_fs;
 }
 
 /**
- * @brief      Print the file content to outputDev
+ * @brief      Gets the free space accountant of the filesystem.
  *
- * @param[in]  fileName   The file name
- * @param      outputDev  The output dev
+ * @return     The free space accountant.
+ */
+EspSaveCrashSpace& EspSaveCrashSpiffs::getSpace()
+{
+  return _space;
+}
+
+/**
+ * @brief      Gets the crash log directory name.
  *
- * @return     Sucess or error accessing the file
+ * @return     The directory name.
  */
-bool EspSaveCrashSpiffs::print(const char* fileName, Print& outputDev)
+const char* EspSaveCrashSpiffs::getDirectoryName()
 {
-  // check if SPIFFS is working and file exists.
-  // NULL parameter as checking reading or writing is not neccessary here
-  if (!checkFile(fileName, "r"))
-  {
-    // exit on file error
-    return false;
-  }
+  return _pcDirectoryName;
+}
 
-  File theFile = SPIFFS.open(fileName, "r");
+/**
+ * @brief      Gets the crash log file pattern.
+ *
+ * @return     The file pattern.
+ */
+const char* EspSaveCrashSpiffs::getFilePattern()
+{
+  return _pcFilePattern;
+}
 
-  while (theFile.available())
-  {
-    outputDev.write(theFile.read());
-  }
+/**
+ * @brief      Gets the crash log file extension.
+ *
+ * @return     The file extension.
+ */
+const char* EspSaveCrashSpiffs::getFileExtension()
+{
+  return _pcFileExtension;
+}
 
-  theFile.close();
+/**
+ * @brief      Sets the build id saved with each crash log.
+ *
+ * The build id defaults to CRASH_BUILD_ID, by default the compile time of
+ * this library. The library is not rebuilt if only the sketch changes, so
+ * the default does not identify the firmware. Define CRASH_BUILD_ID for
+ * each firmware build or set the MD5 of the sketch here. The string is not
+ * copied, it has to be valid as long as this instance is used.
+ *
+ * @param[in]  buildId  The build id, e.g. the firmware version
+ *
+ * Example usage to identify the build by the MD5 of the sketch:
+ * @code
+ *    // computed once, as reading the sketch takes some time
+ *    String sketchMD5 = ESP.getSketchMD5();
+ *
+ *    SaveCrashSpiffs.setBuildId(sketchMD5.c_str());
+ * @endcode
+ */
+void EspSaveCrashSpiffs::setBuildId(const char* buildId)
+{
+  _pcBuildId = buildId ? buildId : CRASH_BUILD_ID;
+}
 
-  return true;
+/**
+ * @brief      Gets the build id saved with each crash log.
+ *
+ * @return     The build id.
+ */
+const char* EspSaveCrashSpiffs::getBuildId()
+{
+  return _pcBuildId;
 }
 
 /**
- * @brief      Count files matching the pattern
+ * @brief      Gets the crash logs of a build.
  *
- * @param      dirName  The directory name
- * @param      pattern  The pattern to search for
+ * The crash log index of the directory is read, crash logs removed in the
+ * meantime are skipped. The 'Build:' line of each listed crash log is
+ * checked, as the index of a removed crash log may have been reused by a
+ * crash log of another build. The file indexes are returned in the order
+ * the crash logs have been rotated.
  *
- * @return     Number of files matching the pattern
+ * @param[in]  buildId         The build id, NULL for the running build
+ * @param      pulFileIndexes  Array to store the file indexes to
+ * @param[in]  ulMaxFiles      The size of the array
+ *
+ * @return     The number of file indexes stored to the array
+ *
+ * Example usage to print the crash logs of the running build:
+ * @code
+ *    uint32_t pulFileIndexes[10];
+ *    uint32_t ulFiles = SaveCrashSpiffs.getBuildFiles(NULL, pulFileIndexes, 10);
+ *
+ *    for (uint32_t i = 0; i < ulFiles; i++)
+ *    {
+ *      Serial.printf("crashLog-%u.log\n", pulFileIndexes[i]);
+ *    }
+ * @endcode
  */
-uint32_t EspSaveCrashSpiffs::count(char* dirName, char* pattern)
+uint32_t EspSaveCrashSpiffs::getBuildFiles(const char* buildId, uint32_t* pulFileIndexes, uint32_t ulMaxFiles)
 {
-  // if no directory name is given
-  if (!dirName)
+  uint32_t ulFiles = 0;
+  char pcFileBuildId[CRASH_RECORD_BUILD_ID_SIZE];
+
+  if (!buildId)
   {
-    // take the default root directory
-    dirName = (char*)"/";
+    buildId = _pcBuildId;
   }
 
-  // if no pattern is given
-  if (!pattern)
+  // allocate some space for the index path, a line and the crash log path
+  char *indexFilePath = crashBufferAlloc();
+  char *indexLine = crashBufferAlloc();
+  char *thisFilePath = crashBufferAlloc();
+
+  if (!indexFilePath || !indexLine || !thisFilePath)
   {
+    crashBufferFree(indexFilePath);
+    crashBufferFree(indexLine);
+    crashBufferFree(thisFilePath);
+
     return 0;
   }
 
-  // search for files in the log directory
-  Dir thisDirectory = SPIFFS.openDir(dirName);
+  snprintf(indexFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, CRASHINDEXFILENAME);
 
-  uint32_t ulCrashCounter = 0;
-  while (thisDirectory.next())
+  File indexFile = _fs->open(indexFilePath, "r");
+
+  // each line is '<file index> <build id>'
+  while (indexFile && (ulFiles < ulMaxFiles) && indexFile.available())
   {
-    // if (thisDirectory.fileName().startsWith(CRASHFILEPATTERN))
-    // if (thisDirectory.fileName().endsWith(CRASHFILEEXTENSION))
-    if (thisDirectory.fileName().endsWith(pattern))
+    size_t lineLength = indexFile.readBytesUntil('\n', indexLine, CRASH_NAME_BUFFER_SIZE - 1);
+    indexLine[lineLength] = '\0';
+
+    char* pcBuildId;
+    uint32_t ulFileIndex = strtoul(indexLine, &pcBuildId, 10);
+
+    if ((pcBuildId == indexLine) || (*pcBuildId != ' ') || (strcmp(pcBuildId + 1, buildId) != 0))
     {
-      ulCrashCounter++;
+      continue;
+    }
+
+    // an index may be listed twice, if it has been reused after a removal
+    uint32_t i = 0;
+    while ((i < ulFiles) && (pulFileIndexes[i] != ulFileIndex))
+    {
+      i++;
+    }
+    if (i < ulFiles)
+    {
+      continue;
+    }
+
+    // skip crash logs removed or replaced by another build in the meantime
+    snprintf(thisFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s-%u.%s", _pcDirectoryName, _pcFilePattern, ulFileIndex, _pcFileExtension);
+    if (!_fs->exists(thisFilePath))
+    {
+      continue;
+    }
+    if (!_read_build_id(thisFilePath, pcFileBuildId, sizeof(pcFileBuildId)))
+    {
+      strcpy(pcFileBuildId, "-");
+    }
+    if (strcmp(pcFileBuildId, pcBuildId + 1) == 0)
+    {
+      pulFileIndexes[ulFiles++] = ulFileIndex;
     }
   }
 
-  return ulCrashCounter;
+  if (indexFile)
+  {
+    indexFile.close();
+  }
+
+  // free the allocated space
+  crashBufferFree(indexFilePath);
+  crashBufferFree(indexLine);
+  crashBufferFree(thisFilePath);
+
+  return ulFiles;
 }
 
 /**
- * @brief      Gets the total number of files in this directory.
+ * @brief      Create the crash log index from the rotated crash logs.
  *
- * @param      dirName  The directory name
+ * Use this once for crash logs saved before the index existed, or after
+ * crash logs have been removed without this library. The directory is crawled once per
+ * crash log, so this takes some time with many crash logs.
  *
- * @return     The number of files.
+ * @return     The number of indexed crash logs
  */
-uint32_t EspSaveCrashSpiffs::getNumberOfFiles(char* dirName)
+uint32_t EspSaveCrashSpiffs::rebuildIndex()
 {
-  // if no directory name is given
-  if (!dirName)
+  uint32_t ulFileIndex = 0;
+  uint32_t ulLatestIndex;
+  uint32_t ulIndexed = 0;
+
+  // allocate some space for the index path and the crash log path
+  char *indexFilePath = crashBufferAlloc();
+  char *thisFilePath = crashBufferAlloc();
+
+  // keep the old index, if no buffer is left
+  if (!indexFilePath || !thisFilePath)
   {
-    // take the default root directory
-    dirName = (char*)"/";
-  }
+    crashBufferFree(indexFilePath);
+    crashBufferFree(thisFilePath);
 
-  // search for files in the log directory
-  Dir thisDirectory = SPIFFS.openDir(dirName);
+    return 0;
+  }
 
-  uint32_t ulFileCounter = 0;
+  snprintf(indexFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, CRASHINDEXFILENAME);
+  _fs->remove(indexFilePath);
 
-  while (thisDirectory.next())
+  // the directory is not crawled while the index is written
+  while (_find_file_after(ulFileIndex, &ulFileIndex, &ulLatestIndex))
   {
-    ulFileCounter++;
+    snprintf(thisFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s-%u.%s", _pcDirectoryName, _pcFilePattern, ulFileIndex, _pcFileExtension);
+    _index_file(thisFilePath);
+    ulIndexed++;
   }
 
-  return ulFileCounter;
+  // free the allocated space
+  crashBufferFree(indexFilePath);
+  crashBufferFree(thisFilePath);
+
+  return ulIndexed;
 }
 
 /**
- * @brief      Gets the longest file name.
- *
- * @param      dirName  The directory name
+ * @brief      Drop the entries of removed crash logs from the index.
  *
- * @return     The longest file name as integer.
+ * The remaining entries are copied to a temporary file, which replaces the
+ * index. A reset during the copy loses the index, rebuildIndex() creates
+ * it again.
  */
-uint32_t EspSaveCrashSpiffs::getLongestFileName(char* dirName)
+void EspSaveCrashSpiffs::_prune_index()
 {
-  // if no directory name is given
-  if (!dirName)
+  // allocate some space for the index paths, a line and the crash log path
+  char *indexFilePath = crashBufferAlloc();
+  char *tmpFilePath = crashBufferAlloc();
+  char *indexLine = crashBufferAlloc();
+  char *thisFilePath = crashBufferAlloc();
+
+  if (indexFilePath && tmpFilePath && indexLine && thisFilePath)
   {
-    // take the default root directory
-    dirName = (char*)"/";
-  }
+    snprintf(indexFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, CRASHINDEXFILENAME);
+    snprintf(tmpFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, CRASHINDEXTMPFILENAME);
 
-  // search for files in the log directory
-  Dir thisDirectory = SPIFFS.openDir(dirName);
+    File indexFile = _fs->open(indexFilePath, "r");
+    File tmpFile;
 
-  uint8_t ubLongestFilename = 0;
+    if (indexFile)
+    {
+      tmpFile = _fs->open(tmpFilePath, "w");
+    }
 
-  while (thisDirectory.next())
-  {
-    uint8_t _thisFilenameLength = strlen(thisDirectory.fileName().c_str());
+    // each line is '<file index> <build id>'
+    while (indexFile && tmpFile && indexFile.available())
+    {
+      size_t lineLength = indexFile.readBytesUntil('\n', indexLine, CRASH_NAME_BUFFER_SIZE - 1);
+      indexLine[lineLength] = '\0';
 
-    if (_thisFilenameLength > ubLongestFilename)
+      char* pcBuildId;
+      uint32_t ulFileIndex = strtoul(indexLine, &pcBuildId, 10);
+
+      if ((pcBuildId == indexLine) || (*pcBuildId != ' '))
+      {
+        continue;
+      }
+
+      // keep the entries of existing crash logs only
+      snprintf(thisFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s-%u.%s", _pcDirectoryName, _pcFilePattern, ulFileIndex, _pcFileExtension);
+      if (_fs->exists(thisFilePath))
+      {
+        size_t written = tmpFile.printf("%s\n", indexLine);
+        _space.onWrite(written);
+      }
+    }
+
+    if (indexFile && tmpFile)
     {
-      ubLongestFilename = _thisFilenameLength;
+      _space.onRemove(indexFile.size());
+      indexFile.close();
+      tmpFile.close();
+
+      // SPIFFS does not replace an existing file on rename
+      _fs->remove(indexFilePath);
+      _fs->rename(tmpFilePath, indexFilePath);
+    }
+    else if (indexFile)
+    {
+      indexFile.close();
     }
   }
 
-  return ubLongestFilename;
+  // free the allocated space
+  crashBufferFree(indexFilePath);
+  crashBufferFree(tmpFilePath);
+  crashBufferFree(indexLine);
+  crashBufferFree(thisFilePath);
 }
 
 /**
- * @brief      Create a list of files.
+ * @brief      Read the build id of a crash log.
  *
- * @param      dirName          The directory name
- * @param      ppcGivenArray    Array to store the filenames to
- * @param[in]  ubNumberOfFiles  The number of files
+ * Only the header of the first record is read.
+ *
+ * @param[in]  filePath     The crash log file path
+ * @param      buildId      The build id
+ * @param[in]  buildIdSize  The size of the build id buffer
+ *
+ * @retval     True   Build id found
+ * @retval     False  No build id, e.g. saved by an older version
  */
-void EspSaveCrashSpiffs::getFileList(char* dirName, char** ppcGivenArray, uint8_t ubNumberOfFiles)
+bool EspSaveCrashSpiffs::_read_build_id(const char* filePath, char* buildId, size_t buildIdSize)
 {
-  // if no directory name is given
-  if (!dirName)
-  {
-    // take the default root directory
-    dirName = (char*)"/";
-  }
+  bool bResult = false;
+  char pcLine[CRASH_LINE_BUFFER_SIZE];
 
-  // search for files in the log directory
-  Dir thisDirectory = SPIFFS.openDir(dirName);
+  File theFile = _fs->open(filePath, "r");
 
-  uint8_t i = 0;
-  while (thisDirectory.next())
+  // the build id follows the exception cause in the first lines
+  for (uint8_t ubLine = 0; theFile && (ubLine < 8) && theFile.available(); ubLine++)
   {
-    sprintf(ppcGivenArray[i], "%s", thisDirectory.fileName().c_str());
-
-    i++;
+    size_t lineLength = theFile.readBytesUntil('\n', pcLine, sizeof(pcLine) - 1);
+    pcLine[lineLength] = '\0';
 
-    // break if more files are available than space in array
-    if (i > ubNumberOfFiles)
+    if (_starts_with(pcLine, "Build: "))
     {
+      snprintf(buildId, buildIdSize, "%s", pcLine + strlen("Build: "));
+      bResult = true;
       break;
     }
   }
-}
 
-/**
- * @brief      Get remaining space of filesystem
- *
- * @return     Free space in byte
- */
-uint32_t EspSaveCrashSpiffs::getFreeSpace()
-{
-  // struct FSInfo {
-  //   size_t totalBytes;
-  //   size_t usedBytes;
-  //   size_t blockSize;
-  //   size_t pageSize;
-  //   size_t maxOpenFiles;
-  //   size_t maxPathLength;
-  // };
-  FSInfo fs_info;
-
-  // fill FSInfo struct with informations about the SPIFFS
-  SPIFFS.info(fs_info);
+  if (theFile)
+  {
+    theFile.close();
+  }
 
-  return (fs_info.totalBytes - (fs_info.usedBytes * 1.05));
+  return bResult;
 }
 
 /**
- * @brief      Check if this amout of space is free on the SPIFFS
+ * @brief      Add a rotated crash log to the crash log index.
  *
- * @param[in]  ulFileSize  The size of the thing to store
+ * Crash logs without a build id are indexed with the build id '-'.
  *
- * @retval     True   Requested size will fit to the SPIFFS
- * @retval     False  Requested size won't fit
+ * @param[in]  filePath  The crash log file path
  */
-bool EspSaveCrashSpiffs::checkFreeSpace(const uint32_t ulFileSize)
+void EspSaveCrashSpiffs::_index_file(const char* filePath)
 {
-  return (getFreeSpace() > ulFileSize) ? true : false;
-}
+  uint32_t ulFileIndex;
+  char pcBuildId[CRASH_RECORD_BUILD_ID_SIZE];
 
-/**
- * @brief      Gets the current log file name.
- *
- * @return     The log file name.
- */
-const char* EspSaveCrashSpiffs::getLogFileName()
-{
-  if (pcCrashFilePath)
+  // get only the filename without any directory
+  const char* thisFile = _get_from_string(filePath, '/');
+  thisFile = thisFile ? (thisFile + 1) : filePath;
+
+  if (!_get_file_index(thisFile, _pcFilePattern, _pcFileExtension, &ulFileIndex))
   {
-    return pcCrashFilePath;
+    return;
   }
-  else
+
+  if (!_read_build_id(filePath, pcBuildId, sizeof(pcBuildId)))
   {
-    return (char*)"";
+    strcpy(pcBuildId, "-");
   }
-}
 
-/**
- * @brief      Gets the last (n-1) log file name.
- *
- * @param      fileContent  Pointer to store the file content
- *
- * @return     The log file name.
- */
-void EspSaveCrashSpiffs::getLastLogFileName(char* fileContent)
-{
-  File theFile = SPIFFS.open(LASTCRASHFILEPATH, "r");
+  // allocate some space for the index path
+  char *indexFilePath = crashBufferAlloc();
+  if (!indexFilePath)
+  {
+    return;
+  }
 
-  theFile.readBytes(fileContent, theFile.size());
+  snprintf(indexFilePath, CRASH_NAME_BUFFER_SIZE, "%s%s", _pcDirectoryName, CRASHINDEXFILENAME);
 
-  theFile.close();
+  File indexFile = _fs->open(indexFilePath, "a");
+  if (indexFile)
+  {
+    size_t written = indexFile.printf("%u %s\n", ulFileIndex, pcBuildId);
+    _space.onWrite(written);
+    indexFile.close();
+  }
+
+  // free the allocated space
+  crashBufferFree(indexFilePath);
 }
 
+#if CRASH_IRAM_CAPTURE
 /**
- * @brief      Sets the log file name.
+ * @brief      Save the crash snapshot of the IRAM crash handler.
  *
- * @param      fileName  The file name
+ * The snapshot is read from the RTC user memory, saved as crash log and
+ * invalidated afterwards. The crash loop state is updated here, as the IRAM
+ * handler can not do it.
  */
-void EspSaveCrashSpiffs::setLogFileName(char *fileName)
+void EspSaveCrashSpiffs::_save_snapshot()
 {
-  pcCrashFilePath = fileName;
+  crash_snapshot_t snapshot;
+
+  ESP.rtcUserMemoryRead(CRASH_SNAPSHOT_RTC_OFFSET, (uint32_t*)&snapshot, sizeof(snapshot));
+
+  // skip if there is no (complete) snapshot
+  if ((snapshot.ulMagic != CRASH_SNAPSHOT_MAGIC) || (snapshot.ulCheck != crashSnapshotCheck(&snapshot)))
+  {
+    return;
+  }
+
+  // invalidate the snapshot, it is saved only once
+  uint32_t ulInvalid = 0;
+  ESP.rtcUserMemoryWrite(CRASH_SNAPSHOT_RTC_OFFSET, &ulInvalid, sizeof(ulInvalid));
+
+#if CRASH_ENABLE_CRASHLOOP
+  _crashLoop.onCrash(snapshot.ulCrashTime);
+  _save_crash_loop_state();
+#endif
+
+  struct rst_info crashInfo;
+  memset(&crashInfo, 0, sizeof(crashInfo));
+  crashInfo.reason = snapshot.ulReason;
+  crashInfo.exccause = snapshot.ulExccause;
+  crashInfo.epc1 = snapshot.ulEpc1;
+  crashInfo.epc2 = snapshot.ulEpc2;
+  crashInfo.epc3 = snapshot.ulEpc3;
+  crashInfo.excvaddr = snapshot.ulExcvaddr;
+  crashInfo.depc = snapshot.ulDepc;
+
+  File fileCrashFile = _open_crash_file();
+
+  if (fileCrashFile)
+  {
+    _save_crash_record(fileCrashFile, &crashInfo, snapshot.ulCrashTime, snapshot.ulStack, snapshot.pulStack, snapshot.ulStackWords * 4, false);
+
+    _close_crash_file(fileCrashFile);
+  }
+
+  _save_policy_state();
 }
+#endif
@@ -47,14 +47,23 @@
 #include <string.h>
 #include <stdlib.h>
 
-// the crash log file MUST end with '-1.log' to iterate correctly
-#define CRASHFILEPATH       "/"
-#define CRASHFILENAME       "crashLog-1.log"
-#define CRASHFILEPATTERN    "crashLog"
-#define CRASHFILEEXTENSION  "log"
-
-#ifndef LASTCRASHFILEPATH
-#define LASTCRASHFILEPATH "/lastName.txt"
+#include "EspSaveCrashConfig.h"
+#include "EspSaveCrashLoop.h"
+#include "EspSaveCrashPolicy.h"
+#include "EspSaveCrashBreadcrumbs.h"
+#include "EspSaveCrashSpace.h"
+#include "EspSaveCrashSnapshot.h"
+#include "EspSaveCrashArena.h"
+#include "EspSaveCrashCrc.h"
+
+// storage backend of the default constructor
+#ifndef CRASH_DEFAULT_FS
+#ifdef CRASH_USE_LITTLEFS
+#include <LittleFS.h>
+#define CRASH_DEFAULT_FS LittleFS
+#else
+#define CRASH_DEFAULT_FS SPIFFS
+#endif
 #endif
 
 // define the usage of SPIFFS crash log before anything else
@@ -68,25 +77,68 @@
  *  1. Crash time
  *  2. Restart reason
  *  3. Exception cause
- *  4. epc1
- *  5. epc2
- *  6. epc3
- *  7. excvaddr
- *  8. depc
- *  9. adress of stack start
- * 10. adress of stack end
- * 11. stack trace bytes
+ *  4. Build id of the firmware
+ *  5. Free heap, heap fragmentation and max free block
+ *  6. epc1
+ *  7. epc2
+ *  8. epc3
+ *  9. excvaddr
+ * 10. depc
+ * 11. Breadcrumbs, oldest first
+ * 12. Memory around excvaddr, epc1, epc2 and epc3 if readable
+ * 13. adress of stack start
+ * 14. adress of stack end
+ * 15. stack trace bytes
  *     ...
+ * 16. HMAC-SHA256 of the record, if a key has been set
+ * 17. CRC32 of the record
+ *
+ * In case of a detected crash loop the stack trace is skipped to save flash
+ * and boot time. The crash report policy saves repeated crashes with the
+ * header only and drops crashes exceeding the flash bytes per hour.
  */
 
+/**
+ * Position of a collector in the crash logs
+ *
+ * Everything up to ulOffset of the crash log with index ulFileIndex has
+ * been read. Start with a zero cursor to read all crash logs.
+ */
+struct crash_cursor_t
+{
+  uint32_t ulFileIndex;
+  uint32_t ulOffset;
+};
+
+// options of begin(), combine them with '|'
+#define CRASH_BEGIN_DEFAULT       0
+// the filesystem has already been mounted by the application
+#define CRASH_BEGIN_NO_MOUNT      (1 << 0)
+// rotate the crash log later by calling rotateAsync() in the loop()
+#define CRASH_BEGIN_ASYNC_ROTATE  (1 << 1)
+
+typedef void (*crashLoopCallback_t)(uint32_t ulCrashCount);
+typedef void (*crashFlushCallback_t)(void);
+typedef bool (*crashRemoveFilter_t)(uint32_t ulFileIndex, const char* filePath, void* context);
+
 class EspSaveCrashSpiffs
 {
   public:
     EspSaveCrashSpiffs(char *pcAlternativeFilePath=0);
+    EspSaveCrashSpiffs(FS& fileSystem, const char* directoryName, const char* filePattern=CRASHFILEPATTERN, const char* fileExtension=CRASHFILEEXTENSION);
+
+    bool begin(uint8_t ubOptions=CRASH_BEGIN_DEFAULT);
+    bool rotateAsync();
+    uint32_t getBeginDuration();
+    bool isRotateFailed();
 
     bool removeFile(uint32_t ulFileNumber);
+    uint32_t removeRange(uint32_t ulFirstIndex, uint32_t ulLastIndex);
+    uint32_t removeOlderThan(uint32_t ulFileIndex);
+    uint32_t removeMatching(crashRemoveFilter_t filter, void* context=0);
     bool readFileToBuffer(const char* fileName, char* userBuffer);
     bool print(const char* fileName, Print& outDevice = Serial);
+    size_t readSince(crash_cursor_t* cursor, Print& outDevice, size_t maxBytes=CRASH_SYNC_MAX_BYTES);
     uint32_t count(char *dirName, char *pattern);
     uint32_t getNumberOfFiles(char* dirName);
     uint32_t getLongestFileName(char* dirName);
@@ -97,16 +149,78 @@ class EspSaveCrashSpiffs
     void getLastLogFileName(char* fileContent);
     bool checkFile(const char* theFileName, const char* openMode);
     void setLogFileName(char* fileName);
+    bool rotateFile(const char* filePath, char* nextFilePath, const char* directoryName, const char* filePattern, const char* fileExtension);
+    bool isCrashLoop();
+    uint32_t getCrashLoopCount();
+    void clearCrashLoop();
+    void setCrashLoopCallback(crashLoopCallback_t callback);
+    void setCrashStore();
+    FS& getFileSystem();
+    EspSaveCrashSpace& getSpace();
+    const char* getDirectoryName();
+    const char* getFilePattern();
+    const char* getFileExtension();
+    void setBuildId(const char* buildId);
+    const char* getBuildId();
+    uint32_t getBuildFiles(const char* buildId, uint32_t* pulFileIndexes, uint32_t ulMaxFiles);
+    uint32_t rebuildIndex();
   private:
+    friend class EspSaveCrashCompactor;
+    friend class EspSaveCrashDump;
+
+    enum rotateState_t
+    {
+      ROTATE_IDLE = 0,
+      ROTATE_CHECK,
+      ROTATE_CRAWL,
+      ROTATE_RENAME
+    };
+
+    void _init(const char* crashFilePath);
     const char* _get_from_string(const char *theString, const char thePattern);
-    const char* _get_file_extension(const char *fileName);
-    void _extract_file_name(const char *name, char *fileName);
     uint8_t _starts_with(const char *a, const char *b);
     uint8_t _ends_with(const char *a, const char *b);
     void _find_file_name(uint8_t nextOrLatest, char* nextFileName, const char* directoryName, const char* filePattern, const char* fileExtension);
+    bool _get_file_index(const char* fileName, const char* filePattern, const char* fileExtension, uint32_t* pulFileIndex);
+    bool _find_file_after(uint32_t ulFileIndex, uint32_t* pulNextIndex, uint32_t* pulLatestIndex);
+    void _save_crash_loop_state();
+    void _save_policy_state();
+#if CRASH_IRAM_CAPTURE
+    void _save_snapshot();
+#endif
+    void _update_last_file_name();
+    void _save_last_file_name(const char* filePath);
+    const char* _get_file_name(const char* fileName, const char* directoryName);
+    bool _get_file_path(const char* fileName, char* filePath);
+    bool _read_build_id(const char* filePath, char* buildId, size_t buildIdSize);
+    void _index_file(const char* filePath);
+    void _prune_index();
+
+    FS* _fs;
+    EspSaveCrashSpace _space;
+    const char* _pcDirectoryName;
+    const char* _pcFilePattern;
+    const char* _pcFileExtension;
+    const char* _pcBuildId;
+    char _pcFilePath[CRASHFILEPATH_SIZE];
+    char _pcLastFilePath[CRASHFILEPATH_SIZE];
+    EspSaveCrashLoop _crashLoop;
+    EspSaveCrashPolicy _crashPolicy;
+    crashLoopCallback_t _pfnCrashLoop;
+    rotateState_t _rotateState;
+    Dir _rotateDir;
+    uint32_t _ulRotateIndex;
+    bool _bRotateFailed;
+    uint32_t _ulBeginDuration;
 };
 
 void saveToSpiffsLog(char *content);
 void saveToSpiffsFile(char *content, const char *fileName);
+void setCrashFlushCallback(crashFlushCallback_t callback);
+#if CRASH_ENABLE_HMAC
+void setCrashHmacKey(const uint8_t* key, size_t keyLength);
+#endif
+bool crashCursorFromString(const char* pcCursor, crash_cursor_t* cursor);
+void crashCursorToString(const crash_cursor_t* cursor, char* pcCursor, size_t cursorSize);
 
 #endif